@@ -0,0 +1,74 @@
+#include "base/arena.hpp"
+#include <cstring>
+#include <string>
+
+void* Arena::allocate(size_t size, size_t alignment) {
+	byte* p = reinterpret_cast<byte*>((uintptr_t(current_) + alignment - 1) & ~uintptr_t(alignment - 1));
+	if (current_ == nullptr || p + size > end_) {
+		// Objects bigger than a page get a page of their own.
+		size_t header = (sizeof(Page) + alignment - 1) & ~(alignment - 1);
+		size_t page_size = header + size > PageSize ? header + size : PageSize;
+		Page* page;
+		if (page_size == PageSize && spare_ != nullptr) {
+			page = spare_;
+			spare_ = spare_->next;
+		} else {
+			page = static_cast<Page*>(::operator new(page_size));
+			page->size = page_size;
+		}
+		page->next = head_;
+		head_ = page;
+		p = reinterpret_cast<byte*>(page) + header;
+		end_ = reinterpret_cast<byte*>(page) + page_size;
+	}
+	current_ = p + size;
+	return p;
+}
+
+const char* Arena::copy(const std::string& s) {
+	char* p = reinterpret_cast<char*>(allocate(s.size() + 1, 1));
+	memcpy(p, s.c_str(), s.size() + 1);
+	return p;
+}
+
+void Arena::adopt(Arena& other) {
+	if (other.head_ == nullptr) return;
+	// The other arena's pages go behind the current one, which keeps being bumped.
+	Page* last = other.head_;
+	while (last->next) last = last->next;
+	if (head_ == nullptr) {
+		head_ = other.head_;
+		current_ = other.current_;
+		end_ = other.end_;
+	} else {
+		last->next = head_->next;
+		head_->next = other.head_;
+	}
+	other.head_ = nullptr;
+	other.current_ = nullptr;
+	other.end_ = nullptr;
+}
+
+void Arena::clear() {
+	reset();
+	while (spare_) {
+		Page* next = spare_->next;
+		::operator delete(spare_);
+		spare_ = next;
+	}
+}
+
+void Arena::reset() {
+	while (head_) {
+		Page* next = head_->next;
+		if (head_->size == PageSize) {
+			head_->next = spare_;
+			spare_ = head_;
+		} else {
+			::operator delete(head_);
+		}
+		head_ = next;
+	}
+	current_ = nullptr;
+	end_ = nullptr;
+}
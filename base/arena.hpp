@@ -0,0 +1,45 @@
+#pragma once
+#ifndef ARENA_HPP_7FJX2QWM
+#define ARENA_HPP_7FJX2QWM
+
+#include "base/basic.hpp"
+#include <new>
+#include <string>
+#include <utility>
+
+// Bump allocator for many small objects that are released together. Nothing is freed
+// or destructed individually, so objects in it must not own memory elsewhere.
+class Arena {
+public:
+	Arena() : head_(nullptr), spare_(nullptr), current_(nullptr), end_(nullptr) {}
+	Arena(const Arena&) = delete;
+	~Arena() { clear(); }
+	
+	void* allocate(size_t size, size_t alignment);
+	template <typename T, typename... Args>
+	T* make(Args&&... args) {
+		return ::new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+	// A null-terminated copy of 's'.
+	const char* copy(const std::string& s);
+	
+	// Takes over the memory of 'other', which is left empty.
+	void adopt(Arena& other);
+	// Releases everything, one page at a time.
+	void clear();
+	// Releases everything, but keeps the pages to allocate from again.
+	void reset();
+private:
+	struct Page {
+		Page* next;
+		size_t size;
+	};
+	static const size_t PageSize = 64 * 1024;
+	
+	Page* head_;
+	Page* spare_;
+	byte* current_;
+	byte* end_;
+};
+
+#endif /* end of include guard: ARENA_HPP_7FJX2QWM */
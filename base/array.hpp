@@ -3,6 +3,7 @@
 #define ARRAY_HPP_6MM1YKSV
 
 #include "base/basic.hpp"
+#include <cstring>
 
 #if defined(USE_STD_VECTOR)
 #include <vector>
@@ -26,7 +27,10 @@ public:
 	const T& operator[](uint32 idx) const;
 	
 	uint32 size() const { return size_; }
+	T& back() { return (*this)[size_-1]; }
+	const T& back() const { return (*this)[size_-1]; }
 	void push_back(T element);
+	void pop_back();
 	void reserve(uint32);
 	void resize(uint32, T fill = T());
 	void clear(bool deallocate = true);
@@ -47,6 +51,8 @@ public:
 	
 	iterator erase(iterator);
 private:
+	void copy_from(const Array<T>& other);
+	
 	T* data_;
 	uint32 size_;
 	uint32 alloc_size_;
@@ -54,8 +60,7 @@ private:
 
 template <typename T>
 Array<T>::Array(const Array<T>& other) : data_(nullptr), size_(0), alloc_size_(0) {
-	reserve(other.size());
-	insert(other.begin(), other.end());
+	copy_from(other);
 }
 
 template <typename T>
@@ -72,9 +77,9 @@ Array<T>::~Array() {
 
 template <typename T>
 Array<T>& Array<T>::operator=(const Array<T>& other) {
-	clear();
-	reserve(other.size());
-	insert(other.begin(), other.end());
+	if (&other == this) return *this;
+	clear(false);
+	copy_from(other);
 	return *this;
 }
 
@@ -89,6 +94,17 @@ Array<T>& Array<T>::operator=(Array<T>&& other) {
 	return *this;
 }
 
+template <typename T>
+void Array<T>::copy_from(const Array<T>& other) {
+	reserve(other.size());
+	if (std::is_trivially_copyable<T>::value) {
+		if (other.size_) memcpy(static_cast<void*>(data_), other.data_, sizeof(T)*other.size_);
+		size_ = other.size_;
+	} else {
+		insert(other.begin(), other.end());
+	}
+}
+
 template <typename T>
 T& Array<T>::operator[](uint32 idx) {
 	ASSERT(idx < size_);
@@ -104,7 +120,15 @@ const T& Array<T>::operator[](uint32 idx) const {
 template <typename T>
 void Array<T>::push_back(T element) {
 	reserve(size_+1);
-	data_[size_++] = element;
+	new(data_ + size_) T(std::move(element));
+	size_++;
+}
+
+template <typename T>
+void Array<T>::pop_back() {
+	ASSERT(size_ != 0);
+	size_--;
+	data_[size_].~T();
 }
 
 template <typename T>
@@ -113,9 +137,13 @@ void Array<T>::reserve(uint32 new_size) {
 		uint32 req_size = alloc_size_ ? alloc_size_ : 1;
 		while (req_size < new_size) req_size *= 2;
 		byte* p = new byte[sizeof(T)*req_size];
-		for (uint32 i = 0; i < size_; ++i) {
-			new(p+sizeof(T)*i) T(std::move(data_[i]));
-			data_[i].~T();
+		if (std::is_trivially_copyable<T>::value) {
+			if (size_) memcpy(p, data_, sizeof(T)*size_);
+		} else {
+			for (uint32 i = 0; i < size_; ++i) {
+				new(p+sizeof(T)*i) T(std::move(data_[i]));
+				data_[i].~T();
+			}
 		}
 		delete[] reinterpret_cast<byte*>(data_);
 		data_ = reinterpret_cast<T*>(p);
@@ -126,13 +154,16 @@ void Array<T>::reserve(uint32 new_size) {
 template <typename T>
 void Array<T>::resize(uint32 new_size, T x) {
 	reserve(new_size);
-	while (size_ < new_size) push_back(x);
+	while (size_ < new_size) {
+		new(data_ + size_) T(x);
+		size_++;
+	}
 }
 
 template <typename T>
 template <typename InputIterator>
 void Array<T>::insert(InputIterator begin, InputIterator end) {
-	reserve(end - begin);
+	reserve(size_ + (end - begin));
 	for (auto p = begin; p < end; ++p) {
 		push_back(*p);
 	}
@@ -148,8 +179,10 @@ void Array<T>::emplace_back(Args... args) {
 
 template <typename T>
 void Array<T>::clear(bool deallocate) {
-	for (uint32 i = 0; i < size_; ++i) {
-		data_[i].~T();
+	if (!std::is_trivially_destructible<T>::value) {
+		for (uint32 i = 0; i < size_; ++i) {
+			data_[i].~T();
+		}
 	}
 	size_ = 0;
 	if (deallocate) {
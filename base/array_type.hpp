@@ -4,6 +4,8 @@
 
 #include "type/type.hpp"
 #include "serialization/archive_node.hpp"
+#include "serialization/archive_writer.hpp"
+#include "serialization/archive_reader.hpp"
 
 
 struct ArrayType : DerivedType {
@@ -13,7 +15,7 @@ public:
 	const Type* element_type() const { return element_type_; }
 	const Type* type_of_element(size_t idx) const { return element_type(); }
 protected:
-	ArrayType(std::string name, const Type* element_type, bool is_variable_length) : name_(std::move(name)), element_type_(element_type), is_variable_length_(is_variable_length) {}
+	ArrayType(std::string name, const Type* element_type, bool is_variable_length) : DerivedType(TypeKind::Array), name_(std::move(name)), element_type_(element_type), is_variable_length_(is_variable_length) {}
 	std::string name_;
 	const Type* element_type_;
 	bool is_variable_length_;
@@ -21,11 +23,21 @@ protected:
 
 struct FixedArrayType : ArrayType {
 public:
-	FixedArrayType(const Type* element_type, size_t num_elements) : ArrayType(build_fixed_array_type_name(element_type), element_type, false) {}
+	FixedArrayType(const Type* element_type, size_t num_elements) : ArrayType(build_fixed_array_type_name(element_type), element_type, false), num_elements_(num_elements) {}
 	size_t num_elements() const { return num_elements_; }
 	size_t offset_of_element(size_t idx) const { return idx * element_type_->size(); }
 	size_t size() const override { return element_type_->size() * num_elements_; }
+	size_t alignment() const override { return element_type_->alignment(); }
+	bool is_trivially_copyable() const override { return element_type_->is_trivially_copyable(); }
+	bool is_trivially_destructible() const override { return element_type_->is_trivially_destructible(); }
+	bool is_zero_initializable() const override { return element_type_->is_zero_initializable(); }
 	
+	void construct(byte* place, IUniverse& universe) const override {
+		element_type_->construct_n(place, num_elements_, element_type_->size(), universe);
+	}
+	void destruct(byte* place, IUniverse& universe) const override {
+		element_type_->destruct_n(place, num_elements_, element_type_->size(), universe);
+	}
 	void deserialize(byte* place, const ArchiveNode& node, IUniverse&) const override;
 	void serialize(const byte* place, ArchiveNode& node, IUniverse&) const override;
 protected:
@@ -44,8 +56,17 @@ public:
 	size_t offset_of_element(size_t idx) const { return idx * this->element_type_->size(); }
 	
 	void deserialize(Container& place, const ArchiveNode& node, IUniverse&) const;
+	void deserialize(Container& place, ArchiveReader& reader, IUniverse&) const;
 	void serialize(const Container& place, ArchiveNode& node, IUniverse&) const;
+	void serialize(const Container& place, ArchiveWriter& writer, IUniverse&) const;
 	Object* cast(const DerivedType* to, Object* o) const { return nullptr; }
+private:
+	// Numbers and vectors, which writers can store as one packed block.
+	static const SimpleType* packable_element_type() {
+		const Type* element_type = get_type<ElementType>();
+		bool packable = (element_type->kind() == TypeKind::Simple || element_type->kind() == TypeKind::Vector) && element_type->is_trivially_copyable();
+		return packable ? static_cast<const SimpleType*>(element_type) : nullptr;
+	}
 };
 
 template <typename T>
@@ -59,22 +80,69 @@ struct BuildTypeInfo<Array<T>> {
 template <typename T>
 void VariableLengthArrayType<T>::deserialize(T& obj, const ArchiveNode& node, IUniverse& universe) const {
 	if (node.is_array()) {
+		// Grow once and deserialize into place, instead of moving each element in.
+		size_t old_size = obj.size();
 		size_t sz = node.array_size();
-		obj.reserve(sz);
+		obj.resize(old_size + sz);
+		const Type* element_type = get_type<ElementType>();
+		if (element_type->kind() == TypeKind::Vector) {
+			if (sz) static_cast<const VectorType*>(element_type)->deserialize_n(reinterpret_cast<byte*>(&obj[old_size]), sz, sizeof(ElementType), node);
+			return;
+		}
 		for (size_t i = 0; i < sz; ++i) {
-			ElementType element;
-			get_type<ElementType>()->deserialize(reinterpret_cast<byte*>(&element), node[i], universe);
-			obj.push_back(std::move(element));
+			element_type->deserialize(reinterpret_cast<byte*>(&obj[old_size + i]), node[i], universe);
 		}
 	}
 }
 
+template <typename T>
+void VariableLengthArrayType<T>::deserialize(T& obj, ArchiveReader& reader, IUniverse& universe) const {
+	const SimpleType* packable = packable_element_type();
+	size_t count;
+	if (packable && reader.begin_packed_array(*packable, count)) {
+		size_t old_size = obj.size();
+		obj.resize(old_size + count);
+		reader.read_packed(count ? reinterpret_cast<byte*>(&obj[old_size]) : nullptr, sizeof(ElementType));
+		return;
+	}
+	if (!reader.begin_array()) return;
+	const Type* element_type = get_type<ElementType>();
+	while (reader.next_element()) {
+		size_t i = obj.size();
+		obj.resize(i + 1);
+		element_type->deserialize(reinterpret_cast<byte*>(&obj[i]), reader, universe);
+	}
+}
+
 template <typename T>
 void VariableLengthArrayType<T>::serialize(const T& obj, ArchiveNode& node, IUniverse& universe) const {
+	const Type* element_type = get_type<ElementType>();
+	if (element_type->kind() == TypeKind::Vector) {
+		if (obj.size()) static_cast<const VectorType*>(element_type)->serialize_n(reinterpret_cast<const byte*>(&obj[0]), obj.size(), sizeof(ElementType), node);
+		return;
+	}
 	for (auto& it: obj) {
 		ArchiveNode& element = node.array_push();
 		get_type<ElementType>()->serialize(reinterpret_cast<const byte*>(&it), element, universe);
 	}
 }
 
+template <typename T>
+void VariableLengthArrayType<T>::serialize(const T& obj, ArchiveWriter& writer, IUniverse& universe) const {
+	const SimpleType* packable = packable_element_type();
+	if (packable && obj.size() && writer.packed_array(*packable, reinterpret_cast<const byte*>(&obj[0]), obj.size(), sizeof(ElementType))) {
+		return;
+	}
+	const Type* element_type = get_type<ElementType>();
+	writer.begin_array();
+	if (element_type->kind() == TypeKind::Vector) {
+		if (obj.size()) static_cast<const VectorType*>(element_type)->serialize_n(reinterpret_cast<const byte*>(&obj[0]), obj.size(), sizeof(ElementType), writer);
+	} else {
+		for (auto& it: obj) {
+			element_type->serialize(reinterpret_cast<const byte*>(&it), writer, universe);
+		}
+	}
+	writer.end_array();
+}
+
 #endif /* end of include guard: ARRAY_TYPE_HPP_JIO2A6YN */
@@ -36,8 +36,8 @@ byte* BagMemoryHandler::allocate() {
 		current_->current += element_size_;
 		return memory;
 	} else {
-		byte* memory = *free_list_;
-		free_list_ = (byte**)*memory;
+		byte* memory = (byte*)free_list_;
+		free_list_ = *(byte***)memory;
 		return memory;
 	}
 }
@@ -56,4 +56,5 @@ void BagMemoryHandler::clear() {
 	}
 	current_ = nullptr;
 	head_ = nullptr;
+	free_list_ = nullptr;
 }
\ No newline at end of file
@@ -1,15 +1,25 @@
 #include "type/type.hpp"
 #include "base/maybe.hpp"
 #include "serialization/archive_node.hpp"
+#include "serialization/archive_writer.hpp"
+#include "serialization/archive_reader.hpp"
 
 std::string build_maybe_type_name(const Type* inner_type);
 
+struct MaybeTypeBase : Type {
+	virtual const Type* inner_type() const = 0;
+protected:
+	MaybeTypeBase() : Type(TypeKind::Maybe) {}
+};
+
 template <typename T>
-struct MaybeType : TypeFor<Maybe<T>> {
+struct MaybeType : TypeFor<Maybe<T>, MaybeTypeBase> {
 	MaybeType() : name_(build_maybe_type_name(get_type<T>())) {}
 	
 	void deserialize(Maybe<T>& place, const ArchiveNode&, IUniverse&) const;
+	void deserialize(Maybe<T>& place, ArchiveReader&, IUniverse&) const;
 	void serialize(const Maybe<T>& place, ArchiveNode&, IUniverse&) const;
+	void serialize(const Maybe<T>& place, ArchiveWriter&, IUniverse&) const;
 	
 	const std::string& name() const { return name_; }
 	
@@ -27,6 +37,17 @@ void MaybeType<T>::deserialize(Maybe<T>& m, const ArchiveNode& node, IUniverse&
 	}
 }
 
+template <typename T>
+void MaybeType<T>::deserialize(Maybe<T>& m, ArchiveReader& reader, IUniverse& universe) const {
+	if (reader.peek() != ArchiveNodeType::Empty) {
+		T value;
+		inner_type()->deserialize(reinterpret_cast<byte*>(&value), reader, universe);
+		m = std::move(value);
+	} else {
+		reader.skip();
+	}
+}
+
 template <typename T>
 void MaybeType<T>::serialize(const Maybe<T>& m, ArchiveNode& node, IUniverse& universe) const {
 	m.map([&](const T& it) {
@@ -34,6 +55,17 @@ void MaybeType<T>::serialize(const Maybe<T>& m, ArchiveNode& node, IUniverse& un
 	});
 }
 
+template <typename T>
+void MaybeType<T>::serialize(const Maybe<T>& m, ArchiveWriter& writer, IUniverse& universe) const {
+	if (m.is_set()) {
+		m.map([&](const T& it) {
+			inner_type()->serialize(reinterpret_cast<const byte*>(&it), writer, universe);
+		});
+	} else {
+		writer.null();
+	}
+}
+
 template <typename T>
 struct BuildTypeInfo<Maybe<T>> {
 	static const MaybeType<T>* build() {
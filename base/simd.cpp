@@ -0,0 +1,138 @@
+#include "base/simd.hpp"
+
+#if defined(__SSE2__) && !defined(NO_SIMD)
+#define USE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace {
+	template <typename From, typename To>
+	void convert_scalar(const From* in, To* out, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = static_cast<To>(in[i]);
+		}
+	}
+	
+#if defined(USE_X86_SIMD)
+	// Each kernel converts as many elements as fit its vector width, and returns how
+	// many it did. The caller converts the rest with convert_scalar.
+	
+	size_t float64_to_float32_sse2(const float64* in, float32* out, size_t count) {
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(in + i));
+			__m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(in + i + 2));
+			_mm_storeu_ps(out + i, _mm_movelh_ps(lo, hi));
+		}
+		return i;
+	}
+	
+	__attribute__((target("avx2")))
+	size_t float64_to_float32_avx2(const float64* in, float32* out, size_t count) {
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(in + i));
+			__m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(in + i + 4));
+			_mm256_storeu_ps(out + i, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+		}
+		return i;
+	}
+	
+	size_t float32_to_float64_sse2(const float32* in, float64* out, size_t count) {
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128 v = _mm_loadu_ps(in + i);
+			_mm_storeu_pd(out + i, _mm_cvtps_pd(v));
+			_mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+		}
+		return i;
+	}
+	
+	__attribute__((target("avx2")))
+	size_t float32_to_float64_avx2(const float32* in, float64* out, size_t count) {
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			_mm256_storeu_pd(out + i, _mm256_cvtps_pd(_mm_loadu_ps(in + i)));
+		}
+		return i;
+	}
+	
+	size_t int64_to_int32_sse2(const int64* in, int32* out, size_t count) {
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			// Move the low halves of both 64-bit lanes to the bottom of each register.
+			__m128i a = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), _MM_SHUFFLE(3, 1, 2, 0));
+			__m128i b = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 2)), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi64(a, b));
+		}
+		return i;
+	}
+	
+	__attribute__((target("avx2")))
+	size_t int64_to_int32_avx2(const int64* in, int32* out, size_t count) {
+		const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m256i v = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), low_halves);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(v));
+		}
+		return i;
+	}
+	
+	size_t int32_to_int64_sse2(const int32* in, int64* out, size_t count) {
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			// SSE2 has no sign extension, so interleave with the sign bits.
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			__m128i sign = _mm_srai_epi32(v, 31);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi32(v, sign));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 2), _mm_unpackhi_epi32(v, sign));
+		}
+		return i;
+	}
+	
+	__attribute__((target("avx2")))
+	size_t int32_to_int64_avx2(const int32* in, int64* out, size_t count) {
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m256i v = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+		}
+		return i;
+	}
+#endif
+}
+
+bool cpu_has_avx2() {
+#if defined(USE_X86_SIMD)
+	static const bool result = __builtin_cpu_supports("avx2");
+	return result;
+#else
+	return false;
+#endif
+}
+
+#if defined(USE_X86_SIMD)
+#define CONVERT_WITH_KERNELS(NAME, IN, OUT, COUNT) \
+	size_t done = cpu_has_avx2() ? NAME##_avx2(IN, OUT, COUNT) : NAME##_sse2(IN, OUT, COUNT); \
+	convert_scalar(IN + done, OUT + done, COUNT - done);
+#else
+#define CONVERT_WITH_KERNELS(NAME, IN, OUT, COUNT) \
+	convert_scalar(IN, OUT, COUNT);
+#endif
+
+void convert_float64_to_float32(const float64* in, float32* out, size_t count) {
+	CONVERT_WITH_KERNELS(float64_to_float32, in, out, count)
+}
+
+void convert_float32_to_float64(const float32* in, float64* out, size_t count) {
+	CONVERT_WITH_KERNELS(float32_to_float64, in, out, count)
+}
+
+void convert_int64_to_int32(const int64* in, int32* out, size_t count) {
+	CONVERT_WITH_KERNELS(int64_to_int32, in, out, count)
+}
+
+void convert_int32_to_int64(const int32* in, int64* out, size_t count) {
+	CONVERT_WITH_KERNELS(int32_to_int64, in, out, count)
+}
@@ -0,0 +1,18 @@
+#pragma once
+#ifndef SIMD_HPP_7DX2MNWE
+#define SIMD_HPP_7DX2MNWE
+
+#include "base/basic.hpp"
+
+// Whether the AVX2 kernels may be used. Always false when built without x86 SIMD support.
+bool cpu_has_avx2();
+
+// Bulk numeric conversions. These use AVX2 or SSE2 when the CPU has them, and
+// plain loops otherwise (or when built with NO_SIMD).
+// Narrowing integers truncates, like a static_cast.
+void convert_float64_to_float32(const float64* in, float32* out, size_t count);
+void convert_float32_to_float64(const float32* in, float64* out, size_t count);
+void convert_int64_to_int32(const int64* in, int32* out, size_t count);
+void convert_int32_to_int64(const int32* in, int64* out, size_t count);
+
+#endif /* end of include guard: SIMD_HPP_7DX2MNWE */
@@ -0,0 +1,149 @@
+#include "base/symbol.hpp"
+#include <atomic>
+#include <mutex>
+
+struct Symbol::Entry {
+	std::string string;
+	size_t hash;
+	bool local;
+};
+
+// Open addressing over the entries, which are never removed. Lookups probe the slots
+// without locking. Adding takes the mutex, and a table that is half full is copied into
+// one twice the size. Outgrown slots are kept, since a lookup may still be probing them.
+struct SymbolTable {
+	struct Slots {
+		size_t mask;
+		std::atomic<const Symbol::Entry*>* entries;
+	};
+	
+	std::mutex mutex;
+	std::atomic<Slots*> slots;
+	size_t count;
+	
+	SymbolTable() : slots(make_slots(1024)), count(0) {}
+	
+	static Slots* make_slots(size_t capacity) {
+		Slots* s = new Slots{capacity - 1, new std::atomic<const Symbol::Entry*>[capacity]};
+		for (size_t i = 0; i < capacity; ++i) {
+			s->entries[i].store(nullptr, std::memory_order_relaxed);
+		}
+		return s;
+	}
+	
+	static const Symbol::Entry* find(const Slots& s, const std::string& string, size_t hash) {
+		for (size_t i = hash & s.mask;; i = (i + 1) & s.mask) {
+			const Symbol::Entry* entry = s.entries[i].load(std::memory_order_acquire);
+			if (entry == nullptr) return nullptr;
+			if (entry->hash == hash && entry->string == string) return entry;
+		}
+	}
+	
+	static void insert(Slots& s, const Symbol::Entry* entry) {
+		size_t i = entry->hash & s.mask;
+		while (s.entries[i].load(std::memory_order_relaxed) != nullptr) {
+			i = (i + 1) & s.mask;
+		}
+		s.entries[i].store(entry, std::memory_order_release);
+	}
+	
+	const Symbol::Entry* find(const std::string& string, size_t hash) const {
+		return find(*slots.load(std::memory_order_acquire), string, hash);
+	}
+	
+	// Called with the mutex held.
+	const Symbol::Entry* add(const std::string& string, size_t hash) {
+		Slots* s = slots.load(std::memory_order_relaxed);
+		if (const Symbol::Entry* entry = find(*s, string, hash)) return entry;
+		if (2 * (count + 1) > s->mask + 1) {
+			Slots* bigger = make_slots(2 * (s->mask + 1));
+			for (size_t i = 0; i <= s->mask; ++i) {
+				const Symbol::Entry* entry = s->entries[i].load(std::memory_order_relaxed);
+				if (entry != nullptr) insert(*bigger, entry);
+			}
+			slots.store(bigger, std::memory_order_release);
+			s = bigger;
+		}
+		const Symbol::Entry* entry = new Symbol::Entry{string, hash, false};
+		insert(*s, entry);
+		++count;
+		return entry;
+	}
+};
+
+namespace {
+	SymbolTable& symbol_table() {
+		static SymbolTable* table = new SymbolTable; // Never destroyed, so symbols stay valid during exit.
+		return *table;
+	}
+	
+	const std::string& empty_string() {
+		static const std::string* empty = new std::string;
+		return *empty;
+	}
+}
+
+Symbol::Symbol(const std::string& s) : entry_(nullptr) {
+	if (s.empty()) return;
+	size_t hash = std::hash<std::string>()(s);
+	SymbolTable& table = symbol_table();
+	entry_ = table.find(s, hash);
+	if (entry_ == nullptr) {
+		std::lock_guard<std::mutex> lock(table.mutex);
+		entry_ = table.add(s, hash);
+	}
+}
+
+bool Symbol::find(const std::string& s, Symbol& out) {
+	if (s.empty()) {
+		out = Symbol();
+		return true;
+	}
+	const Entry* entry = symbol_table().find(s, std::hash<std::string>()(s));
+	if (entry == nullptr) return false;
+	out = Symbol(entry);
+	return true;
+}
+
+const std::string& Symbol::str() const {
+	return entry_ ? entry_->string : empty_string();
+}
+
+size_t Symbol::hash() const {
+	return entry_ ? entry_->hash : 0;
+}
+
+bool Symbol::is_local() const {
+	return entry_ && entry_->local;
+}
+
+Symbol LocalSymbolTable::get(const std::string& s) {
+	Symbol symbol;
+	if (find(s, symbol)) return symbol;
+	const Symbol::Entry*& entry = entries_[s];
+	entry = new Symbol::Entry{s, std::hash<std::string>()(s), true};
+	return Symbol(entry);
+}
+
+bool LocalSymbolTable::find(const std::string& s, Symbol& out) const {
+	if (!entries_.empty()) {
+		auto it = entries_.find(s);
+		if (it != entries_.end()) {
+			out = Symbol(it->second);
+			return true;
+		}
+	}
+	return Symbol::find(s, out);
+}
+
+Symbol LocalSymbolTable::find_local(Symbol symbol) const {
+	auto it = entries_.find(symbol.str());
+	return it != entries_.end() ? Symbol(it->second) : symbol;
+}
+
+void LocalSymbolTable::clear() {
+	for (auto& it: entries_) {
+		delete it.second;
+	}
+	entries_.clear();
+}
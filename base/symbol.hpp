@@ -0,0 +1,73 @@
+#pragma once
+#ifndef SYMBOL_HPP_R5TW9XJC
+#define SYMBOL_HPP_R5TW9XJC
+
+#include "base/basic.hpp"
+#include <string>
+#include <functional>
+#include <unordered_map>
+
+// An interned string. Symbols with the same text share one entry, which lives as long
+// as the process, so they compare and copy as a pointer and carry their hash. Interning
+// is thread-safe, and looking up a symbol that has been interned takes no lock.
+class Symbol {
+public:
+	// The empty string.
+	Symbol() : entry_(nullptr) {}
+	explicit Symbol(const std::string& s);
+	explicit Symbol(const char* s) : Symbol(std::string(s)) {}
+	
+	// Sets 'out' to the symbol for 's' if it has been interned, without interning it.
+	static bool find(const std::string& s, Symbol& out);
+	// The symbol for 's' if it has been interned, or else the empty symbol. For names read
+	// from documents, which should not grow the table.
+	static Symbol lookup(const std::string& s) { Symbol out; find(s, out); return out; }
+	
+	const std::string& str() const;
+	size_t hash() const;
+	bool empty() const { return entry_ == nullptr; }
+	// Whether the symbol belongs to a LocalSymbolTable rather than the global table.
+	bool is_local() const;
+	
+	bool operator==(Symbol other) const { return entry_ == other.entry_; }
+	bool operator!=(Symbol other) const { return entry_ != other.entry_; }
+private:
+	friend struct SymbolTable;
+	friend class LocalSymbolTable;
+	struct Entry;
+	explicit Symbol(const Entry* entry) : entry_(entry) {}
+	
+	const Entry* entry_;
+};
+
+// Symbols for names that should not stay in the global table, such as the keys read from
+// a document. A local symbol is not equal to a global one with the same text, so names
+// that are global already are not added, and lookups look here first.
+class LocalSymbolTable {
+public:
+	LocalSymbolTable() {}
+	LocalSymbolTable(const LocalSymbolTable&) = delete;
+	~LocalSymbolTable() { clear(); }
+	
+	// The symbol for 's' here or in the global table, or else a new one here.
+	Symbol get(const std::string& s);
+	// Sets 'out' to the symbol for 's' here or in the global table, without adding it.
+	bool find(const std::string& s, Symbol& out) const;
+	// The symbol here with the text of 'symbol', or else 'symbol' itself.
+	Symbol canonical(Symbol symbol) const { return entries_.empty() || symbol.empty() ? symbol : find_local(symbol); }
+	bool empty() const { return entries_.empty(); }
+	// Forgets the symbols here, which must no longer be in use.
+	void clear();
+private:
+	Symbol find_local(Symbol symbol) const;
+	std::unordered_map<std::string, const Symbol::Entry*> entries_;
+};
+
+namespace std {
+	template <>
+	struct hash<Symbol> {
+		size_t operator()(Symbol s) const { return s.hash(); }
+	};
+}
+
+#endif /* end of include guard: SYMBOL_HPP_R5TW9XJC */
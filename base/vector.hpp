@@ -0,0 +1,34 @@
+#pragma once
+#ifndef VECTOR_HPP_Q3ZL7T1C
+#define VECTOR_HPP_Q3ZL7T1C
+
+#include "base/basic.hpp"
+
+// Small fixed-size vector. Always 16-byte aligned, so every vector fills one SIMD register.
+template <typename T, size_t N>
+struct alignas(16) Vector {
+	static_assert(N >= 2 && N <= 4, "Vectors have 2 to 4 components.");
+	typedef T ComponentType;
+	static const size_t NumComponents = N;
+	
+	T components[N];
+	
+	T& operator[](size_t idx) { ASSERT(idx < N); return components[idx]; }
+	const T& operator[](size_t idx) const { ASSERT(idx < N); return components[idx]; }
+	bool operator==(const Vector<T, N>& other) const {
+		for (size_t i = 0; i < N; ++i) {
+			if (components[i] != other.components[i]) return false;
+		}
+		return true;
+	}
+	bool operator!=(const Vector<T, N>& other) const { return !(*this == other); }
+};
+
+typedef Vector<float32, 2> vec2;
+typedef Vector<float32, 3> vec3;
+typedef Vector<float32, 4> vec4;
+typedef Vector<int32, 2> ivec2;
+typedef Vector<int32, 3> ivec3;
+typedef Vector<int32, 4> ivec4;
+
+#endif /* end of include guard: VECTOR_HPP_Q3ZL7T1C */
@@ -1,11 +1,51 @@
 #include "object/child_list.hpp"
 #include "serialization/deserialize_object.hpp"
 #include "serialization/serialize.hpp"
+#include "object/universe.hpp"
+#include "serialization/archive.hpp"
+#include "serialization/archive_reader.hpp"
+#include <thread>
+
+namespace {
+	// Below this many children per thread, starting a thread costs more than it saves.
+	const size_t MinChildrenPerThread = 16;
+	
+	// Deserializes children [begin, end) of the array 'reader' is at into 'out'. The reader keeps their
+	// references and signals, so each thread has its own.
+	void deserialize_children(size_t begin, size_t end, ObjectPtr<>* out, ArchiveNodeReader& reader, IUniverse& universe) {
+		reader.begin_array();
+		for (size_t i = 0; i < begin; ++i) {
+			reader.next_element();
+			reader.skip();
+		}
+		for (size_t i = begin; i < end && reader.next_element(); ++i) {
+			out[i] = deserialize_object(reader, universe);
+		}
+	}
+	
+	// Serializes children [begin, end) of 'list' into nodes of 'archive'.
+	void serialize_children(const ChildList& list, size_t begin, size_t end, ArchiveNode** out, Archive& archive, IUniverse& universe) {
+		for (size_t i = begin; i < end; ++i) {
+			out[i] = archive.make();
+			::serialize(*list[i], *out[i], universe);
+		}
+	}
+}
 
 void ChildListType::deserialize(ChildList& list, const ArchiveNode& node, IUniverse& universe) const {
 	if (node.is_array()) {
+		IObjectLoader* loader = universe.object_loader();
+		size_t num_threads = std::min(node.archive().deserialize_threads(), node.array_size() / MinChildrenPerThread);
+		if (loader == nullptr && num_threads > 1) {
+			deserialize_parallel(list, node, universe, num_threads);
+			return;
+		}
 		for (size_t i = 0; i < node.array_size(); ++i) {
 			const ArchiveNode& child = node[i];
+			if (loader != nullptr && loader->defer(child, list, list.size())) {
+				list.push_back(nullptr);
+				continue;
+			}
 			ObjectPtr<> ptr = deserialize_object(child, universe);
 			if (ptr != nullptr) {
 				list.push_back(std::move(ptr));
@@ -14,9 +54,100 @@ void ChildListType::deserialize(ChildList& list, const ArchiveNode& node, IUnive
 	}
 }
 
+void ChildListType::deserialize_parallel(ChildList& list, const ArchiveNode& node, IUniverse& universe, size_t num_threads) const {
+	// Each thread takes a contiguous run of children, and the calling thread takes the first.
+	size_t n = node.array_size();
+	Array<ObjectPtr<>> children;
+	children.resize(n, nullptr);
+	Array<ArchiveNodeReader*> readers;
+	Array<std::thread*> threads;
+	for (size_t t = 0; t < num_threads; ++t) {
+		readers.push_back(new ArchiveNodeReader(node));
+	}
+	for (size_t t = 1; t < num_threads; ++t) {
+		ArchiveNodeReader* reader = readers[t];
+		size_t begin = n * t / num_threads;
+		size_t end = n * (t + 1) / num_threads;
+		threads.push_back(new std::thread([begin, end, &children, reader, &universe]() {
+			deserialize_children(begin, end, &children[0], *reader, universe);
+		}));
+	}
+	deserialize_children(0, n / num_threads, &children[0], *readers[0], universe);
+	for (auto thread: threads) {
+		thread->join();
+		delete thread;
+	}
+	
+	// Merged in order, so references resolve the same way as when loading on one thread.
+	for (auto reader: readers) {
+		reader->move_deferred_to(node.archive());
+		delete reader;
+	}
+	for (auto& child: children) {
+		if (child != nullptr) {
+			list.push_back(std::move(child));
+		}
+	}
+}
+
+void ChildListType::deserialize(ChildList& list, ArchiveReader& reader, IUniverse& universe) const {
+	if (!reader.begin_array()) return;
+	while (reader.next_element()) {
+		ObjectPtr<> ptr = deserialize_object(reader, universe);
+		if (ptr != nullptr) {
+			list.push_back(std::move(ptr));
+		}
+	}
+}
+
 void ChildListType::serialize(const ChildList& list, ArchiveNode& node, IUniverse& universe) const {
+	size_t num_threads = std::min(node.archive().serialize_threads(), list.size() / MinChildrenPerThread);
+	if (num_threads > 1) {
+		serialize_parallel(list, node, universe, num_threads);
+		return;
+	}
 	for (auto& child: list) {
 		ArchiveNode& child_node = node.array_push();
 		::serialize(*child, child_node, universe);
 	}
-}
\ No newline at end of file
+}
+
+void ChildListType::serialize_parallel(const ChildList& list, ArchiveNode& node, IUniverse& universe, size_t num_threads) const {
+	// Each thread builds a contiguous run of children in a fragment of the archive, and the
+	// calling thread builds the first run in the archive itself.
+	Archive& archive = node.archive();
+	size_t n = list.size();
+	Array<ArchiveNode*> children;
+	children.resize(n, nullptr);
+	Array<Archive*> fragments;
+	Array<std::thread*> threads;
+	for (size_t t = 1; t < num_threads; ++t) {
+		Archive* fragment = &archive.make_fragment();
+		fragments.push_back(fragment);
+		size_t begin = n * t / num_threads;
+		size_t end = n * (t + 1) / num_threads;
+		threads.push_back(new std::thread([&list, begin, end, &children, fragment, &universe]() {
+			serialize_children(list, begin, end, &children[0], *fragment, universe);
+		}));
+	}
+	serialize_children(list, 0, n / num_threads, &children[0], archive, universe);
+	for (auto thread: threads) {
+		thread->join();
+		delete thread;
+	}
+	
+	for (auto fragment: fragments) {
+		archive.merge_fragment(*fragment);
+	}
+	for (auto child: children) {
+		node.array_append(*child);
+	}
+}
+
+void ChildListType::serialize(const ChildList& list, ArchiveWriter& writer, IUniverse& universe) const {
+	writer.begin_array();
+	for (auto& child: list) {
+		::serialize(*child, writer, universe);
+	}
+	writer.end_array();
+}
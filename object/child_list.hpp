@@ -17,7 +17,12 @@ struct ChildListType : VariableLengthArrayType<ChildList> {
 	ChildListType() : VariableLengthArrayType("ChildList") {}
 	virtual ~ChildListType() {}
 	void deserialize(ChildList& place, const ArchiveNode& node, IUniverse&) const;
+	void deserialize(ChildList& place, ArchiveReader& reader, IUniverse&) const override;
 	void serialize(const ChildList& place, ArchiveNode& node, IUniverse&) const override;
+	void serialize(const ChildList& place, ArchiveWriter& writer, IUniverse&) const override;
+private:
+	void deserialize_parallel(ChildList& place, const ArchiveNode& node, IUniverse&, size_t num_threads) const;
+	void serialize_parallel(const ChildList& place, ArchiveNode& node, IUniverse&, size_t num_threads) const;
 };
 
 template <>
@@ -1,15 +1,93 @@
 #include "object/composite_type.hpp"
 #include "object/struct_type.hpp"
+#include <algorithm>
+#include <map>
 
-CompositeType::CompositeType(std::string name, const ObjectTypeBase* base_type) : base_type_(base_type), name_(std::move(name)), frozen_(false) {
-	size_ = this->base_type()->size();
+namespace {
+	inline size_t align_up(size_t offset, size_t alignment) {
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+}
+
+CompositeType::CompositeType(std::string name, const ObjectTypeBase* base_type) : DerivedType(TypeKind::Composite), base_type_(base_type), name_(std::move(name)), frozen_(false), size_(0), alignment_(1) {
 }
 
-void CompositeType::add_aspect(const DerivedType* aspect) {
+void CompositeType::add_aspect(const DerivedType* aspect, bool hot) {
 	ASSERT(!frozen_);
 	ASSERT(!aspect->is_abstract());
 	aspects_.push_back(aspect); // TODO: Check for circular dependencies.
-	size_ += aspect->size();
+	hot_aspects_.push_back(hot);
+}
+
+void CompositeType::freeze() {
+	if (frozen_) return;
+	
+	// The base object is always at offset 0, since the composite is accessed through it.
+	size_t offset = base_type()->size();
+	size_t alignment = base_type()->alignment();
+	offsets_.clear();
+	offsets_.reserve(aspects_.size());
+	for (size_t i = 0; i < aspects_.size(); ++i) {
+		const DerivedType* aspect = aspects_[i];
+		ASSERT(aspect->kind() != TypeKind::Composite || static_cast<const CompositeType*>(aspect)->is_frozen());
+		size_t aspect_alignment = aspect->alignment();
+		if (hot_aspects_[i] && aspect_alignment < CacheLineSize) {
+			aspect_alignment = CacheLineSize;
+		}
+		offset = align_up(offset, aspect_alignment);
+		offsets_.push_back(offset);
+		offset += aspect->size();
+		if (hot_aspects_[i]) {
+			offset = align_up(offset, CacheLineSize);
+		}
+		if (aspect_alignment > alignment) alignment = aspect_alignment;
+	}
+	
+	size_ = align_up(offset, alignment);
+	alignment_ = alignment;
+	build_instance_index();
+	frozen_ = true;
+}
+
+void CompositeType::build_instance_index() {
+	// Flatten in the same order as search_instance_down visits objects.
+	instances_.clear();
+	instances_.push_back(Instance{base_type(), 0});
+	for (size_t i = 0; i < aspects_.size(); ++i) {
+		const DerivedType* aspect = aspects_[i];
+		if (aspect->kind() == TypeKind::Composite) {
+			for (auto& it: static_cast<const CompositeType*>(aspect)->instances_) {
+				instances_.push_back(Instance{it.type, offsets_[i] + it.offset});
+			}
+		} else if (aspect->kind() == TypeKind::Object) {
+			instances_.push_back(Instance{static_cast<const ObjectTypeBase*>(aspect), offsets_[i]});
+		}
+	}
+	
+	// Index every type an instance can be cast to, keeping the first instance found for each.
+	std::map<uint32, size_t> first_offsets;
+	for (auto& it: instances_) {
+		for (auto ancestor: it.type->ancestors()) {
+			first_offsets.insert(std::make_pair(ancestor->type_id(), it.offset));
+		}
+		first_offsets.insert(std::make_pair(it.type->type_id(), it.offset));
+	}
+	instance_index_.clear();
+	instance_index_.reserve(first_offsets.size());
+	for (auto& it: first_offsets) {
+		instance_index_.push_back(IndexEntry{it.first, it.second});
+	}
+}
+
+bool CompositeType::find_instance_offset(const ObjectTypeBase* type, size_t& out_offset) const {
+	ASSERT(frozen_);
+	IndexEntry key{type->type_id(), 0};
+	auto it = std::lower_bound(instance_index_.begin(), instance_index_.end(), key);
+	if (it != instance_index_.end() && it->type_id == key.type_id) {
+		out_offset = it->offset;
+		return true;
+	}
+	return false;
 }
 
 const ObjectTypeBase* CompositeType::base_type() const {
@@ -32,17 +110,38 @@ Object* CompositeType::cast(const DerivedType* to, Object* o, const DerivedType*
 }
 
 Object* CompositeType::find_instance_down(const DerivedType* to, Object* o, const DerivedType* avoid) const {
+	// Where an instance of an object type lives inside a frozen composite only depends
+	// on the composite's layout, so it can be looked up in the flattened instance index
+	// and cached per target type. Casts to composite types look at the enclosing objects
+	// as well, so they still do a full search.
+	// The 'avoid' parameter never changes the result, because it is only given when the
+	// avoided composite has already been searched without success.
+	if (!frozen_ || to->kind() != TypeKind::Object) {
+		return search_instance_down(to, o, avoid);
+	}
+	
+	int32 offset;
+	if (!cast_cache_.lookup(to->type_id(), offset)) {
+		size_t instance_offset;
+		offset = find_instance_offset(static_cast<const ObjectTypeBase*>(to), instance_offset) ? int32(instance_offset) : CastCache::NotFound;
+		cast_cache_.insert(to->type_id(), offset);
+	}
+	if (offset == CastCache::NotFound) return nullptr;
+	return reinterpret_cast<Object*>(reinterpret_cast<byte*>(o) + offset);
+}
+
+Object* CompositeType::search_instance_down(const DerivedType* to, Object* o, const DerivedType* avoid) const {
 	// First check the base type
 	Object* result = base_type()->cast(to, o);
 	if (result != nullptr) return result;
 	
 	// Then do breadth-first search of aspects
-	size_t offset = base_type()->size();
-	for (auto& aspect: aspects_) {
-		Object* aspect_object = reinterpret_cast<Object*>(reinterpret_cast<byte*>(o) + offset);
+	for (size_t i = 0; i < aspects_.size(); ++i) {
+		const DerivedType* aspect = aspects_[i];
+		Object* aspect_object = reinterpret_cast<Object*>(reinterpret_cast<byte*>(o) + offsets_[i]);
 		
-		const CompositeType* composite_aspect = dynamic_cast<const CompositeType*>(aspect);
-		if (composite_aspect != nullptr) {
+		if (aspect->kind() == TypeKind::Composite) {
+			const CompositeType* composite_aspect = static_cast<const CompositeType*>(aspect);
 			if (composite_aspect != avoid) {
 				Object* result = composite_aspect->find_instance_down(to, aspect_object, nullptr);
 				if (result != nullptr) return result;
@@ -51,7 +150,6 @@ Object* CompositeType::find_instance_down(const DerivedType* to, Object* o, cons
 			Object* result = aspect->cast(to, aspect_object);
 			if (result != nullptr) return result;
 		}
-		offset += aspect->size();
 	}
 	
 	return nullptr; // not found
@@ -61,9 +159,8 @@ Object* CompositeType::find_instance_up(const DerivedType* to, Object* object, c
 	Object* o = object->find_parent();
 	if (o != nullptr) {
 		const DerivedType* t = o->object_type();
-		const CompositeType* ct = dynamic_cast<const CompositeType*>(t);
-		if (ct != nullptr) {
-			return ct->cast(to, o, this);
+		if (t->kind() == TypeKind::Composite) {
+			return static_cast<const CompositeType*>(t)->cast(to, o, this);
 		} else {
 			return t->cast(to, o);
 		}
@@ -87,29 +184,51 @@ Object* CompositeType::find_self_up(Object* object) const {
 
 
 void CompositeType::construct(byte* place, IUniverse& universe) const {
+	ASSERT(frozen_);
 	base_type()->construct(place, universe);
 	Object* obj = reinterpret_cast<Object*>(place);
 	obj->set_object_type__(this);
-	size_t offset = base_type()->size();
-	for (auto aspect: aspects_) {
-		aspect->construct(place + offset, universe);
+	for (size_t i = 0; i < aspects_.size(); ++i) {
+		size_t offset = offsets_[i];
+		aspects_[i]->construct(place + offset, universe);
 		Object* subobject = reinterpret_cast<Object*>(place + offset);
 		subobject->set_object_offset__(offset);
-		subobject->set_object_id(aspect->name()); // might be renamed later by deserialization
-		offset += aspect->size();
+		subobject->set_object_id(aspects_[i]->name()); // might be renamed later by deserialization
 	}
-	ASSERT(offset == size_);
 }
 
 void CompositeType::destruct(byte* place, IUniverse& universe) const {
-	Object* obj = reinterpret_cast<Object*>(place);
-	size_t offset = base_type()->size();
-	for (auto aspect: aspects_) { // TODO: Consider doing this backwards?
-		aspect->destruct(place + offset, universe);
-		offset += aspect->size();
+	ASSERT(frozen_);
+	for (size_t i = 0; i < aspects_.size(); ++i) { // TODO: Consider doing this backwards?
+		aspects_[i]->destruct(place + offsets_[i], universe);
 	}
 	base_type()->destruct(place, universe);
-	ASSERT(offset == size_);
+}
+
+void CompositeType::construct_n(byte* place, size_t count, size_t stride, IUniverse& universe) const {
+	// Construct one part of the composite at a time across all instances, so every
+	// aspect type is dispatched once per batch instead of once per object.
+	ASSERT(frozen_);
+	base_type()->construct_n(place, count, stride, universe);
+	for (size_t k = 0; k < count; ++k) {
+		reinterpret_cast<Object*>(place + k * stride)->set_object_type__(this);
+	}
+	for (size_t i = 0; i < aspects_.size(); ++i) {
+		size_t offset = offsets_[i];
+		aspects_[i]->construct_n(place + offset, count, stride, universe);
+		// Aspects are left unnamed; IUniverse::create_objects names them with the base objects.
+		for (size_t k = 0; k < count; ++k) {
+			reinterpret_cast<Object*>(place + k * stride + offset)->set_object_offset__(offset);
+		}
+	}
+}
+
+void CompositeType::destruct_n(byte* place, size_t count, size_t stride, IUniverse& universe) const {
+	ASSERT(frozen_);
+	for (size_t i = 0; i < aspects_.size(); ++i) {
+		aspects_[i]->destruct_n(place + offsets_[i], count, stride, universe);
+	}
+	base_type()->destruct_n(place, count, stride, universe);
 }
 
 void CompositeType::deserialize(byte* place, const ArchiveNode& node, IUniverse& universe) const {
@@ -118,16 +237,15 @@ void CompositeType::deserialize(byte* place, const ArchiveNode& node, IUniverse&
 	
 	const ArchiveNode& aspect_array = node["aspects"];
 	if (aspect_array.is_array()) {
-		size_t offset = base_type()->size();
 		size_t sz = aspect_array.array_size();
-		for (size_t i = 0; i < aspect_array.array_size(); ++i) {
+		ASSERT(sz <= aspects_.size());
+		for (size_t i = 0; i < sz; ++i) {
 			const ArchiveNode& aspect_node = aspect_array[i];
+			size_t offset = offsets_[i];
 			aspects_[i]->deserialize(place + offset, aspect_node, universe);
 			Object* subobject = reinterpret_cast<Object*>(place + offset);
 			subobject->set_object_offset__(offset);
-			offset += aspects_[i]->size();
 		}
-		ASSERT(offset == size_);
 	}
 }
 
@@ -136,12 +254,56 @@ void CompositeType::serialize(const byte* place, ArchiveNode& node, IUniverse& u
 	base_type()->serialize(place, node, universe);
 	node["class"] = base_type()->name();
 	
-	size_t offset = base_type()->size();
 	ArchiveNode& aspect_array = node["aspects"];
-	for (auto aspect: aspects_) {
+	for (size_t i = 0; i < aspects_.size(); ++i) {
 		ArchiveNode& aspect_node = aspect_array.array_push();
-		aspect->serialize(place + offset, aspect_node, universe);
-		offset += aspect->size();
+		aspects_[i]->serialize(place + offsets_[i], aspect_node, universe);
 	}
-	ASSERT(offset == size_);
-}
\ No newline at end of file
+}
+
+void CompositeType::serialize(const byte* place, ArchiveWriter& writer, IUniverse& universe) const {
+	ASSERT(frozen_);
+	// The class and aspects decide the type, so they come before the properties.
+	writer.begin_map();
+	writer.key("class");
+	writer.value(base_type()->name());
+	
+	writer.key("aspects");
+	writer.begin_array();
+	for (size_t i = 0; i < aspects_.size(); ++i) {
+		aspects_[i]->serialize(place + offsets_[i], writer, universe);
+	}
+	writer.end_array();
+	
+	base_type()->serialize_properties(place, writer, universe);
+	writer.end_map();
+}
+
+void CompositeType::deserialize(byte* place, ArchiveReader& reader, IUniverse& universe) const {
+	ASSERT(frozen_);
+	if (!reader.begin_map()) return;
+	std::string key;
+	while (reader.next_key(key)) {
+		if (key == "aspects") {
+			deserialize_aspects(place, reader, universe);
+		} else if (!base_type()->deserialize_field(place, key, reader, universe)) {
+			reader.skip();
+		}
+	}
+}
+
+void CompositeType::deserialize_aspects(byte* place, ArchiveReader& reader, IUniverse& universe) const {
+	if (!reader.begin_array()) return;
+	size_t i = 0;
+	while (reader.next_element()) {
+		if (i < aspects_.size()) {
+			size_t offset = offsets_[i];
+			aspects_[i]->deserialize(place + offset, reader, universe);
+			Object* subobject = reinterpret_cast<Object*>(place + offset);
+			subobject->set_object_offset__(offset);
+			++i;
+		} else {
+			reader.skip();
+		}
+	}
+}
@@ -5,27 +5,52 @@
 #include "type/type.hpp"
 #include "serialization/archive.hpp"
 #include "base/array.hpp"
+#include "type/cast_cache.hpp"
 #include <new>
 
 struct CompositeType : DerivedType {
+	static const size_t CacheLineSize = 64;
+	
+	// An object within the composite (the base object, or an aspect at any depth) and its offset from the base object.
+	struct Instance {
+		const ObjectTypeBase* type;
+		size_t offset;
+	};
+	
 	CompositeType(std::string name, const ObjectTypeBase* base_type = nullptr);
 	
 	const ObjectTypeBase* base_type() const;
-	void add_aspect(const DerivedType* aspect);
-	void freeze() { frozen_ = true; }
+	// Hot aspects get cache lines of their own, so they don't share lines with neighbouring aspects.
+	void add_aspect(const DerivedType* aspect, bool hot = false);
+	void freeze();
+	bool is_frozen() const { return frozen_; }
 	
 	// Type interface
 	void construct(byte* place, IUniverse&) const override;
 	void destruct(byte* place, IUniverse&) const override;
+	void construct_n(byte* place, size_t count, size_t stride, IUniverse&) const override;
+	void destruct_n(byte* place, size_t count, size_t stride, IUniverse&) const override;
 	void deserialize(byte* place, const ArchiveNode& node, IUniverse&) const override;
 	void serialize(const byte* place, ArchiveNode& node, IUniverse&) const override;
+	void serialize(const byte* place, ArchiveWriter& writer, IUniverse&) const override;
+	void deserialize(byte* place, ArchiveReader& reader, IUniverse&) const override;
+	// Reads the "aspects" array into the aspects of the object at 'place'.
+	void deserialize_aspects(byte* place, ArchiveReader& reader, IUniverse&) const;
 	const std::string& name() const override { return name_; }
 	size_t size() const override { return size_; }
+	size_t alignment() const override { return alignment_; }
 	
 	// DerivedType interface
 	size_t num_elements() const { return aspects_.size(); }
-	size_t offset_of_element(size_t idx) const;
+	size_t offset_of_element(size_t idx) const { ASSERT(frozen_); return offsets_[idx]; }
 	const Type* type_of_element(size_t idx) const { return aspects_[idx]; }
+	const DerivedType* aspect_at(size_t idx) const { return aspects_[idx]; }
+	bool is_hot_aspect(size_t idx) const { return hot_aspects_[idx]; }
+	
+	// All objects in the composite in search order, with nested composites flattened. Requires freeze().
+	const Array<Instance>& instances() const { ASSERT(frozen_); return instances_; }
+	// Finds the first instance of 'type' or any of its subtypes anywhere in the composite.
+	bool find_instance_offset(const ObjectTypeBase* type, size_t& out_offset) const;
 	
 	Object* cast(const DerivedType* to, Object* o) const override;
 	Object* find_instance_down(const DerivedType* of_type, Object* o, const DerivedType* avoid = nullptr) const;
@@ -33,22 +58,28 @@ struct CompositeType : DerivedType {
 	Object* find_self_up(Object* o) const;
 private:
 	Object* cast(const DerivedType* to, Object* o, const DerivedType* avoid) const;
+	Object* search_instance_down(const DerivedType* of_type, Object* o, const DerivedType* avoid) const;
+	void build_instance_index();
+	
+	struct IndexEntry {
+		uint32 type_id;
+		size_t offset;
+		bool operator<(const IndexEntry& other) const { return type_id < other.type_id; }
+	};
 	
 	const ObjectTypeBase* base_type_;
 	std::string name_;
 	Array<const DerivedType*> aspects_;
+	Array<bool> hot_aspects_;
 	bool frozen_;
+	
+	// Computed by freeze():
+	Array<size_t> offsets_;
 	size_t size_;
+	size_t alignment_;
+	Array<Instance> instances_;
+	Array<IndexEntry> instance_index_; // sorted by type ID
+	mutable CastCache cast_cache_;
 };
 
-inline size_t CompositeType::offset_of_element(size_t idx) const {
-	size_t offset = sizeof(Object);
-	for (size_t i = 0; i < aspects_.size(); ++i) {
-		if (i == idx) return offset;
-		offset += aspects_[i]->size();
-	}
-	ASSERT(false); // unreachable
-	return SIZE_T_MAX;
-}
-
 #endif /* end of include guard: COMPOSITE_TYPE_HPP_K5R3HGBW */
@@ -0,0 +1,74 @@
+#include "object/composite_type_registry.hpp"
+#include "object/composite_type.hpp"
+#include "object/struct_type.hpp"
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+	// Type ID of the base type, followed by the type ID and hotness of each aspect.
+	typedef std::vector<uint32> CompositeKey;
+	
+	void append_aspect_key(CompositeKey& key, const DerivedType* aspect, bool hot) {
+		key.push_back(aspect->type_id() << 1 | (hot ? 1 : 0));
+	}
+}
+
+struct CompositeTypeRegistry::Impl {
+	std::mutex mutex;
+	std::map<CompositeKey, const CompositeType*> composites;
+};
+
+CompositeTypeRegistry::Impl* CompositeTypeRegistry::impl() {
+	static Impl* i = new Impl;
+	return i;
+}
+
+const CompositeType* CompositeTypeRegistry::get(const ObjectTypeBase* base_type, const Array<const DerivedType*>& aspects, std::string name) {
+	if (base_type == nullptr) base_type = get_type<Object>();
+	CompositeKey key;
+	key.reserve(aspects.size() + 1);
+	key.push_back(base_type->type_id());
+	for (auto aspect: aspects) {
+		append_aspect_key(key, aspect, false);
+	}
+	
+	Impl* i = impl();
+	std::lock_guard<std::mutex> lock(i->mutex);
+	auto it = i->composites.find(key);
+	if (it != i->composites.end()) return it->second;
+	
+	CompositeType* type = new CompositeType(std::move(name), base_type);
+	for (auto aspect: aspects) {
+		type->add_aspect(aspect);
+	}
+	type->freeze();
+	i->composites[key] = type;
+	return type;
+}
+
+const CompositeType* CompositeTypeRegistry::intern(CompositeType* type) {
+	type->freeze();
+	CompositeKey key;
+	key.reserve(type->num_elements() + 1);
+	key.push_back(type->base_type()->type_id());
+	for (size_t n = 0; n < type->num_elements(); ++n) {
+		append_aspect_key(key, type->aspect_at(n), type->is_hot_aspect(n));
+	}
+	
+	Impl* i = impl();
+	std::lock_guard<std::mutex> lock(i->mutex);
+	auto it = i->composites.find(key);
+	if (it != i->composites.end()) {
+		if (it->second != type) delete type;
+		return it->second;
+	}
+	i->composites[key] = type;
+	return type;
+}
+
+size_t CompositeTypeRegistry::size() {
+	Impl* i = impl();
+	std::lock_guard<std::mutex> lock(i->mutex);
+	return i->composites.size();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#ifndef COMPOSITE_TYPE_REGISTRY_HPP_3HM7RXQ2
+#define COMPOSITE_TYPE_REGISTRY_HPP_3HM7RXQ2
+
+#include "base/array.hpp"
+#include <string>
+
+struct CompositeType;
+struct DerivedType;
+struct ObjectTypeBase;
+
+// Interns composite types, so that every composition of the same base type and
+// aspect list is represented by a single frozen CompositeType.
+class CompositeTypeRegistry {
+public:
+	// Returns the canonical composite of 'base_type' with 'aspects' (in order), creating it if necessary.
+	static const CompositeType* get(const ObjectTypeBase* base_type, const Array<const DerivedType*>& aspects, std::string name = "Composite");
+	
+	// Freezes 'type' and returns the canonical composite with the same layout. The
+	// registry takes ownership of 'type', and deletes it if an equivalent composite
+	// was already registered.
+	static const CompositeType* intern(CompositeType* type);
+	
+	static size_t size();
+private:
+	CompositeTypeRegistry();
+	struct Impl;
+	static Impl* impl();
+};
+
+#endif /* end of include guard: COMPOSITE_TYPE_REGISTRY_HPP_3HM7RXQ2 */
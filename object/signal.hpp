@@ -6,6 +6,8 @@
 #include "type/type.hpp"
 #include "object/objectptr.hpp"
 #include "serialization/archive_node.hpp"
+#include "serialization/archive_writer.hpp"
+#include "serialization/archive_reader.hpp"
 
 #include <functional>
 #include <sstream>
@@ -57,13 +59,16 @@ struct SignalTypeBase : Type {
 public:
 	virtual const Array<const Type*>& signature() const = 0;
 protected:
+	SignalTypeBase() : Type(TypeKind::Signal) {}
 	static std::string build_signal_name(const Array<const Type*>& signature);
 };
 
 template <typename... Args>
 struct SignalType : TypeFor<Signal<Args...>, SignalTypeBase> {
 	void deserialize(Signal<Args...>& place, const ArchiveNode&, IUniverse&) const;
+	void deserialize(Signal<Args...>& place, ArchiveReader&, IUniverse&) const;
 	void serialize(const Signal<Args...>& place, ArchiveNode&, IUniverse&) const;
+	void serialize(const Signal<Args...>& place, ArchiveWriter&, IUniverse&) const;
 	const std::string& name() const { return name_; }
 	size_t size() const { return sizeof(Signal<Args...>); }
 	const Array<const Type*>& signature() const { return signature_; }
@@ -132,29 +137,58 @@ void Signal<Args...>::connect(std::function<R(Args...)> function) {
 	invokers_.push_back(new FunctionInvoker<R, Args...>(function));
 }
 
+// Unique address per pointer-to-member type, used to identify concrete slot types without RTTI.
+template <typename FunctionType>
+struct MethodTypeTag {
+	static const void* get() { return &tag_; }
+private:
+	static const byte tag_;
+};
+
+template <typename FunctionType>
+const byte MethodTypeTag<FunctionType>::tag_ = 0;
+
 struct SlotAttributeBase {
-	SlotAttributeBase(std::string name, std::string description) : name_(name), description_(description) {}
+	SlotAttributeBase(const std::string& name, std::string description, const void* method_type_tag) : name_(name), description_(std::move(description)), method_type_tag_(method_type_tag) {}
 	virtual ~SlotAttributeBase() {}
-	const std::string& name() const { return name_; }
+	const std::string& name() const { return name_.str(); }
+	Symbol symbol() const { return name_; }
 	const std::string& description() const { return description_; }
 	virtual std::string signature_description() const = 0;
 	const Array<const Type*>& signature() const { return signature_; }
+	const void* method_type_tag() const { return method_type_tag_; }
+	
+	template <typename... Args>
+	bool has_signature() const;
 private:
-	std::string name_;
+	Symbol name_;
 	std::string description_;
+	const void* method_type_tag_;
 protected:
 	Array<const Type*> signature_;
 };
 
+template <typename... Args>
+bool SlotAttributeBase::has_signature() const {
+	Array<const Type*> other;
+	build_signature<Args...>(other);
+	if (other.size() != signature_.size()) return false;
+	for (size_t i = 0; i < other.size(); ++i) {
+		if (other[i] != signature_[i]) return false;
+	}
+	return true;
+}
+
 template <typename T>
 struct SlotForObject {
 	virtual ~SlotForObject() {}
 	virtual const std::string& slot_name() const = 0;
+	virtual const SlotAttributeBase* slot_attribute() const = 0;
 };
 
 template <typename... Args>
 struct SlotWithSignature : SlotAttributeBase {
-	SlotWithSignature(std::string name, std::string description) : SlotAttributeBase(name, description) {
+	SlotWithSignature(std::string name, std::string description, const void* method_type_tag) : SlotAttributeBase(name, description, method_type_tag) {
 		signature_.reserve(sizeof...(Args));
 		build_signature<Args...>(signature_);
 	}
@@ -169,10 +203,10 @@ struct SlotWithSignature : SlotAttributeBase {
 
 template <typename... Args>
 bool Signal<Args...>::connect(ObjectPtr<> ptr, const SlotAttributeBase* slot) {
-	auto slot_with_signature = dynamic_cast<const SlotWithSignature<Args...>*>(slot);
-	if (slot_with_signature == nullptr) {
+	if (!slot->has_signature<Args...>()) {
 		return false;
 	}
+	auto slot_with_signature = static_cast<const SlotWithSignature<Args...>*>(slot);
 	auto invoker = slot_with_signature->create_invoker(ptr);
 	if (invoker == nullptr) {
 		delete invoker;
@@ -186,7 +220,7 @@ template <typename T, typename R, typename... Args>
 struct SlotAttribute : SlotForObject<T>, SlotWithSignature<Args...> {
 	typedef R(T::*FunctionType)(Args...);
 	
-	SlotAttribute(std::string name, std::string description, FunctionType function) : SlotWithSignature<Args...>(name, description), function_(function) {}
+	SlotAttribute(std::string name, std::string description, FunctionType function) : SlotWithSignature<Args...>(name, description, MethodTypeTag<FunctionType>::get()), function_(function) {}
 	
 	FunctionType function_;
 	
@@ -199,6 +233,7 @@ struct SlotAttribute : SlotForObject<T>, SlotWithSignature<Args...> {
 	}
 	
 	const std::string& slot_name() const { return this->name(); }
+	const SlotAttributeBase* slot_attribute() const { return this; }
 };
 
 template <typename... Args>
@@ -211,8 +246,12 @@ void SignalType<Args...>::deserialize(Signal<Args...>& signal, const ArchiveNode
 				const ArchiveNode& slot_node = connection["slot"];
 				std::string receiver;
 				std::string slot;
+				int64 index;
 				if (receiver_node.get(receiver) && slot_node.get(slot)) {
 					node.register_signal_for_deserialization(&signal, receiver, slot);
+				} else if (receiver_node.type() == ArchiveNodeType::Integer && receiver_node.get(index) && index >= 0 && slot_node.get(slot)) {
+					// An index into the document's object table.
+					node.register_signal_for_deserialization(&signal, size_t(index), slot);
 				} else {
 					std::cerr << "WARNING: Invalid signal connection.";
 				}
@@ -223,6 +262,38 @@ void SignalType<Args...>::deserialize(Signal<Args...>& signal, const ArchiveNode
 	}
 }
 
+template <typename... Args>
+void SignalType<Args...>::deserialize(Signal<Args...>& signal, ArchiveReader& reader, IUniverse&) const {
+	if (!reader.begin_array()) return;
+	while (reader.next_element()) {
+		if (!reader.begin_map()) {
+			std::cerr << "WARNING: Non-map signal connection node. Did you forget to write a scene upgrader?\n";
+			continue;
+		}
+		std::string key;
+		std::string receiver;
+		std::string slot;
+		int64 index = -1;
+		bool has_receiver = false;
+		bool has_slot = false;
+		while (reader.next_key(key)) {
+			// The receiver is an ID, or an index into the document's object table.
+			if (key == "receiver" && reader.peek() == ArchiveNodeType::Integer) has_receiver = reader.read(index) && index >= 0;
+			else if (key == "receiver") has_receiver = reader.read(receiver);
+			else if (key == "slot") has_slot = reader.read(slot);
+			else reader.skip();
+		}
+		Arena& arena = reader.fixup_arena();
+		if (has_receiver && has_slot && index >= 0) {
+			reader.register_signal_for_deserialization(arena.make<DeserializeSignal<Signal<Args...>>>(&signal, size_t(index), Symbol::lookup(slot)));
+		} else if (has_receiver && has_slot) {
+			reader.register_signal_for_deserialization(arena.make<DeserializeSignal<Signal<Args...>>>(&signal, arena.copy(receiver), Symbol::lookup(slot)));
+		} else {
+			std::cerr << "WARNING: Invalid signal connection.";
+		}
+	}
+}
+
 template <typename... Args>
 void SignalType<Args...>::serialize(const Signal<Args...>& signal, ArchiveNode& node, IUniverse& universe) const {
 	for (size_t i = 0; i < signal.num_connections(); ++i) {
@@ -238,4 +309,23 @@ void SignalType<Args...>::serialize(const Signal<Args...>& signal, ArchiveNode&
 	}
 }
 
+template <typename... Args>
+void SignalType<Args...>::serialize(const Signal<Args...>& signal, ArchiveWriter& writer, IUniverse& universe) const {
+	writer.begin_array();
+	for (size_t i = 0; i < signal.num_connections(); ++i) {
+		const SlotInvoker<Args...>* invoker = signal.connection_at(i);
+		ObjectPtr<Object> receiver = invoker->receiver();
+		const SlotAttributeBase* slot = invoker->slot();
+		if (receiver != nullptr && slot != nullptr) {
+			writer.begin_map();
+			writer.key("receiver");
+			writer.reference(receiver.get(), universe);
+			writer.key("slot");
+			writer.value(slot->name());
+			writer.end_map();
+		}
+	}
+	writer.end_array();
+}
+
 #endif /* end of include guard: SIGNAL_HPP_IVWSWZJM */
@@ -7,19 +7,32 @@ const ObjectTypeBase* ObjectTypeBase::super() const {
 	return object_type != this ? object_type : nullptr;
 }
 
+void ObjectTypeBase::build_display(const ObjectTypeBase* super) {
+	display_.clear();
+	if (super != nullptr) {
+		display_.reserve(super->display_.size() + 1);
+		display_.insert(super->display_.begin(), super->display_.end());
+		display_.push_back(super);
+	}
+}
+
+void ObjectTypeBase::build_property_names(const ObjectTypeBase* super, const Array<Symbol>& own) {
+	property_names_.clear();
+	if (super != nullptr) {
+		property_names_.insert(super->property_names_.begin(), super->property_names_.end());
+	}
+	property_names_.insert(own.begin(), own.end());
+}
+
 Object* ObjectTypeBase::cast(const DerivedType* to, Object* o) const {
-	const ObjectTypeBase* other = dynamic_cast<const ObjectTypeBase*>(to);
-	if (other != nullptr) {
-		for (const ObjectTypeBase* t = other; t != nullptr; t = t->super_) {
-			if (t == this) return o; // TODO: Consider what could be done for multiple inheritance?
+	switch (to->kind()) {
+		case TypeKind::Object: {
+			// TODO: Consider what could be done for multiple inheritance?
+			return is_subtype_of(static_cast<const ObjectTypeBase*>(to)) ? o : nullptr;
 		}
-		return nullptr;
-	}
-	
-	const CompositeType* comp = dynamic_cast<const CompositeType*>(to);
-	if (comp != nullptr) {
-		return comp->find_self_up(o);
+		case TypeKind::Composite: {
+			return static_cast<const CompositeType*>(to)->find_self_up(o);
+		}
+		default: return nullptr;
 	}
-	
-	return nullptr;
 }
\ No newline at end of file
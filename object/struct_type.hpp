@@ -13,21 +13,42 @@ struct SlotAttributeBase;
 template <typename T> struct SlotForObject;
 
 struct ObjectTypeBase : DerivedType {
-	const std::string& name() const override { return name_; }
+	const std::string& name() const override { return name_.str(); }
+	Symbol symbol() const { return name_; }
 	const std::string& description() const { return description_; }
 	Object* cast(const DerivedType* to, Object* o) const override;
 	const ObjectTypeBase* super() const;
+	size_t inheritance_depth() const { return display_.size(); }
+	const Array<const ObjectTypeBase*>& ancestors() const { return display_; }
+	bool is_subtype_of(const ObjectTypeBase* other) const;
 	virtual Array<const AttributeBase*> attributes() const = 0;
 	virtual size_t num_slots() const = 0;
 	virtual const SlotAttributeBase* slot_at(size_t idx) const = 0;
+	// Streams the properties of this type and its supertypes as key/value pairs, without
+	// the surrounding map or "class" key, so composites can add their own keys.
+	virtual void serialize_properties(const byte* place, ArchiveWriter& writer, IUniverse& universe) const = 0;
+	// Reads the value of the property named 'key' of this type or a supertype. Returns
+	// false, without reading anything, if there is no such property.
+	bool deserialize_property(byte* place, const std::string& key, ArchiveReader& reader, IUniverse& universe) const;
+	// The properties of this type and its supertypes by ordinal, in the order
+	// serialize_properties() writes them: Object's first, this type's last.
+	virtual size_t num_properties() const = 0;
+	// The ordinal of the property named 'name', or -1 if there is none.
+	ptrdiff_t property_ordinal(Symbol name) const;
+	virtual const AttributeBase* property_at(size_t ordinal) const = 0;
+	virtual void deserialize_property_at(byte* place, size_t ordinal, ArchiveReader& reader, IUniverse& universe) const = 0;
+	// Reads the value following 'key' in a map of this type. Keyless readers say which
+	// property it is by ordinal, and the name is only looked up for the others. Returns
+	// false, without reading anything, if the value is not a property.
+	bool deserialize_field(byte* place, const std::string& key, ArchiveReader& reader, IUniverse& universe) const;
 	
 	template <typename T, typename R, typename... Args>
 	const SlotAttributeBase* find_slot_for_method(R(T::*method)(Args...)) const {
 		size_t n = num_slots();
 		for (size_t i = 0; i < n; ++i) {
 			const SlotAttributeBase* s = slot_at(i);
-			const SlotAttribute<T, R, Args...>* slot = dynamic_cast<const SlotAttribute<T,R,Args...>*>(s);
-			if (slot != nullptr) {
+			if (s->method_type_tag() == MethodTypeTag<R(T::*)(Args...)>::get()) {
+				auto slot = static_cast<const SlotAttribute<T, R, Args...>*>(s);
 				if (slot->method() == method) {
 					return slot;
 				}
@@ -36,25 +57,80 @@ struct ObjectTypeBase : DerivedType {
 		return nullptr;
 	}
 protected:
-	ObjectTypeBase(const ObjectTypeBase* super, std::string name, std::string description) : super_(super), name_(std::move(name)), description_(std::move(description)) {}
+	ObjectTypeBase(const ObjectTypeBase* super, const std::string& name, std::string description) : DerivedType(TypeKind::Object), super_(super), name_(name), description_(std::move(description)) {}
+	
+	void build_display(const ObjectTypeBase* super);
+	void build_property_names(const ObjectTypeBase* super, const Array<Symbol>& own);
 	
 	const ObjectTypeBase* super_;
-	std::string name_;
+	Symbol name_;
 	std::string description_;
+	Array<const ObjectTypeBase*> display_; // ancestors indexed by inheritance depth, Object first
+	Array<Symbol> property_names_; // by ordinal, including the supertypes'
 };
 
+inline bool ObjectTypeBase::is_subtype_of(const ObjectTypeBase* other) const {
+	if (other == this) return true;
+	size_t depth = other->inheritance_depth();
+	return depth < display_.size() && display_[depth] == other;
+}
+
+inline ptrdiff_t ObjectTypeBase::property_ordinal(Symbol name) const {
+	for (size_t i = 0; i < property_names_.size(); ++i) {
+		if (property_names_[i] == name) return ptrdiff_t(i);
+	}
+	return -1;
+}
+
+inline bool ObjectTypeBase::deserialize_property(byte* place, const std::string& key, ArchiveReader& reader, IUniverse& universe) const {
+	// Keys that are not symbols yet cannot name a property.
+	Symbol name;
+	if (!Symbol::find(key, name)) return false;
+	ptrdiff_t ordinal = property_ordinal(name);
+	if (ordinal < 0) return false;
+	deserialize_property_at(place, size_t(ordinal), reader, universe);
+	return true;
+}
+
+inline bool ObjectTypeBase::deserialize_field(byte* place, const std::string& key, ArchiveReader& reader, IUniverse& universe) const {
+	ptrdiff_t ordinal;
+	if (reader.field_ordinal(*this, ordinal)) {
+		if (ordinal < 0) return false;
+		deserialize_property_at(place, size_t(ordinal), reader, universe);
+		return true;
+	}
+	return deserialize_property(place, key, reader, universe);
+}
+
 template <typename T>
 struct ObjectType : TypeFor<T, ObjectTypeBase> {
-	ObjectType(const ObjectTypeBase* super, std::string name, std::string description) : TypeFor<T, ObjectTypeBase>(super, std::move(name), std::move(description)), is_abstract_(false) {}
+	ObjectType(const ObjectTypeBase* super, std::string name, std::string description) : TypeFor<T, ObjectTypeBase>(super, std::move(name), std::move(description)), first_property_(0), is_abstract_(false) {
+		// Object has no super type, and must not ask for its own type while it is being built.
+		this->build_display(std::is_same<T, Object>::value ? nullptr : this->super());
+	}
 	
 	void construct(byte* place, IUniverse& universe) const {
 		Object* p = ::new(place) T;
 		p->set_object_type__(this);
 		p->set_universe__(&universe);
 	}
+	void construct_n(byte* place, size_t count, size_t stride, IUniverse& universe) const {
+		for (size_t i = 0; i < count; ++i) {
+			Object* p = ::new(place + i * stride) T;
+			p->set_object_type__(this);
+			p->set_universe__(&universe);
+		}
+	}
 	
 	void set_properties(Array<AttributeForObject<T>*> properties) {
 		properties_ = std::move(properties);
+		auto s = std::is_same<T, Object>::value ? nullptr : this->super();
+		first_property_ = s ? s->num_properties() : 0;
+		Array<Symbol> names;
+		for (auto& it: properties_) {
+			names.push_back(it->attribute_symbol());
+		}
+		this->build_property_names(s, names);
 	}
 	void set_slots(Array<SlotForObject<T>*> slots) {
 		slots_ = std::move(slots);
@@ -62,34 +138,42 @@ struct ObjectType : TypeFor<T, ObjectTypeBase> {
 	
 	Array<const AttributeBase*> attributes() const {
 		Array<const AttributeBase*> result;
-		result.resize(properties_.size());
+		result.reserve(properties_.size());
 		for (auto& it: properties_) {
-			result.push_back(dynamic_cast<const AttributeBase*>(it));
+			result.push_back(it->attribute_base());
 		}
 		return result;
 	}
+	size_t num_properties() const { return first_property_ + properties_.size(); }
+	const AttributeBase* property_at(size_t ordinal) const;
+	void deserialize_property_at(byte* place, size_t ordinal, ArchiveReader& reader, IUniverse& universe) const;
 	size_t num_slots() const { return slots_.size(); }
-	const SlotAttributeBase* slot_at(size_t idx) const { return dynamic_cast<const SlotAttributeBase*>(slots_[idx]); }
+	const SlotAttributeBase* slot_at(size_t idx) const { return slots_[idx]->slot_attribute(); }
 	
 	size_t num_elements() const { return properties_.size(); }
 	const Type* type_of_element(size_t idx) const { return properties_[idx]->attribute_type(); }
 	size_t offset_of_element(size_t idx) const { return 0; /* TODO */ }
 	
 	void deserialize(T& object, const ArchiveNode&, IUniverse&) const;
+	void deserialize(T& object, ArchiveReader&, IUniverse&) const;
 	void serialize(const T& object, ArchiveNode&, IUniverse&) const;
+	void serialize(const T& object, ArchiveWriter&, IUniverse&) const;
+	void serialize_properties(const byte* place, ArchiveWriter& writer, IUniverse& universe) const;
 	
 	void set_abstract(bool b) { is_abstract_ = b; }
 	bool is_abstract() const { return is_abstract_; }
 	
-	const SlotAttributeBase* get_slot_by_name(const std::string& name) const {
+	using DerivedType::get_slot_by_name;
+	const SlotAttributeBase* get_slot_by_name(Symbol name) const override {
 		for (auto& it: slots_) {
-			if (it->slot_name() == name) return dynamic_cast<const SlotAttributeBase*>(it);
+			if (it->slot_attribute()->symbol() == name) return it->slot_attribute();
 		}
 		return nullptr;
 	}
 protected:
 	Array<AttributeForObject<T>*> properties_;
 	Array<SlotForObject<T>*> slots_;
+	size_t first_property_; // ordinal of the first property of this type, after those of the supertypes
 	bool is_abstract_;
 };
 
@@ -100,7 +184,34 @@ void ObjectType<T>::deserialize(T& object, const ArchiveNode& node, IUniverse& u
 	if (s) s->deserialize(reinterpret_cast<byte*>(&object), node, universe);
 	
 	for (auto& property: properties_) {
-		property->deserialize_attribute(&object, node[property->attribute_name()], universe);
+		property->deserialize_attribute(&object, node[property->attribute_symbol()], universe);
+	}
+}
+
+template <typename T>
+void ObjectType<T>::deserialize(T& object, ArchiveReader& reader, IUniverse& universe) const {
+	// Keys are taken in the order they come in. "class" and unknown keys are skipped.
+	if (!reader.begin_map()) return;
+	std::string key;
+	while (reader.next_key(key)) {
+		if (!this->deserialize_field(reinterpret_cast<byte*>(&object), key, reader, universe)) {
+			reader.skip();
+		}
+	}
+}
+
+template <typename T>
+const AttributeBase* ObjectType<T>::property_at(size_t ordinal) const {
+	if (ordinal < first_property_) return this->super()->property_at(ordinal);
+	return properties_[ordinal - first_property_]->attribute_base();
+}
+
+template <typename T>
+void ObjectType<T>::deserialize_property_at(byte* place, size_t ordinal, ArchiveReader& reader, IUniverse& universe) const {
+	if (ordinal < first_property_) {
+		this->super()->deserialize_property_at(place, ordinal, reader, universe);
+	} else {
+		properties_[ordinal - first_property_]->deserialize_attribute(reinterpret_cast<T*>(place), reader, universe);
 	}
 }
 
@@ -110,11 +221,33 @@ void ObjectType<T>::serialize(const T& object, ArchiveNode& node, IUniverse& uni
 	if (s) s->serialize(reinterpret_cast<const byte*>(&object), node, universe);
 	
 	for (auto& property: properties_) {
-		property->serialize_attribute(&object, node[property->attribute_name()], universe);
+		property->serialize_attribute(&object, node[property->attribute_symbol()], universe);
 	}
 	node["class"] = this->name();
 }
 
+template <typename T>
+void ObjectType<T>::serialize(const T& object, ArchiveWriter& writer, IUniverse& universe) const {
+	// The tree path lets each supertype write "class" and overwrites it; a stream can
+	// only write each key once. It comes first, so readers can create the object before
+	// they get to its properties.
+	writer.begin_object(*this);
+	serialize_properties(reinterpret_cast<const byte*>(&object), writer, universe);
+	writer.end_object();
+}
+
+template <typename T>
+void ObjectType<T>::serialize_properties(const byte* place, ArchiveWriter& writer, IUniverse& universe) const {
+	auto s = this->super();
+	if (s) s->serialize_properties(place, writer, universe);
+	
+	const T* object = reinterpret_cast<const T*>(place);
+	for (auto& property: properties_) {
+		writer.key(property->attribute_name());
+		property->serialize_attribute(object, writer, universe);
+	}
+}
+
 template <typename T, typename R, typename... Args>
 const SlotAttributeBase* MemberSlotInvoker<T,R,Args...>::slot() const {
 	const ObjectTypeBase* type = get_type<T>();
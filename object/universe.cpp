@@ -1,7 +1,9 @@
 #include "object/universe.hpp"
 #include "object/struct_type.hpp"
+#include "object/composite_type.hpp"
 
 #include <iomanip>
+#include <cstdio>
 
 ObjectPtr<> TestUniverse::create_root(const DerivedType* type, std::string id) {
 	clear();
@@ -11,16 +13,79 @@ ObjectPtr<> TestUniverse::create_root(const DerivedType* type, std::string id) {
 
 ObjectPtr<> TestUniverse::create_object(const DerivedType* type, std::string id) {
 	size_t sz = type->size();
-	byte* memory = new byte[sz];
-	type->construct(memory, *this);
+	size_t alignment = type->alignment() < sizeof(void*) ? sizeof(void*) : type->alignment();
+	void* memory;
+	if (posix_memalign(&memory, alignment, sz) != 0) return nullptr;
+	type->construct(reinterpret_cast<byte*>(memory), *this);
 	Object* object = reinterpret_cast<Object*>(memory);
-	memory_map_.push_back(object);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		memory_map_.push_back(object);
+	}
 	rename_object(object, id);
 	return object;
 }
 
+Array<ObjectPtr<>> TestUniverse::create_objects(const DerivedType* type, size_t count, std::string id_prefix) {
+	Array<ObjectPtr<>> result;
+	if (count == 0) return result;
+	size_t alignment = type->alignment() < sizeof(void*) ? sizeof(void*) : type->alignment();
+	size_t stride = (type->size() + type->alignment() - 1) / type->alignment() * type->alignment();
+	void* memory;
+	if (posix_memalign(&memory, alignment, count * stride) != 0) return result;
+	byte* place = reinterpret_cast<byte*>(memory);
+	type->construct_n(place, count, stride, *this);
+	
+	std::lock_guard<std::mutex> lock(mutex_);
+	blocks_.push_back(Block{place, count, stride, type});
+	if (id_prefix.size() == 0) id_prefix = type->name();
+	result.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		Object* object = reinterpret_cast<Object*>(place + i * stride);
+		result.push_back(object);
+		register_id(object, unique_id(id_prefix, 1));
+	}
+	if (type->kind() == TypeKind::Composite) {
+		register_aspect_ids(static_cast<const CompositeType*>(type), place, count, stride);
+	}
+	return result;
+}
+
+void TestUniverse::register_aspect_ids(const CompositeType* type, byte* place, size_t count, size_t stride) {
+	for (size_t i = 0; i < type->num_elements(); ++i) {
+		const DerivedType* aspect = type->aspect_at(i);
+		byte* aspect_place = place + type->offset_of_element(i);
+		for (size_t k = 0; k < count; ++k) {
+			register_id(reinterpret_cast<Object*>(aspect_place + k * stride), unique_id(aspect->name(), 1));
+		}
+		if (aspect->kind() == TypeKind::Composite) {
+			register_aspect_ids(static_cast<const CompositeType*>(aspect), aspect_place, count, stride);
+		}
+	}
+}
+
+std::string TestUniverse::unique_id(const std::string& base_name, int n) {
+	// Remember where the search for each base name stopped, so creating many objects
+	// with the same requested name doesn't probe every name handed out before.
+	int& next = next_suffix_[base_name];
+	if (next < n) next = n;
+	std::string new_name;
+	do {
+		char suffix[16];
+		snprintf(suffix, sizeof(suffix), "%02d", next++);
+		new_name = base_name + suffix;
+	} while (object_map_.find(new_name) != object_map_.end());
+	return new_name;
+}
+
+void TestUniverse::register_id(ObjectPtr<> object, std::string id) {
+	object_map_[id] = object;
+	reverse_object_map_[object] = std::move(id);
+}
+
 bool TestUniverse::rename_object(ObjectPtr<> object, std::string new_id) {
 	ASSERT(object->universe() == this);
+	std::lock_guard<std::mutex> lock(mutex_);
 	
 	// erase old name from database
 	auto old_it = reverse_object_map_.find(object);
@@ -48,24 +113,31 @@ bool TestUniverse::rename_object(ObjectPtr<> object, std::string new_id) {
 			base_name = object->object_type()->name();
 		}
 		
-		// increment n and try the name until we find one that's available
-		do {
-			std::stringstream create_new_name;
-			create_new_name << base_name << std::setw(2) << std::setfill('0') << n;
-			new_name = std::move(create_new_name.str());
-		} while (object_map_.find(new_name) != object_map_.end());
+		new_name = unique_id(base_name, n);
 		
 		renamed_exact = false;
 	} else {
 		new_name = std::move(new_id);
 	}
 	
-	object_map_[new_name] = object;
-	reverse_object_map_[object] = std::move(new_name);
+	register_id(object, std::move(new_name));
 	return renamed_exact;
 }
 
+ObjectPtr<> TestUniverse::get_object(const std::string& id) const {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		ObjectPtr<> object = find_or(object_map_, id, nullptr);
+		if (object != nullptr || loader_ == nullptr) return object;
+	}
+	// The loader creates objects through this universe, so it runs unlocked.
+	if (!loader_->load(id)) return nullptr;
+	std::lock_guard<std::mutex> lock(mutex_);
+	return find_or(object_map_, id, nullptr);
+}
+
 const std::string& TestUniverse::get_id(ObjectPtr<const Object> object) const {
+	std::lock_guard<std::mutex> lock(mutex_);
 	auto it = reverse_object_map_.find(object);
 	if (it != reverse_object_map_.end()) {
 		return it->second;
@@ -77,9 +149,16 @@ void TestUniverse::clear() {
 	for (auto object: memory_map_) {
 		const DerivedType* type = object->object_type();
 		type->destruct(reinterpret_cast<byte*>(object), *this);
+		free(object);
+	}
+	for (auto& block: blocks_) {
+		block.type->destruct_n(block.memory, block.count, block.stride, *this);
+		free(block.memory);
 	}
 	// TODO: Test for references?
 	object_map_.clear();
 	reverse_object_map_.clear();
 	memory_map_.clear();
+	blocks_.clear();
+	next_suffix_.clear();
 }
\ No newline at end of file
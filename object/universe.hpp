@@ -4,20 +4,41 @@
 
 #include <string>
 #include <map>
+#include <mutex>
 
 
 #include "object/object.hpp"
 #include "object/objectptr.hpp"
 
 struct DerivedType;
+struct CompositeType;
+struct ArchiveNode;
+
+// Creates objects whose IDs a universe knows about before the objects themselves exist,
+// such as the rest of a lazily deserialized archive.
+struct IObjectLoader {
+	// Creates the object named 'id', and whatever it depends on. Returns false if the
+	// loader has no such object waiting.
+	virtual bool load(const std::string& id) = 0;
+	// Called for each child of a ChildList being deserialized. Returns true if the loader
+	// will put the object in 'list' at 'index' when it is created, leaving the slot null until then.
+	virtual bool defer(const ArchiveNode& node, Array<ObjectPtr<>>& list, size_t index) = 0;
+	virtual ~IObjectLoader() {}
+};
 
 struct IUniverse {
 	virtual ObjectPtr<> create_object(const DerivedType* type, std::string id) = 0;
 	virtual ObjectPtr<> create_root(const DerivedType* type, std::string id) = 0;
+	// Creates 'count' objects of one type in a single contiguous block, with IDs derived from 'id_prefix'.
+	// The aspects of composite objects are named in the same pass.
+	virtual Array<ObjectPtr<>> create_objects(const DerivedType* type, size_t count, std::string id_prefix) = 0;
 	virtual ObjectPtr<> get_object(const std::string& id) const = 0;
 	virtual const std::string& get_id(ObjectPtr<const Object> object) const = 0;
 	virtual bool rename_object(ObjectPtr<> object, std::string new_id) = 0;
 	virtual ObjectPtr<> root() const = 0;
+	// get_object() asks the loader for IDs that aren't objects yet.
+	virtual IObjectLoader* object_loader() const = 0;
+	virtual void set_object_loader(IObjectLoader* loader) = 0;
 	virtual ~IUniverse() {}
 	
 	template <typename T>
@@ -29,25 +50,42 @@ struct IUniverse {
 	}
 };
 
+// Objects can be created and renamed from several threads at once, as parallel
+// deserialization does.
 struct TestUniverse : IUniverse {
 	ObjectPtr<> create_object(const DerivedType* type, std::string) override;
 	ObjectPtr<> create_root(const DerivedType* type, std::string) override;
-	ObjectPtr<> get_object(const std::string& id) const override {
-		return find_or(object_map_, id, nullptr);
-	}
+	Array<ObjectPtr<>> create_objects(const DerivedType* type, size_t count, std::string id_prefix) override;
+	ObjectPtr<> get_object(const std::string& id) const override;
 	const std::string& get_id(ObjectPtr<const Object> object) const override;
 	bool rename_object(ObjectPtr<> object, std::string) override;
 	ObjectPtr<> root() const override { return root_; }
+	IObjectLoader* object_loader() const override { return loader_; }
+	void set_object_loader(IObjectLoader* loader) override { loader_ = loader; }
 	
-	TestUniverse() : root_(nullptr) {}
+	TestUniverse() : root_(nullptr), loader_(nullptr) {}
 	~TestUniverse() { clear(); }
 private:
+	struct Block {
+		byte* memory;
+		size_t count;
+		size_t stride;
+		const DerivedType* type;
+	};
+	
 	void clear();
+	std::string unique_id(const std::string& base_name, int n);
+	void register_id(ObjectPtr<> object, std::string id);
+	void register_aspect_ids(const CompositeType* type, byte* place, size_t count, size_t stride);
 	
 	std::map<std::string, ObjectPtr<>> object_map_;
 	std::map<ObjectPtr<const Object>, std::string> reverse_object_map_;
 	Array<Object*> memory_map_;
+	Array<Block> blocks_;
+	std::map<std::string, int> next_suffix_;
 	ObjectPtr<> root_;
+	IObjectLoader* loader_;
+	mutable std::mutex mutex_;
 	std::string empty_id_;
 };
 
@@ -8,26 +8,104 @@
 #include "object/composite_type.hpp"
 #include "object/universe.hpp"
 #include "serialization/deserialize_object.hpp"
+#include "serialization/archive_reader.hpp"
+
+Archive::~Archive() {
+	for (auto fragment: fragments_) {
+		delete fragment;
+	}
+}
+
+Archive& Archive::make_fragment() {
+	Archive* fragment = new_fragment();
+	fragments_.push_back(fragment);
+	return *fragment;
+}
+
+void Archive::merge_fragment(Archive& fragment) {
+	for (auto ref: fragment.serialize_references) {
+		serialize_references.push_back(ref);
+	}
+	fragment.serialize_references.clear();
+	fixup_arena_.adopt(fragment.fixup_arena_);
+}
+
+ScratchArchive::ScratchArchive() : root_(nullptr) {
+	empty_ = nodes_.allocate(*this);
+}
+
+ArchiveNode& ScratchArchive::root() {
+	if (root_ == nullptr) {
+		root_ = nodes_.allocate(*this, ArchiveNodeType::Map);
+	}
+	return *root_;
+}
+
+const ArchiveNode& ScratchArchive::root() const {
+	ASSERT(root_ != nullptr);
+	return *root_;
+}
 
 void Archive::serialize(ObjectPtr<> object, IUniverse& universe) {
 	::serialize(*object, root(), universe);
+	perform_serialize_references(universe);
+}
+
+void Archive::perform_serialize_references(const IUniverse& universe) {
+	ObjectTable* table = references_by_index() ? &object_table_ : nullptr;
 	for (auto ref: serialize_references) {
-		ref->perform(universe);
+		ref->perform(universe, table);
 	}
-	serialize_references.clear();
+	serialize_references.clear(false);
 }
 
-ObjectPtr<> Archive::deserialize(IUniverse& universe) {
-	const ArchiveNode& n = root();
-	ObjectPtr<> ptr = deserialize_object(root(), universe);
-	
+void Archive::perform_deserialize_references(IUniverse& universe) {
+	while (deserialize_references.size() || deserialize_signals.size()) {
+		Array<DeserializeReferenceBase*> references = std::move(deserialize_references);
+		Array<DeserializeSignalBase*> signals = std::move(deserialize_signals);
+		for (auto it: references) {
+			it->perform(universe, &object_table_);
+		}
+		for (auto it: signals) {
+			it->perform(universe, &object_table_);
+		}
+	}
+}
+
+void Archive::move_deferred_to(ArchiveReader& reader) {
 	for (auto it: deserialize_references) {
-		it->perform(universe);
+		reader.register_reference_for_deserialization(it);
 	}
+	deserialize_references.clear();
 	for (auto it: deserialize_signals) {
-		it->perform(universe);
+		reader.register_signal_for_deserialization(it);
 	}
-	
+	deserialize_signals.clear();
+	reader.fixup_arena().adopt(fixup_arena_);
+}
+
+void Archive::clear_document() {
+	for (auto fragment: fragments_) {
+		delete fragment;
+	}
+	fragments_.clear(false);
+	object_table_.clear();
+	clear_deferred();
+	keys_.clear();
+}
+
+void Archive::clear_deferred() {
+	deserialize_references.clear(false);
+	serialize_references.clear(false);
+	deserialize_signals.clear(false);
+	fixup_arena_.reset();
+}
+
+ObjectPtr<> Archive::deserialize(IUniverse& universe) {
+	const ArchiveNode& n = root();
+	object_table_.forget_objects();
+	ObjectPtr<> ptr = deserialize_object(root(), universe);
+	perform_deserialize_references(universe);
 	return ptr;
 	
 	if (!n.is_empty()) {
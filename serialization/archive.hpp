@@ -7,6 +7,10 @@
 #include "type/type.hpp"
 #include "object/objectptr.hpp"
 #include "serialization/archive_node_type.hpp"
+#include "serialization/object_table.hpp"
+#include "base/arena.hpp"
+#include "serialization/archive_node.hpp"
+#include "base/bag.hpp"
 
 #include <string>
 
@@ -14,11 +18,15 @@ struct DeserializeReferenceBase;
 struct SerializeReferenceBase;
 struct DeserializeSignalBase;
 struct ArchiveNode;
+struct ArchiveReader;
 struct IUniverse;
 
 struct Archive {
 	typedef ArchiveNodeType::Type NodeType;
 	
+	Archive() : deserialize_threads_(1), serialize_threads_(1) {}
+	virtual ~Archive();
+	
 	virtual ArchiveNode& root() = 0;
 	virtual const ArchiveNode& root() const = 0;
 	virtual void write(std::ostream& os) const = 0;
@@ -29,16 +37,99 @@ struct Archive {
 	
 	void serialize(ObjectPtr<> object, IUniverse& universe);
 	ObjectPtr<> deserialize(IUniverse& universe);
+	// Resolves the references and signals deserialized so far, including any registered
+	// while doing so, which happens when resolving a reference creates its object.
+	void perform_deserialize_references(IUniverse& universe);
+	// Fills in the IDs of the references serialized so far, or their indices in the
+	// object table if the archive stores references that way.
+	void perform_serialize_references(const IUniverse& universe);
+	// The objects that references stored as indices point to.
+	ObjectTable& object_table() { return object_table_; }
+	const ObjectTable& object_table() const { return object_table_; }
+	// Hands the references and signals registered while deserializing over to 'reader',
+	// which resolves them with the rest of its document.
+	void move_deferred_to(ArchiveReader& reader);
+	// The reference and signal records registered with this archive are allocated here,
+	// and released all at once when the archive is cleared or destroyed.
+	Arena& fixup_arena() { return fixup_arena_; }
+	// Drops the records that have not been performed yet, and releases all of them,
+	// keeping the memory for the next document.
+	void clear_deferred();
+	// The maps, arrays and strings of this archive's nodes.
+	ArchiveNodeStorage& node_storage() { return node_storage_; }
+	// The keys of this archive's maps that were not symbols yet, so that reading documents
+	// does not grow the global symbol table.
+	LocalSymbolTable& keys() { return keys_; }
+	
+	// Large ChildLists are deserialized by up to this many threads, which requires a
+	// universe that can create objects concurrently. The objects of a list keep their order.
+	void set_deserialize_threads(size_t n) { deserialize_threads_ = n < 1 ? 1 : n; }
+	size_t deserialize_threads() const { return deserialize_threads_; }
+	// Large ChildLists are serialized by up to this many threads. The resulting tree is the
+	// same as when serializing on one thread.
+	void set_serialize_threads(size_t n) { serialize_threads_ = n < 1 ? 1 : n; }
+	size_t serialize_threads() const { return serialize_threads_; }
+	
+	// A new, empty archive of the same kind, owned by this one. Its nodes can be added to
+	// this archive's tree, so threads can build parts of the tree without sharing a node pool.
+	Archive& make_fragment();
+	// Takes over the references serialized into 'fragment' so far.
+	void merge_fragment(Archive& fragment);
 	
 	void register_reference_for_deserialization(DeserializeReferenceBase* ref) { deserialize_references.push_back(ref); }
 	void register_reference_for_serialization(SerializeReferenceBase* ref) { serialize_references.push_back(ref); }
 	void register_signal_for_deserialization(DeserializeSignalBase* sig) {
 		deserialize_signals.push_back(sig);
 	}
+protected:
+	virtual Archive* new_fragment() const = 0;
+	// Whether serialized references are stored as indices into the object table, which
+	// the archive then writes along with the document.
+	virtual bool references_by_index() const { return false; }
+	// Forgets the fragments, records, object table and keys of the current document, keeping
+	// the memory of the records and table for the next one. The nodes must be cleared first.
+	void clear_document();
 private:
 	Array<DeserializeReferenceBase*> deserialize_references;
 	Array<SerializeReferenceBase*> serialize_references;
 	Array<DeserializeSignalBase*> deserialize_signals;
+	Array<Archive*> fragments_;
+	ObjectTable object_table_;
+	Arena fixup_arena_;
+	ArchiveNodeStorage node_storage_;
+	LocalSymbolTable keys_;
+	size_t deserialize_threads_;
+	size_t serialize_threads_;
+};
+
+struct ScratchArchive;
+
+struct ScratchArchiveNode : ArchiveNode {
+	ScratchArchiveNode(ScratchArchive& archive, ArchiveNodeType::Type t = ArchiveNodeType::Empty);
+	void write(std::ostream& os) const override {}
 };
 
+// Nodes for holding values briefly while streaming, such as the values of a type without
+// its own writer or reader, or the parts of an object read before its class. They are
+// replayed through an ArchiveWriter or deserialized, never written out, so the archive
+// has no format of its own.
+struct ScratchArchive : Archive {
+	ScratchArchive();
+	ArchiveNode& root() override;
+	const ArchiveNode& root() const override;
+	void write(std::ostream& os) const override {}
+	const ArchiveNode& operator[](const std::string& key) const override { return root()[key]; }
+	ArchiveNode& operator[](const std::string& key) override { return root()[key]; }
+	ArchiveNode* make(ArchiveNode::Type t = ArchiveNodeType::Empty) override { return nodes_.allocate(*this, t); }
+	const ArchiveNode& empty() const { return *empty_; }
+protected:
+	Archive* new_fragment() const override { return new ScratchArchive; }
+private:
+	ScratchArchiveNode* empty_;
+	ScratchArchiveNode* root_;
+	ContainedBag<ScratchArchiveNode> nodes_;
+};
+
+inline ScratchArchiveNode::ScratchArchiveNode(ScratchArchive& archive, ArchiveNode::Type t) : ArchiveNode(archive, t) {}
+
 #endif /* end of include guard: ARCHIVE_HPP_A0L9H8RE */
@@ -2,54 +2,226 @@
 #include "serialization/archive.hpp"
 #include "object/universe.hpp"
 #include "object/objectptr.hpp"
+#include "serialization/object_table.hpp"
+
+ArchiveNode::ArchiveNode(Archive& archive, Type t) : archive_(archive), type_(Type::Empty), integer_value(0) {
+	clear(t);
+}
+
+void ArchiveNode::clear(Type new_type) {
+	if (type_ == new_type) {
+		switch (type_) {
+			case Type::Map: map_->clear(); break;
+			case Type::Array: array_->clear(false); break;
+			case Type::String: string_->clear(); break;
+			default: integer_value = 0; break;
+		}
+		return;
+	}
+	ArchiveNodeStorage& storage = archive_.node_storage();
+	switch (type_) {
+		case Type::Map: storage.release(map_); break;
+		case Type::Array: storage.release(array_); break;
+		case Type::String: storage.release(string_); break;
+		default: break;
+	}
+	type_ = new_type;
+	switch (new_type) {
+		case Type::Map: map_ = storage.make_map(); break;
+		case Type::Array: array_ = storage.make_array(); break;
+		case Type::String: string_ = storage.make_string(); break;
+		default: integer_value = 0; break;
+	}
+}
 
 ArchiveNode& ArchiveNode::array_push() {
 	if (type() != Type::Array) {
 		clear(Type::Array);
 	}
 	ArchiveNode* n = archive_.make();
-	array_.push_back(n);
+	array_->push_back(n);
 	return *n;
 }
 
+void ArchiveNode::array_append(ArchiveNode& node) {
+	if (type() != Type::Array) {
+		clear(Type::Array);
+	}
+	array_->push_back(&node);
+}
+
 const ArchiveNode& ArchiveNode::operator[](size_t idx) const {
 	ASSERT(type() == Type::Array);
-	if (idx >= array_.size()) {
+	if (idx >= array_->size()) {
 		return archive_.empty();
 	}
-	return *array_[idx];
+	return *(*array_)[idx];
 }
 
 ArchiveNode& ArchiveNode::operator[](size_t idx) {
 	if (type() != Type::Array) {
 		clear(Type::Array);
 	}
-	if (idx < array_.size()) {
-		return *array_[idx];
-	} else {
-		array_.reserve(idx+1);
-		while (array_.size() < idx+1) { array_.push_back(archive_.make()); }
-		return *array_[idx];
+	if (idx >= array_->size()) {
+		array_->reserve(idx+1);
+		while (array_->size() < idx+1) { array_->push_back(archive_.make()); }
 	}
+	return *(*array_)[idx];
 }
 
 const ArchiveNode& ArchiveNode::operator[](const std::string& key) const {
 	ASSERT(type() == Type::Map);
-	return *find_or(map_, key, &archive_.empty());
+	// A key that is neither a symbol nor one of the archive's is in no map.
+	Symbol symbol;
+	if (!archive_.keys().find(key, symbol)) return archive_.empty();
+	ArchiveNode* n = map_->find(symbol);
+	return n ? *n : archive_.empty();
 }
 
 ArchiveNode& ArchiveNode::operator[](const std::string& key) {
+	return (*this)[archive_.keys().get(key)];
+}
+
+const ArchiveNode& ArchiveNode::operator[](Symbol key) const {
+	ASSERT(type() == Type::Map);
+	// Keys are stored as the archive's own symbol when it has one with their text. Only
+	// a map that has such keys needs the lookup by text.
+	ArchiveNode* n = map_->find(map_->has_local_keys() ? archive_.keys().canonical(key) : key);
+	return n ? *n : archive_.empty();
+}
+
+ArchiveNode& ArchiveNode::operator[](Symbol key) {
 	if (type() != Type::Map) {
 		clear(Type::Map);
 	}
-	auto it = map_.find(key);
-	if (it == map_.end()) {
-		ArchiveNode* n = archive_.make();
-		map_[key] = n;
-		return *n;
+	key = archive_.keys().canonical(key);
+	ArchiveNode* n = map_->find(key);
+	if (n == nullptr) {
+		n = archive_.make();
+		map_->insert(key, n);
+	}
+	return *n;
+}
+
+Symbol ArchiveNodeMap::class_key() {
+	static const Symbol key("class");
+	return key;
+}
+
+Symbol ArchiveNodeMap::aspects_key() {
+	static const Symbol key("aspects");
+	return key;
+}
+
+Symbol ArchiveNodeMap::id_key() {
+	static const Symbol key("id");
+	return key;
+}
+
+const Symbol* ArchiveNodeMap::leading_keys() {
+	static const Symbol keys[NumLeadingKeys] = {class_key(), aspects_key(), id_key()};
+	return keys;
+}
+
+namespace {
+	// Interned at startup, so no archive has keys of its own for them.
+	const Symbol interned_leading_keys[] = {ArchiveNodeMap::class_key(), ArchiveNodeMap::aspects_key(), ArchiveNodeMap::id_key()};
+}
+
+const ArchiveNodeMap::Entry* ArchiveNodeMap::find_entry(Symbol key) const {
+	if (index_.size() == 0) {
+		for (const Entry& entry: entries_) {
+			if (entry.key == key) return &entry;
+		}
+		return nullptr;
+	}
+	size_t mask = index_.size() - 1;
+	for (size_t i = key.hash() & mask; index_[i] != 0; i = (i + 1) & mask) {
+		const Entry& entry = entries_[index_[i] - 1];
+		if (entry.key == key) return &entry;
+	}
+	return nullptr;
+}
+
+ArchiveNode* ArchiveNodeMap::find(Symbol key) const {
+	const Entry* entry = find_entry(key);
+	return entry ? entry->node : nullptr;
+}
+
+const ArchiveNodeMap::Entry* ArchiveNodeMap::next_in_write_order(Cursor& cursor) const {
+	const Symbol* leading = leading_keys();
+	while (cursor.leading < NumLeadingKeys) {
+		const Entry* entry = find_entry(leading[cursor.leading++]);
+		if (entry != nullptr) return entry;
+	}
+	while (cursor.index < entries_.size()) {
+		const Entry& entry = entries_[cursor.index++];
+		if (entry.key != leading[0] && entry.key != leading[1] && entry.key != leading[2]) return &entry;
+	}
+	return nullptr;
+}
+
+void ArchiveNodeMap::insert(Symbol key, ArchiveNode* node) {
+	entries_.push_back(Entry{key, node});
+	if (key.is_local()) has_local_keys_ = true;
+	if (entries_.size() <= MaxLinearSearch) return;
+	if (2 * entries_.size() > index_.size()) {
+		size_t capacity = index_.size() ? 2 * index_.size() : 4 * MaxLinearSearch;
+		index_.clear(false);
+		index_.resize(uint32(capacity), 0);
+		for (size_t i = 0; i < entries_.size(); ++i) add_to_index(i);
 	} else {
-		return *it->second;
+		add_to_index(entries_.size() - 1);
+	}
+}
+
+void ArchiveNodeMap::add_to_index(size_t i) {
+	size_t mask = index_.size() - 1;
+	size_t slot = entries_[i].key.hash() & mask;
+	while (index_[slot] != 0) slot = (slot + 1) & mask;
+	index_[slot] = uint32(i + 1);
+}
+
+ArchiveNode::Map* ArchiveNodeStorage::make_map() {
+	if (free_maps_.size()) {
+		ArchiveNode::Map* map = free_maps_.back();
+		free_maps_.pop_back();
+		return map;
+	}
+	return maps_.allocate();
+}
+
+Array<ArchiveNode*>* ArchiveNodeStorage::make_array() {
+	if (free_arrays_.size()) {
+		Array<ArchiveNode*>* array = free_arrays_.back();
+		free_arrays_.pop_back();
+		return array;
 	}
+	return arrays_.allocate();
+}
+
+std::string* ArchiveNodeStorage::make_string() {
+	if (free_strings_.size()) {
+		std::string* s = free_strings_.back();
+		free_strings_.pop_back();
+		return s;
+	}
+	return strings_.allocate();
+}
+
+void ArchiveNodeStorage::release(ArchiveNode::Map* map) {
+	map->clear();
+	free_maps_.push_back(map);
+}
+
+void ArchiveNodeStorage::release(Array<ArchiveNode*>* array) {
+	array->clear(false);
+	free_arrays_.push_back(array);
+}
+
+void ArchiveNodeStorage::release(std::string* s) {
+	s->clear();
+	free_strings_.push_back(s);
 }
 
 void ArchiveNode::register_reference_for_deserialization_impl(DeserializeReferenceBase* ref) const {
@@ -64,19 +236,34 @@ void ArchiveNode::register_signal_for_deserialization_impl(DeserializeSignalBase
 	archive_.register_signal_for_deserialization(sig);
 }
 
-Object* DeserializeReferenceBase::get_object(IUniverse& universe) const {
-	return universe.get_object(object_id_).get();
+Arena& ArchiveNode::fixup_arena() const {
+	return archive_.fixup_arena();
+}
+
+void DeserializeReferenceBase::perform(IUniverse& universe, ObjectTable* table) {
+	if (index_ < 0) {
+		set(universe.get_object(object_id_).get());
+	} else {
+		set(table ? table->get(size_t(index_), universe) : nullptr);
+	}
 }
 
-std::string SerializeReferenceBase::get_id(const IUniverse& universe, Object* obj) const {
-	return universe.get_id(obj);
+void SerializeReferenceBase::set(const IUniverse& universe, Object* obj, ObjectTable* table) {
+	if (table) {
+		node_.set(int64(table->add(obj, universe)));
+	} else {
+		node_.set(universe.get_id(obj));
+	}
 }
 
-Object* DeserializeSignalBase::get_object(const IUniverse& universe) const {
-	return universe.get_object(receiver_id_).get();
+Object* DeserializeSignalBase::get_object(const IUniverse& universe, ObjectTable* table) const {
+	if (receiver_index_ < 0) {
+		return universe.get_object(receiver_id_).get();
+	}
+	return table ? table->get(size_t(receiver_index_), universe) : nullptr;
 }
 
 const SlotAttributeBase* DeserializeSignalBase::get_slot(Object* object) const {
 	const DerivedType* type = get_type(object);
-	return type->get_slot_by_name(slot_id_);
+	return type->get_slot_by_name(slot_);
 }
\ No newline at end of file
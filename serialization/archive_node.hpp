@@ -7,18 +7,76 @@
 #include <iostream>
 
 #include "serialization/archive_node_type.hpp"
+#include "base/arena.hpp"
+#include "base/bag.hpp"
+#include "base/symbol.hpp"
 #include "type/type.hpp"
 
 struct Archive;
 struct DeserializeReferenceBase;
 struct SerializeReferenceBase;
 struct DeserializeSignalBase;
+struct ObjectTable;
 struct IUniverse;
 struct SlotAttributeBase;
 struct DerivedType;
+struct ArchiveNode;
+
+// The children of a map node in one array, in the order they were added, which is the
+// order they are written in. Keys are symbols, and the small maps objects make are
+// searched by comparing them alone; larger ones through a hash index.
+struct ArchiveNodeMap {
+	struct Entry {
+		Symbol key;
+		ArchiveNode* node;
+	};
+	typedef const Entry* const_iterator;
+	
+	ArchiveNodeMap() : has_local_keys_(false) {}
+	ArchiveNode* find(Symbol key) const;
+	// Adds 'node' under 'key', which must not be in the map yet.
+	void insert(Symbol key, ArchiveNode* node);
+	void clear() { entries_.clear(false); index_.clear(false); has_local_keys_ = false; }
+	// Whether any key is a symbol of the archive's own rather than a global one.
+	bool has_local_keys() const { return has_local_keys_; }
+	size_t size() const { return entries_.size(); }
+	const_iterator begin() const { return entries_.begin(); }
+	const_iterator end() const { return entries_.end(); }
+	// Maps are written and read with "class", "aspects" and "id" first, so a reader learns
+	// the type and ID of an object before its properties.
+	struct Cursor {
+		size_t leading;
+		size_t index;
+	};
+	static Cursor begin_write_order() { return Cursor{0, 0}; }
+	// The entry after 'cursor' in write order, or nullptr at the end.
+	const Entry* next_in_write_order(Cursor& cursor) const;
+	// Calls f(key, node) for every entry in write order.
+	template <typename F>
+	void for_each_in_write_order(F f) const {
+		Cursor cursor = begin_write_order();
+		while (const Entry* entry = next_in_write_order(cursor)) f(entry->key, *entry->node);
+	}
+	
+	static Symbol class_key();
+	static Symbol aspects_key();
+	static Symbol id_key();
+private:
+	static const size_t MaxLinearSearch = 16;
+	static const size_t NumLeadingKeys = 3;
+	static const Symbol* leading_keys();
+	const Entry* find_entry(Symbol key) const;
+	void add_to_index(size_t i);
+	Array<Entry> entries_;
+	// Open addressing by key hash, at most half full. Each slot holds an index into
+	// entries_ plus one, or zero. Empty while there are at most MaxLinearSearch entries.
+	Array<uint32> index_;
+	bool has_local_keys_;
+};
 
 struct ArchiveNode {
 	typedef ArchiveNodeType::Type Type;
+	typedef ArchiveNodeMap Map;
 	
 	bool is_empty() const { return type_ == Type::Empty; }
 	bool is_array() const { return type_ == Type::Array; }
@@ -53,9 +111,16 @@ struct ArchiveNode {
 	ArchiveNode& operator[](size_t idx);
 	const ArchiveNode& operator[](const std::string& key) const;
 	ArchiveNode& operator[](const std::string& key);
+	// Lookups by a symbol the caller keeps skip interning the key.
+	const ArchiveNode& operator[](Symbol key) const;
+	ArchiveNode& operator[](Symbol key);
 	
 	ArchiveNode& array_push();
-	size_t array_size() const { return array_.size(); }
+	// Adds a node made by this node's archive or one of its fragments.
+	void array_append(ArchiveNode& node);
+	size_t array_size() const { return type_ == Type::Array ? array_->size() : 0; }
+	
+	Archive& archive() const { return archive_; }
 	
 	template <typename T>
 	ArchiveNode& operator=(T value) {
@@ -72,18 +137,25 @@ struct ArchiveNode {
 	void register_reference_for_serialization(const T& reference);
 	template <typename T>
 	void register_signal_for_deserialization(T* signal, std::string receiver_id, std::string slot_id) const;
+	template <typename T>
+	void register_signal_for_deserialization(T* signal, size_t receiver_index, std::string slot_id) const;
 protected:
-	explicit ArchiveNode(Archive& archive, Type t = Type::Empty) : archive_(archive), type_(t) {}
+	friend struct ArchiveWriter;
+	friend struct ArchiveReader;
+	friend struct ArchiveNodeReader;
+	friend struct JSONArchive;
+	explicit ArchiveNode(Archive& archive, Type t = Type::Empty);
 protected:
 	Archive& archive_;
 	Type type_;
-	// TODO: Use an 'any'/'variant' type for the following:
-	std::map<std::string, ArchiveNode*> map_;
-	Array<ArchiveNode*> array_;
-	std::string string_value;
+	// Only the member for type_ is valid. Maps, arrays and strings are kept out of line by
+	// the archive's ArchiveNodeStorage, so a node holding a scalar stays small.
 	union {
 		int64 integer_value;
 		float64 float_value;
+		std::string* string_;
+		Map* map_;
+		Array<ArchiveNode*>* array_;
 	};
 	
 	void clear(ArchiveNodeType::Type new_node_type);
@@ -93,6 +165,8 @@ protected:
 	void register_reference_for_deserialization_impl(DeserializeReferenceBase* ref) const;
 	void register_reference_for_serialization_impl(SerializeReferenceBase* ref);
 	void register_signal_for_deserialization_impl(DeserializeSignalBase* sig) const;
+	// Where the records above are allocated: the archive's arena.
+	Arena& fixup_arena() const;
 };
 
 inline void ArchiveNode::set(float32 f) {
@@ -146,7 +220,7 @@ inline void ArchiveNode::set(uint64 n) {
 
 inline void ArchiveNode::set(std::string s) {
 	clear(Type::String);
-	string_value = std::move(s);
+	*string_ = std::move(s);
 }
 
 template <typename T, typename U>
@@ -199,24 +273,42 @@ inline bool ArchiveNode::get(uint64& v) const {
 }
 
 inline bool ArchiveNode::get(std::string& s) const {
-	return get_value(s, Type::String, string_value);
+	if (type() == Type::String) {
+		s = *string_;
+		return true;
+	}
+	return false;
 }
 
-inline void ArchiveNode::clear(ArchiveNodeType::Type new_type) {
-	map_.clear();
-	array_.clear();
-	string_value = "";
-	integer_value = 0;
-	type_ = new_type;
-}
+// The maps, arrays and strings of the nodes of an archive. Nodes that let go of theirs
+// hand them back, and they are reused with the capacity they had.
+struct ArchiveNodeStorage {
+	ArchiveNode::Map* make_map();
+	Array<ArchiveNode*>* make_array();
+	std::string* make_string();
+	void release(ArchiveNode::Map* map);
+	void release(Array<ArchiveNode*>* array);
+	void release(std::string* s);
+private:
+	ContainedBag<ArchiveNode::Map> maps_;
+	ContainedBag<Array<ArchiveNode*>> arrays_;
+	ContainedBag<std::string> strings_;
+	Array<ArchiveNode::Map*> free_maps_;
+	Array<Array<ArchiveNode*>*> free_arrays_;
+	Array<std::string*> free_strings_;
+};
 
+// The records below are allocated in the Arena of the archive or reader that collects
+// them, and are released with it without being destructed, so their strings live there too.
 struct DeserializeReferenceBase {
-	virtual ~DeserializeReferenceBase() {}
-	DeserializeReferenceBase(std::string object_id) : object_id_(object_id) {}
-	virtual void perform(IUniverse&) = 0;
+	DeserializeReferenceBase(const char* object_id) : object_id_(object_id), index_(-1) {}
+	explicit DeserializeReferenceBase(size_t index) : object_id_(nullptr), index_(ptrdiff_t(index)) {}
+	// Resolves the reference by its index in 'table', or by ID if it was stored as one.
+	void perform(IUniverse& universe, ObjectTable* table = nullptr);
 protected:
-	std::string object_id_;
-	Object* get_object(IUniverse&) const;
+	const char* object_id_;
+	ptrdiff_t index_;
+	virtual void set(Object* object) = 0;
 };
 
 template <typename T>
@@ -224,11 +316,14 @@ struct DeserializeReference : DeserializeReferenceBase {
 public:
 	typedef typename T::PointeeType PointeeType;
 	
-	DeserializeReference(std::string object_id, T& reference) : DeserializeReferenceBase(object_id), reference_(reference) {}
-	void perform(IUniverse& universe) {
-		Object* object_ptr = get_object(universe);
+	DeserializeReference(const char* object_id, T& reference) : DeserializeReferenceBase(object_id), reference_(reference) {}
+	DeserializeReference(size_t index, T& reference) : DeserializeReferenceBase(index), reference_(reference) {}
+protected:
+	void set(Object* object_ptr) override {
 		if (object_ptr == nullptr) {
 			// TODO: Warn about non-existing object ID.
+			reference_ = nullptr;
+			return;
 		}
 		PointeeType* ptr = aspect_cast<PointeeType>(object_ptr);
 		if (ptr == nullptr) {
@@ -242,19 +337,21 @@ private:
 
 template <typename T>
 void ArchiveNode::register_reference_for_deserialization(T& reference) const {
-	std::string id;
-	if (get(id)) {
-		register_reference_for_deserialization_impl(new DeserializeReference<T>(id, reference));
+	Arena& arena = fixup_arena();
+	if (type_ == Type::String) {
+		register_reference_for_deserialization_impl(arena.make<DeserializeReference<T>>(arena.copy(*string_), reference));
+	} else if (type_ == Type::Integer && integer_value >= 0) {
+		register_reference_for_deserialization_impl(arena.make<DeserializeReference<T>>(size_t(integer_value), reference));
 	}
 }
 
 struct SerializeReferenceBase {
-	virtual ~SerializeReferenceBase() {}
 	SerializeReferenceBase(ArchiveNode& node) : node_(node) {}
-	virtual void perform(const IUniverse&) = 0;
+	// Stores the reference as its index in 'table', or as an ID if there is no table.
+	virtual void perform(const IUniverse&, ObjectTable* table = nullptr) = 0;
 protected:
 	ArchiveNode& node_;
-	std::string get_id(const IUniverse&, Object*) const;
+	void set(const IUniverse&, Object*, ObjectTable* table);
 };
 
 template <typename T>
@@ -262,9 +359,9 @@ struct SerializeReference : SerializeReferenceBase {
 	typedef typename T::PointeeType PointeeType;
 	
 	SerializeReference(ArchiveNode& node, const T& reference) : SerializeReferenceBase(node), reference_(reference) {}
-	void perform(const IUniverse& universe) {
+	void perform(const IUniverse& universe, ObjectTable* table = nullptr) {
 		if (reference_ != nullptr) {
-			node_.set(get_id(universe, reference_.get()));
+			set(universe, reference_.get(), table);
 		} else {
 			node_.clear();
 		}
@@ -275,27 +372,31 @@ private:
 
 template <typename T>
 void ArchiveNode::register_reference_for_serialization(const T& reference) {
-	register_reference_for_serialization_impl(new SerializeReference<T>(*this, reference));
+	register_reference_for_serialization_impl(fixup_arena().make<SerializeReference<T>>(*this, reference));
 }
 
 struct DeserializeSignalBase {
 public:
-	virtual void perform(const IUniverse&) const = 0;
+	// Connects the signal, finding the receiver by its index in 'table', or by ID if it was stored as one.
+	virtual void perform(const IUniverse&, ObjectTable* table = nullptr) const = 0;
 protected:
-	DeserializeSignalBase(std::string receiver, std::string slot) : receiver_id_(std::move(receiver)), slot_id_(std::move(slot)) {}
-	std::string receiver_id_;
-	std::string slot_id_;
+	DeserializeSignalBase(const char* receiver, Symbol slot) : receiver_id_(receiver), receiver_index_(-1), slot_(slot) {}
+	DeserializeSignalBase(size_t receiver, Symbol slot) : receiver_id_(nullptr), receiver_index_(ptrdiff_t(receiver)), slot_(slot) {}
+	const char* receiver_id_;
+	ptrdiff_t receiver_index_;
+	Symbol slot_;
 	
-	Object* get_object(const IUniverse&) const;
+	Object* get_object(const IUniverse&, ObjectTable* table) const;
 	const SlotAttributeBase* get_slot(Object*) const;
 };
 
 template <typename T>
 struct DeserializeSignal : DeserializeSignalBase {
-	DeserializeSignal(T* signal, std::string receiver, std::string slot) : DeserializeSignalBase(std::move(receiver), std::move(slot)), signal_(signal) {}
+	DeserializeSignal(T* signal, const char* receiver, Symbol slot) : DeserializeSignalBase(receiver, slot), signal_(signal) {}
+	DeserializeSignal(T* signal, size_t receiver, Symbol slot) : DeserializeSignalBase(receiver, slot), signal_(signal) {}
 	
-	void perform(const IUniverse& universe) const {
-		Object* object = get_object(universe);
+	void perform(const IUniverse& universe, ObjectTable* table = nullptr) const {
+		Object* object = get_object(universe, table);
 		if (object == nullptr) return;
 		const SlotAttributeBase* slot = get_slot(object);
 		if (slot == nullptr) return;
@@ -307,7 +408,14 @@ private:
 
 template <typename T>
 void ArchiveNode::register_signal_for_deserialization(T* signal, std::string receiver, std::string slot) const {
-	register_signal_for_deserialization_impl(new DeserializeSignal<T>(signal, std::move(receiver), std::move(slot)));
+	Arena& arena = fixup_arena();
+	register_signal_for_deserialization_impl(arena.make<DeserializeSignal<T>>(signal, arena.copy(receiver), Symbol::lookup(slot)));
+}
+
+template <typename T>
+void ArchiveNode::register_signal_for_deserialization(T* signal, size_t receiver, std::string slot) const {
+	Arena& arena = fixup_arena();
+	register_signal_for_deserialization_impl(arena.make<DeserializeSignal<T>>(signal, receiver, Symbol::lookup(slot)));
 }
 
 #endif /* end of include guard: ARCHIVE_NODE_HPP_EP8GSONT */
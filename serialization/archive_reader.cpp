@@ -0,0 +1,150 @@
+#include "serialization/archive_reader.hpp"
+#include "serialization/archive.hpp"
+#include "serialization/archive_node.hpp"
+
+ArchiveNode& ArchiveReader::read_node(Archive& archive) {
+	ArchiveNode& node = *archive.make();
+	read_node(node);
+	return node;
+}
+
+void ArchiveReader::read_node(ArchiveNode& node) {
+	switch (peek()) {
+		case ArchiveNodeType::Map: {
+			begin_map();
+			node.clear(ArchiveNodeType::Map);
+			std::string key;
+			while (next_key(key)) {
+				read_node(node[key]);
+			}
+			break;
+		}
+		case ArchiveNodeType::Array: {
+			begin_array();
+			node.clear(ArchiveNodeType::Array);
+			while (next_element()) {
+				read_node(node.array_push());
+			}
+			break;
+		}
+		case ArchiveNodeType::Integer: {
+			int64 n;
+			if (read(n)) node.set(n);
+			break;
+		}
+		case ArchiveNodeType::Float: {
+			float64 f;
+			if (read(f)) node.set(f);
+			break;
+		}
+		case ArchiveNodeType::String: {
+			std::string s;
+			if (read(s)) node.set(std::move(s));
+			break;
+		}
+		case ArchiveNodeType::Empty: {
+			skip();
+			node.clear();
+			break;
+		}
+	}
+}
+
+void ArchiveReader::register_reference_for_deserialization(DeserializeReferenceBase* ref) {
+	if (parent_) {
+		parent_->register_reference_for_deserialization(ref);
+	} else {
+		deserialize_references_.push_back(ref);
+	}
+}
+
+void ArchiveReader::register_signal_for_deserialization(DeserializeSignalBase* sig) {
+	if (parent_) {
+		parent_->register_signal_for_deserialization(sig);
+	} else {
+		deserialize_signals_.push_back(sig);
+	}
+}
+
+void ArchiveReader::move_deferred_to(Archive& archive) {
+	for (auto it: deserialize_references_) {
+		archive.register_reference_for_deserialization(it);
+	}
+	deserialize_references_.clear();
+	for (auto it: deserialize_signals_) {
+		archive.register_signal_for_deserialization(it);
+	}
+	deserialize_signals_.clear();
+	archive.fixup_arena().adopt(arena_);
+}
+
+void ArchiveReader::perform_deferred(IUniverse& universe) {
+	ObjectTable& table = object_table();
+	for (auto it: deserialize_references_) {
+		it->perform(universe, &table);
+	}
+	deserialize_references_.clear();
+	for (auto it: deserialize_signals_) {
+		it->perform(universe, &table);
+	}
+	deserialize_signals_.clear();
+}
+
+ObjectTable& ArchiveNodeReader::object_table() {
+	return root_->archive().object_table();
+}
+
+ArchiveNodeReader::NodeType ArchiveNodeReader::peek() {
+	return next_ ? next_->type() : ArchiveNodeType::Empty;
+}
+
+bool ArchiveNodeReader::begin_map() {
+	const ArchiveNode* node = take();
+	if (node == nullptr || !node->is_map()) return false;
+	stack_.push_back(Container{node, ArchiveNode::Map::begin_write_order(), 0});
+	return true;
+}
+
+bool ArchiveNodeReader::next_key(std::string& key) {
+	Container& c = stack_.back();
+	const ArchiveNode::Map::Entry* entry = c.node->map_->next_in_write_order(c.key);
+	if (entry == nullptr) {
+		stack_.pop_back();
+		return false;
+	}
+	key = entry->key.str();
+	next_ = entry->node;
+	return true;
+}
+
+bool ArchiveNodeReader::begin_array() {
+	const ArchiveNode* node = take();
+	if (node == nullptr || !node->is_array()) return false;
+	stack_.push_back(Container{node, ArchiveNode::Map::begin_write_order(), 0});
+	return true;
+}
+
+bool ArchiveNodeReader::next_element() {
+	Container& c = stack_.back();
+	if (c.index == c.node->array_size()) {
+		stack_.pop_back();
+		return false;
+	}
+	next_ = &(*c.node)[c.index++];
+	return true;
+}
+
+bool ArchiveNodeReader::read(int64& n) {
+	const ArchiveNode* node = take();
+	return node && node->get(n);
+}
+
+bool ArchiveNodeReader::read(float64& f) {
+	const ArchiveNode* node = take();
+	return node && node->get(f);
+}
+
+bool ArchiveNodeReader::read(std::string& s) {
+	const ArchiveNode* node = take();
+	return node && node->get(s);
+}
@@ -0,0 +1,123 @@
+#pragma once
+#ifndef ARCHIVE_READER_HPP_6DWZC3HM
+#define ARCHIVE_READER_HPP_6DWZC3HM
+
+#include "base/basic.hpp"
+#include "base/array.hpp"
+#include "serialization/archive_node_type.hpp"
+#include "serialization/archive_node.hpp"
+#include "serialization/object_table.hpp"
+#include "base/arena.hpp"
+#include <map>
+#include <string>
+
+struct Archive;
+struct ObjectTypeBase;
+struct SimpleType;
+struct IUniverse;
+struct DeserializeReferenceBase;
+struct DeserializeSignalBase;
+
+// A cursor over serialized values, read in the order they were written, so a document
+// can be deserialized without building a tree of ArchiveNodes first.
+//
+// Every call except peek() and the end of a map or array consumes exactly one value,
+// and returns false if it was not of the requested kind. A map is read by calling
+// next_key() until it returns false, and consuming one value after each key.
+struct ArchiveReader {
+	typedef ArchiveNodeType::Type NodeType;
+	
+	virtual ~ArchiveReader() {}
+	
+	// The type of the next value, without consuming it. null reads as Empty.
+	virtual NodeType peek() = 0;
+	virtual bool begin_map() = 0;
+	// Reads the next key of the innermost map, or consumes its end and returns false.
+	virtual bool next_key(std::string& key) = 0;
+	virtual bool begin_array() = 0;
+	// Returns true if the innermost array has another element, or consumes its end and returns false.
+	virtual bool next_element() = 0;
+	virtual bool read(int64& n) = 0;
+	virtual bool read(float64& f) = 0;
+	virtual bool read(std::string& s) = 0;
+	virtual void skip() = 0;
+	
+	// Readers of keyless records know which property each value of a record belongs to.
+	// If the innermost map is one, sets 'ordinal' to the property of 'type' that the key
+	// last read by next_key() names, or -1 if there is none, and returns true.
+	virtual bool field_ordinal(const ObjectTypeBase& type, ptrdiff_t& ordinal) { return false; }
+	
+	// If the next value is a packed array whose elements are stored as 'element_type' is
+	// in memory, sets 'count' and returns true, and read_packed() must be called next to
+	// copy the elements to 'out', 'stride' bytes apart. Otherwise consumes nothing.
+	virtual bool begin_packed_array(const SimpleType& element_type, size_t& count) { return false; }
+	virtual void read_packed(byte* out, size_t stride) {}
+	
+	bool failed() const { return error_.size() != 0; }
+	const std::string& error() const { return error_; }
+	
+	// Reads the next value into nodes of 'archive', for types that can only deserialize from nodes.
+	ArchiveNode& read_node(Archive& archive);
+	void read_node(ArchiveNode& node);
+	
+	// Step into and out of whatever wraps the root object of a document.
+	virtual bool begin_document() { return true; }
+	virtual bool end_document() { return true; }
+	
+	// References and signals are resolved by perform_deferred() once every object exists.
+	// Readers created for part of a document pass the reader of the whole document as
+	// 'parent', which collects them instead.
+	void register_reference_for_deserialization(DeserializeReferenceBase* ref);
+	void register_signal_for_deserialization(DeserializeSignalBase* sig);
+	void perform_deferred(IUniverse& universe);
+	// The objects that references read as indices point to. Formats that store them fill
+	// it in while reading the document.
+	virtual ObjectTable& object_table() { return object_table_; }
+	// Hands the references and signals collected so far over to 'archive', which resolves
+	// them with the rest of its document.
+	void move_deferred_to(Archive& archive);
+	// Where the records are allocated: the arena of the parent if there is one. They are
+	// released with the reader.
+	Arena& fixup_arena() { return parent_ ? parent_->fixup_arena() : arena_; }
+protected:
+	explicit ArchiveReader(ArchiveReader* parent = nullptr) : parent_(parent) {}
+	void set_error(std::string message) { if (!failed()) error_ = std::move(message); }
+private:
+	ArchiveReader* parent_;
+	std::string error_;
+	Array<DeserializeReferenceBase*> deserialize_references_;
+	Array<DeserializeSignalBase*> deserialize_signals_;
+	ObjectTable object_table_;
+	Arena arena_;
+};
+
+// Reads an existing node tree through the cursor interface.
+struct ArchiveNodeReader : ArchiveReader {
+	explicit ArchiveNodeReader(const ArchiveNode& node, ArchiveReader* parent = nullptr) : ArchiveReader(parent), root_(&node), next_(&node) {}
+	
+	NodeType peek() override;
+	bool begin_map() override;
+	bool next_key(std::string& key) override;
+	bool begin_array() override;
+	bool next_element() override;
+	bool read(int64& n) override;
+	bool read(float64& f) override;
+	bool read(std::string& s) override;
+	void skip() override { next_ = nullptr; }
+	// Indices in the tree refer to its archive's table.
+	ObjectTable& object_table() override;
+private:
+	struct Container {
+		const ArchiveNode* node;
+		ArchiveNode::Map::Cursor key; // maps are read in write order
+		size_t index;
+	};
+	
+	const ArchiveNode* take() { const ArchiveNode* n = next_; next_ = nullptr; return n; }
+	
+	const ArchiveNode* root_;
+	const ArchiveNode* next_;
+	Array<Container> stack_;
+};
+
+#endif /* end of include guard: ARCHIVE_READER_HPP_6DWZC3HM */
@@ -0,0 +1,57 @@
+#include "serialization/archive_writer.hpp"
+#include "serialization/archive_node.hpp"
+#include "object/object.hpp"
+#include "object/universe.hpp"
+#include "object/struct_type.hpp"
+
+void ArchiveWriter::begin_object(const ObjectTypeBase& type) {
+	begin_map();
+	key("class");
+	value(type.name());
+}
+
+void ArchiveWriter::write_document(const Object& object, IUniverse& universe) {
+	begin_document();
+	get_type(&object)->serialize(reinterpret_cast<const byte*>(&object), *this, universe);
+	end_document();
+}
+
+void ArchiveWriter::write_document(const ArchiveNode& root) {
+	begin_document();
+	write_node(root);
+	end_document();
+}
+
+void ArchiveWriter::reference(const Object* object, const IUniverse& universe) {
+	if (object != nullptr) {
+		value(universe.get_id(object));
+	} else {
+		null();
+	}
+}
+
+void ArchiveWriter::write_node(const ArchiveNode& node) {
+	switch (node.type()) {
+		case ArchiveNodeType::Empty: null(); break;
+		case ArchiveNodeType::Array: {
+			begin_array();
+			for (size_t i = 0; i < node.array_size(); ++i) {
+				write_node(node[i]);
+			}
+			end_array();
+			break;
+		}
+		case ArchiveNodeType::Map: {
+			begin_map();
+			node.map_->for_each_in_write_order([this](Symbol k, const ArchiveNode& value) {
+				key(k.str());
+				write_node(value);
+			});
+			end_map();
+			break;
+		}
+		case ArchiveNodeType::Integer: value(node.integer_value); break;
+		case ArchiveNodeType::Float: value(node.float_value); break;
+		case ArchiveNodeType::String: value(*node.string_); break;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef ARCHIVE_WRITER_HPP_R2KQ7ZWD
+#define ARCHIVE_WRITER_HPP_R2KQ7ZWD
+
+#include "base/basic.hpp"
+#include <string>
+
+struct Object;
+struct ObjectTypeBase;
+struct SimpleType;
+struct ArchiveNode;
+struct IUniverse;
+
+// Receives serialized values as a stream of events, so they can be written out
+// without building a tree of ArchiveNodes first. Every value in a map is preceded
+// by its key(), and every value is exactly one scalar or one begin/end pair.
+struct ArchiveWriter {
+	virtual ~ArchiveWriter() {}
+	
+	virtual void begin_map() = 0;
+	virtual void key(const std::string& name) = 0;
+	virtual void end_map() = 0;
+	virtual void begin_array() = 0;
+	virtual void end_array() = 0;
+	virtual void null() = 0;
+	virtual void value(int64 n) = 0;
+	virtual void value(float64 f) = 0;
+	virtual void value(const std::string& s) = 0;
+	
+	// An object of 'type', followed by a key and a value for every property in ordinal
+	// order (see ObjectTypeBase::property_at). Written as a map with "class" first unless
+	// the writer has something more compact.
+	virtual void begin_object(const ObjectTypeBase& type);
+	virtual void end_object() { end_map(); }
+	
+	// Writes 'count' numbers or vectors of 'element_type', 'stride' bytes apart, as one
+	// array in a single copy. Returns false without writing anything if the writer has no
+	// packed form, in which case the elements are written one by one.
+	virtual bool packed_array(const SimpleType& element_type, const byte* data, size_t count, size_t stride) { return false; }
+	
+	// Writes the ID of 'object' in 'universe', or null. Writers with an object table
+	// write an index into it instead.
+	virtual void reference(const Object* object, const IUniverse& universe);
+	
+	// Writes 'object' as the root of a document.
+	void write_document(const Object& object, IUniverse& universe);
+	// Writes an existing node tree as the root of a document.
+	void write_document(const ArchiveNode& root);
+	// Replays an existing node tree as events.
+	void write_node(const ArchiveNode& node);
+protected:
+	virtual void begin_document() {}
+	virtual void end_document() {}
+};
+
+#endif /* end of include guard: ARCHIVE_WRITER_HPP_R2KQ7ZWD */
@@ -0,0 +1,58 @@
+#include "serialization/binary_archive.hpp"
+#include "serialization/binary_archive_writer.hpp"
+#include "serialization/binary_archive_reader.hpp"
+
+BinaryArchive::BinaryArchive() : root_(nullptr) {
+	empty_ = make_internal();
+}
+
+BinaryArchiveNode* BinaryArchive::make_internal(ArchiveNode::Type node_type) {
+	return nodes_.allocate(*this, node_type);
+}
+
+ArchiveNode& BinaryArchive::root() {
+	if (root_ == nullptr) {
+		root_ = make_internal(ArchiveNodeType::Map);
+	}
+	return *root_;
+}
+
+const ArchiveNode& BinaryArchive::root() const {
+	ASSERT(root_ != nullptr);
+	return *root_;
+}
+
+void BinaryArchive::write(std::ostream& os) const {
+	BinaryArchiveWriter writer(&os);
+	writer.preset_object_table(object_table().ids);
+	writer.write_document(root_ != nullptr ? *root_ : *empty_);
+}
+
+bool BinaryArchive::read(const char* data, size_t len, std::string* out_error) {
+	BinaryArchiveNode* document = make_internal();
+	BinaryArchiveReader reader(data, len);
+	if (reader.begin_document()) {
+		reader.read_node(*document);
+	}
+	if (!reader.end_document()) {
+		if (out_error) *out_error = reader.error();
+		return false;
+	}
+	root_ = document;
+	object_table().clear();
+	object_table().ids = std::move(reader.object_table().ids);
+	return true;
+}
+
+const ArchiveNode& BinaryArchive::operator[](const std::string& key) const {
+	return root()[key];
+}
+
+ArchiveNode& BinaryArchive::operator[](const std::string& key) {
+	return root()[key];
+}
+
+void BinaryArchiveNode::write(std::ostream& os) const {
+	BinaryArchiveWriter writer(&os);
+	writer.write_node(*this);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef BINARY_ARCHIVE_HPP_W9CN3PFU
+#define BINARY_ARCHIVE_HPP_W9CN3PFU
+
+#include "serialization/archive.hpp"
+#include "serialization/archive_node.hpp"
+#include "base/bag.hpp"
+#include <string>
+
+struct BinaryArchive;
+
+struct BinaryArchiveNode : ArchiveNode {
+	BinaryArchiveNode(BinaryArchive& archive, ArchiveNodeType::Type t = ArchiveNodeType::Empty);
+	// Writes the node's value, without the document header.
+	void write(std::ostream& os) const override;
+};
+
+// An Archive stored in the compact binary format described in binary_format.hpp.
+struct BinaryArchive : Archive {
+	BinaryArchive();
+	ArchiveNode& root() override;
+	const ArchiveNode& root() const override;
+	void write(std::ostream& os) const override;
+	// Reads a document written by write() or BinaryArchiveWriter, replacing the root and the object table.
+	// Returns false and describes the problem in 'out_error' if the input is not valid.
+	bool read(const char* data, size_t len, std::string* out_error = nullptr);
+	const ArchiveNode& operator[](const std::string& key) const override;
+	ArchiveNode& operator[](const std::string& key) override;
+	ArchiveNode* make(ArchiveNode::Type t = ArchiveNodeType::Empty) override { return make_internal(t); }
+	
+	const ArchiveNode& empty() const { return *empty_; }
+	// The nodes made so far, including the empty node.
+	size_t num_nodes() const { return nodes_.size(); }
+protected:
+	Archive* new_fragment() const override { return new BinaryArchive; }
+	bool references_by_index() const override { return true; }
+private:
+	friend struct BinaryArchiveNode;
+	BinaryArchiveNode* empty_;
+	BinaryArchiveNode* root_;
+	ContainedBag<BinaryArchiveNode> nodes_;
+	BinaryArchiveNode* make_internal(ArchiveNodeType::Type t = ArchiveNodeType::Empty);
+};
+
+inline BinaryArchiveNode::BinaryArchiveNode(BinaryArchive& archive, ArchiveNode::Type t) : ArchiveNode(archive, t) {}
+
+#endif /* end of include guard: BINARY_ARCHIVE_HPP_W9CN3PFU */
@@ -0,0 +1,457 @@
+#include "serialization/binary_archive_reader.hpp"
+#include "object/struct_type.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+bool BinaryArchiveReader::fail(const char* message) {
+	if (!failed()) {
+		std::stringstream ss;
+		ss << message << " at offset " << (p_ - begin_) << ".";
+		set_error(ss.str());
+	}
+	return false;
+}
+
+// The class of a record is not in the input, so consuming it consumes nothing.
+bool BinaryArchiveReader::take_class_name() {
+	if (class_name_ == nullptr) return false;
+	class_name_ = nullptr;
+	return true;
+}
+
+bool BinaryArchiveReader::tag(uint8& out) {
+	if (failed()) return false;
+	if (p_ == end_) return fail("Unexpected end of input");
+	out = uint8(*p_);
+	if (out == BinaryFormat::End || out > BinaryFormat::Packed) return fail("Invalid tag");
+	return true;
+}
+
+ArchiveReader::NodeType BinaryArchiveReader::peek() {
+	if (class_name_ != nullptr) return ArchiveNodeType::String;
+	if (in_packed()) {
+		if (stack_.back().schema == PackedVectors) return ArchiveNodeType::Array;
+		return packed_.kind == BinaryFormat::PackedFloat ? ArchiveNodeType::Float : ArchiveNodeType::Integer;
+	}
+	uint8 t;
+	if (!tag(t)) return ArchiveNodeType::Empty;
+	switch (t) {
+		case BinaryFormat::Integer: return ArchiveNodeType::Integer;
+		case BinaryFormat::Float32: case BinaryFormat::Float64: return ArchiveNodeType::Float;
+		case BinaryFormat::String: return ArchiveNodeType::String;
+		case BinaryFormat::Map: case BinaryFormat::Record: return ArchiveNodeType::Map;
+		case BinaryFormat::Array: case BinaryFormat::Packed: return ArchiveNodeType::Array;
+		default: return ArchiveNodeType::Empty;
+	}
+}
+
+// Consumes the tag of the next value if it is 't'. Otherwise skips the whole value.
+bool BinaryArchiveReader::expect(BinaryFormat::Tag t) {
+	if (take_class_name()) return false;
+	uint8 actual;
+	if (!tag(actual)) return false;
+	if (actual != t) {
+		skip();
+		return false;
+	}
+	++p_;
+	return true;
+}
+
+bool BinaryArchiveReader::push(ptrdiff_t schema) {
+	if (int(stack_.size()) >= MaxDepth) return fail("Nesting too deep");
+	stack_.push_back(Container{schema, 0});
+	return true;
+}
+
+// Reads the schema reference of a record whose tag has been consumed, and steps into it.
+bool BinaryArchiveReader::open_record() {
+	uint64 ref;
+	if (!varint(ref)) return false;
+	if (ref != 0) {
+		if (ref > schemas_.size()) return fail("Invalid schema reference");
+		return push(ptrdiff_t(ref - 1));
+	}
+	
+	Schema schema;
+	uint64 count;
+	if (!string(schema.class_name) || !fixed(schema.hash, 8) || !varint(count)) return false;
+	// Every field takes at least two bytes, which bounds the count by the input left.
+	if (count > uint64(end_ - p_) / 2) return fail("Invalid schema");
+	schema.fields.reserve(size_t(count));
+	std::string type_name;
+	for (uint64 i = 0; i < count; ++i) {
+		schema.fields.push_back(std::string());
+		if (!string(schema.fields.back()) || !string(type_name)) return false;
+	}
+	schema.type = nullptr;
+	schemas_.push_back(std::move(schema));
+	return push(ptrdiff_t(schemas_.size() - 1));
+}
+
+// Reads the layout and element count of a packed array whose tag has been consumed.
+bool BinaryArchiveReader::packed_header(BinaryFormat::PackedLayout& layout, uint64& count) {
+	if (size_t(end_ - p_) < 3) return fail("Unexpected end of input");
+	layout.kind = uint8(p_[0]);
+	layout.width = uint8(p_[1]);
+	layout.components = uint8(p_[2]);
+	p_ += 3;
+	if (!layout.is_valid()) return fail("Invalid packed array");
+	if (!varint(count)) return false;
+	if (count > uint64(end_ - p_) / layout.element_size()) return fail("Unexpected end of input");
+	return true;
+}
+
+// Consumes the next number of the innermost packed array.
+bool BinaryArchiveReader::packed_number(uint64& bits) {
+	--stack_.back().keys_read;
+	return fixed(bits, packed_.width);
+}
+
+// Consumes the end of the innermost container, if that is what follows.
+bool BinaryArchiveReader::at_end() {
+	if (failed()) return true;
+	Container& c = stack_.back();
+	if (c.schema <= PackedNumbers) {
+		if (c.keys_read != 0) return false;
+		stack_.pop_back();
+		return true;
+	}
+	if (c.schema >= 0) {
+		if (c.keys_read != schemas_[c.schema].fields.size() + 1) return false;
+		stack_.pop_back();
+		return true;
+	}
+	if (p_ == end_) {
+		fail("Unexpected end of input");
+		return true;
+	}
+	if (uint8(*p_) == BinaryFormat::End) {
+		++p_;
+		stack_.pop_back();
+		return true;
+	}
+	return false;
+}
+
+bool BinaryArchiveReader::varint(uint64& out) {
+	out = 0;
+	for (size_t i = 0; i < BinaryFormat::MaxVarintLength; ++i) {
+		if (p_ == end_) return fail("Unexpected end of input");
+		uint8 b = uint8(*p_++);
+		out |= uint64(b & 0x7f) << (7 * i);
+		if ((b & 0x80) == 0) return true;
+	}
+	return fail("Invalid varint");
+}
+
+bool BinaryArchiveReader::fixed(uint64& out, size_t bytes) {
+	if (size_t(end_ - p_) < bytes) return fail("Unexpected end of input");
+	out = 0;
+	for (size_t i = 0; i < bytes; ++i) {
+		out |= uint64(uint8(p_[i])) << (8 * i);
+	}
+	p_ += bytes;
+	return true;
+}
+
+bool BinaryArchiveReader::string(std::string& out, bool is_key) {
+	uint64 ref;
+	if (!varint(ref)) return false;
+	// Before version 5 keys were stored as they are, and the seventh string could not be a key.
+	if (is_key && version_ >= 5) ref = BinaryFormat::key_decode(ref);
+	if (ref != 0) {
+		if (ref > strings_.size()) return fail("Invalid string reference");
+		out = strings_[ref - 1];
+		return true;
+	}
+	uint64 len;
+	if (!varint(len)) return false;
+	if (uint64(end_ - p_) < len) return fail("Unexpected end of input");
+	out.assign(p_, size_t(len));
+	p_ += len;
+	if (len <= BinaryFormat::MaxInternedLength) {
+		strings_.push_back(out);
+	}
+	return true;
+}
+
+bool BinaryArchiveReader::begin_map() {
+	if (in_packed()) {
+		skip();
+		return false;
+	}
+	if (take_class_name()) return false;
+	uint8 t;
+	if (!tag(t)) return false;
+	if (t == BinaryFormat::Map) {
+		++p_;
+		return push(-1);
+	}
+	if (t == BinaryFormat::Record) {
+		++p_;
+		return open_record();
+	}
+	skip();
+	return false;
+}
+
+bool BinaryArchiveReader::next_key(std::string& key) {
+	if (at_end()) return false;
+	Container& c = stack_.back();
+	if (c.schema < 0) return string(key, true);
+	const Schema& schema = schemas_[c.schema];
+	if (c.keys_read == 0) {
+		key = "class";
+		class_name_ = &schema.class_name;
+	} else {
+		key = schema.fields[c.keys_read - 1];
+	}
+	++c.keys_read;
+	return true;
+}
+
+bool BinaryArchiveReader::begin_array() {
+	if (in_packed()) {
+		if (stack_.back().schema != PackedVectors) {
+			skip();
+			return false;
+		}
+		--stack_.back().keys_read;
+		if (!push(PackedNumbers)) return false;
+		stack_.back().keys_read = packed_.components;
+		return true;
+	}
+	if (take_class_name()) return false;
+	uint8 t;
+	if (!tag(t)) return false;
+	if (t == BinaryFormat::Packed) {
+		++p_;
+		uint64 count;
+		if (!packed_header(packed_, count) || !push(packed_.components == 1 ? PackedNumbers : PackedVectors)) return false;
+		stack_.back().keys_read = size_t(count);
+		return true;
+	}
+	if (t != BinaryFormat::Array) {
+		skip();
+		return false;
+	}
+	++p_;
+	return push(-1);
+}
+
+bool BinaryArchiveReader::begin_packed_array(const SimpleType& element_type, size_t& count) {
+	if (class_name_ != nullptr || in_packed() || failed() || p_ == end_ || uint8(*p_) != BinaryFormat::Packed) return false;
+	const char* start = p_++;
+	BinaryFormat::PackedLayout layout;
+	uint64 n;
+	if (!packed_header(layout, n)) return false;
+	if (layout != BinaryFormat::packed_layout(element_type)) {
+		p_ = start;
+		return false;
+	}
+	packed_ = layout;
+	packed_count_ = count = size_t(n);
+	return true;
+}
+
+void BinaryArchiveReader::read_packed(byte* out, size_t stride) {
+	size_t element_size = packed_.element_size();
+	if (stride == element_size) {
+		memcpy(out, p_, packed_count_ * element_size);
+	} else {
+		for (size_t i = 0; i < packed_count_; ++i) {
+			memcpy(out + i * stride, p_ + i * element_size, element_size);
+		}
+	}
+	if (!BinaryFormat::is_little_endian()) {
+		for (size_t i = 0; i < packed_count_; ++i) {
+			for (size_t j = 0; j < packed_.components; ++j) {
+				byte* component = out + i * stride + j * packed_.width;
+				std::reverse(component, component + packed_.width);
+			}
+		}
+	}
+	p_ += packed_count_ * element_size;
+	packed_count_ = 0;
+}
+
+bool BinaryArchiveReader::next_element() {
+	return !at_end();
+}
+
+bool BinaryArchiveReader::read(int64& n) {
+	if (in_packed()) {
+		uint64 bits;
+		if (stack_.back().schema != PackedNumbers || packed_.kind == BinaryFormat::PackedFloat || !packed_number(bits)) {
+			skip();
+			return false;
+		}
+		if (packed_.kind == BinaryFormat::PackedSigned && packed_.width < 8) {
+			size_t shift = 64 - 8 * packed_.width;
+			n = int64(bits << shift) >> shift;
+		} else {
+			n = int64(bits);
+		}
+		return true;
+	}
+	if (!expect(BinaryFormat::Integer)) return false;
+	uint64 bits;
+	if (!varint(bits)) return false;
+	n = BinaryFormat::zigzag_decode(bits);
+	return true;
+}
+
+bool BinaryArchiveReader::read(float64& f) {
+	uint64 bits;
+	if (in_packed()) {
+		if (stack_.back().schema != PackedNumbers || packed_.kind != BinaryFormat::PackedFloat || !packed_number(bits)) {
+			skip();
+			return false;
+		}
+		if (packed_.width == 4) {
+			uint32 narrow_bits = uint32(bits);
+			float32 narrow;
+			memcpy(&narrow, &narrow_bits, sizeof(narrow));
+			f = narrow;
+		} else {
+			memcpy(&f, &bits, sizeof(f));
+		}
+		return true;
+	}
+	if (take_class_name()) return false;
+	uint8 t;
+	if (!tag(t)) return false;
+	if (t == BinaryFormat::Float32) {
+		++p_;
+		if (!fixed(bits, 4)) return false;
+		uint32 narrow_bits = uint32(bits);
+		float32 narrow;
+		memcpy(&narrow, &narrow_bits, sizeof(narrow));
+		f = narrow;
+		return true;
+	}
+	if (t == BinaryFormat::Float64) {
+		++p_;
+		if (!fixed(bits, 8)) return false;
+		memcpy(&f, &bits, sizeof(f));
+		return true;
+	}
+	skip();
+	return false;
+}
+
+bool BinaryArchiveReader::read(std::string& s) {
+	if (in_packed()) {
+		skip();
+		return false;
+	}
+	if (class_name_ != nullptr) {
+		s = *class_name_;
+		class_name_ = nullptr;
+		return true;
+	}
+	return expect(BinaryFormat::String) && string(s);
+}
+
+void BinaryArchiveReader::skip() {
+	if (failed()) return;
+	if (in_packed()) {
+		Container& c = stack_.back();
+		if (c.keys_read == 0) return;
+		--c.keys_read;
+		p_ += c.schema == PackedVectors ? packed_.element_size() : packed_.width;
+		return;
+	}
+	if (take_class_name()) return;
+	uint8 t;
+	if (!tag(t)) return;
+	++p_;
+	uint64 bits;
+	std::string scratch;
+	BinaryFormat::PackedLayout layout;
+	switch (t) {
+		case BinaryFormat::Null: return;
+		case BinaryFormat::Integer: varint(bits); return;
+		case BinaryFormat::Float32: fixed(bits, 4); return;
+		case BinaryFormat::Float64: fixed(bits, 8); return;
+		case BinaryFormat::String: string(scratch); return;
+		case BinaryFormat::Map: {
+			if (!push(-1)) return;
+			while (next_key(scratch)) skip();
+			return;
+		}
+		case BinaryFormat::Record: {
+			if (!open_record()) return;
+			while (next_key(scratch)) skip();
+			return;
+		}
+		case BinaryFormat::Array: {
+			if (!push(-1)) return;
+			while (next_element()) skip();
+			return;
+		}
+		case BinaryFormat::Packed: {
+			if (packed_header(layout, bits)) p_ += size_t(bits) * layout.element_size();
+			return;
+		}
+	}
+}
+
+bool BinaryArchiveReader::field_ordinal(const ObjectTypeBase& type, ptrdiff_t& ordinal) {
+	if (stack_.size() == 0 || stack_.back().schema < 0) return false;
+	const Container& c = stack_.back();
+	if (c.keys_read <= 1) {
+		ordinal = -1;
+		return true;
+	}
+	Schema& schema = schemas_[c.schema];
+	if (schema.type != &type) {
+		map_fields(schema, type);
+	}
+	ordinal = schema.ordinals[c.keys_read - 2];
+	return true;
+}
+
+// Works out which property of 'type' each field of 'schema' belongs to.
+void BinaryArchiveReader::map_fields(Schema& schema, const ObjectTypeBase& type) {
+	schema.type = &type;
+	schema.ordinals.clear();
+	size_t n = type.num_properties();
+	if (schema.hash == BinaryFormat::schema_hash(type) && schema.fields.size() == n) {
+		for (size_t i = 0; i < n; ++i) schema.ordinals.push_back(ptrdiff_t(i));
+		return;
+	}
+	for (auto& field: schema.fields) {
+		Symbol name;
+		schema.ordinals.push_back(Symbol::find(field, name) ? type.property_ordinal(name) : -1);
+	}
+}
+
+bool BinaryArchiveReader::begin_document() {
+	if (failed()) return false;
+	if (size_t(end_ - p_) < BinaryFormat::MagicLength + 1 || memcmp(p_, BinaryFormat::magic(), BinaryFormat::MagicLength) != 0) {
+		return fail("Expected a binary document");
+	}
+	p_ += BinaryFormat::MagicLength;
+	version_ = uint8(*p_);
+	if (version_ == 0 || version_ > BinaryFormat::Version) return fail("Unsupported version");
+	++p_;
+	return true;
+}
+
+bool BinaryArchiveReader::finish() {
+	if (failed()) return false;
+	if (version_ >= 3 && p_ != end_) {
+		if (!begin_array()) return fail("Invalid object table");
+		std::string id;
+		while (next_element()) {
+			if (!read(id)) return fail("Invalid object table");
+			object_table().ids.push_back(std::move(id));
+		}
+		if (failed()) return false;
+	}
+	if (p_ != end_) return fail("Unexpected data after the document");
+	return true;
+}
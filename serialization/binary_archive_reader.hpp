@@ -0,0 +1,87 @@
+#pragma once
+#ifndef BINARY_ARCHIVE_READER_HPP_T7QJ4ELB
+#define BINARY_ARCHIVE_READER_HPP_T7QJ4ELB
+
+#include "serialization/archive_reader.hpp"
+#include "serialization/binary_format.hpp"
+
+// Pull parser over the binary format described in binary_format.hpp. Besides the
+// string and schema tables, only the stack of open containers is kept. Errors are
+// reported through error() with the byte offset they were found at.
+//
+// Records read as maps with "class" first. The properties of a record are matched to
+// those of the type reading it once per schema: when the schema hash matches they are
+// taken in order, otherwise they are remapped by name. Packed arrays are copied out
+// whole by begin_packed_array(), and otherwise read a number at a time.
+struct BinaryArchiveReader : ArchiveReader {
+	static const int MaxDepth = 512;
+	
+	BinaryArchiveReader(const char* data, size_t len) : begin_(data), p_(data), end_(data + len), class_name_(nullptr), packed_count_(0), version_(BinaryFormat::Version) {}
+	
+	NodeType peek() override;
+	bool begin_map() override;
+	bool next_key(std::string& key) override;
+	bool begin_array() override;
+	bool next_element() override;
+	bool read(int64& n) override;
+	bool read(float64& f) override;
+	bool read(std::string& s) override;
+	void skip() override;
+	bool field_ordinal(const ObjectTypeBase& type, ptrdiff_t& ordinal) override;
+	bool begin_packed_array(const SimpleType& element_type, size_t& count) override;
+	void read_packed(byte* out, size_t stride) override;
+	
+	// Checks the header.
+	bool begin_document() override;
+	bool end_document() override { return finish(); }
+	// Reads the object table, and checks that nothing follows it.
+	bool finish();
+private:
+	struct Schema {
+		std::string class_name;
+		uint64 hash;
+		Array<std::string> fields;
+		const ObjectTypeBase* type;  // the type 'ordinals' were worked out for
+		Array<ptrdiff_t> ordinals;   // per field, the property of 'type' it belongs to, or -1
+	};
+	
+	// Schemas of containers that are not records.
+	enum {
+		PlainContainer = -1, // a map or an array
+		PackedNumbers = -2,  // the numbers of a packed array, or the components of one of its vectors
+		PackedVectors = -3,  // the vectors of a packed array
+	};
+	
+	struct Container {
+		ptrdiff_t schema;
+		size_t keys_read; // for records: "class" and the fields; for packed arrays: the values left
+	};
+	
+	const char* begin_;
+	const char* p_;
+	const char* end_;
+	Array<Container> stack_;
+	Array<std::string> strings_;
+	Array<Schema> schemas_;
+	const std::string* class_name_; // the value after the "class" key of a record
+	BinaryFormat::PackedLayout packed_; // of the innermost packed array
+	size_t packed_count_; // elements left for read_packed()
+	uint8 version_;
+	
+	bool fail(const char* message);
+	bool take_class_name();
+	bool tag(uint8& out);
+	bool expect(BinaryFormat::Tag t);
+	bool push(ptrdiff_t schema);
+	bool open_record();
+	bool packed_header(BinaryFormat::PackedLayout& layout, uint64& count);
+	bool in_packed() const { return stack_.size() && stack_.back().schema <= PackedNumbers; }
+	bool packed_number(uint64& bits);
+	bool at_end();
+	void map_fields(Schema& schema, const ObjectTypeBase& type);
+	bool varint(uint64& out);
+	bool fixed(uint64& out, size_t bytes);
+	bool string(std::string& out, bool is_key = false);
+};
+
+#endif /* end of include guard: BINARY_ARCHIVE_READER_HPP_T7QJ4ELB */
@@ -0,0 +1,181 @@
+#include "serialization/binary_archive_writer.hpp"
+#include "object/struct_type.hpp"
+#include "object/universe.hpp"
+#include <cstring>
+
+void BinaryArchiveWriter::flush() {
+	if (os_ && buffer_.size()) {
+		os_->write(buffer_.data(), buffer_.size());
+		buffer_.clear();
+	}
+}
+
+void BinaryArchiveWriter::begin_document() {
+	buffer_.append(BinaryFormat::magic(), BinaryFormat::MagicLength);
+	buffer_ += char(BinaryFormat::Version);
+}
+
+void BinaryArchiveWriter::end_document() {
+	if (object_ids_.size()) {
+		begin_array();
+		for (auto& id: object_ids_) {
+			value(id);
+		}
+		end_array();
+	}
+	flush();
+}
+
+void BinaryArchiveWriter::reference(const Object* object, const IUniverse& universe) {
+	if (object == nullptr) {
+		null();
+		return;
+	}
+	auto it = objects_.find(object);
+	if (it == objects_.end()) {
+		it = objects_.insert(std::make_pair(object, uint32(object_ids_.size()))).first;
+		object_ids_.push_back(universe.get_id(object));
+	}
+	value(int64(it->second));
+}
+
+void BinaryArchiveWriter::varint(uint64 n) {
+	while (n >= 0x80) {
+		buffer_ += char(0x80 | (n & 0x7f));
+		n >>= 7;
+	}
+	buffer_ += char(n);
+}
+
+void BinaryArchiveWriter::string(const std::string& s, bool is_key) {
+	auto it = strings_.find(s);
+	if (it != strings_.end()) {
+		uint64 ref = uint64(it->second) + 1;
+		varint(is_key ? BinaryFormat::key_encode(ref) : ref);
+		return;
+	}
+	varint(0);
+	varint(s.size());
+	buffer_.append(s);
+	if (s.size() <= BinaryFormat::MaxInternedLength) {
+		uint32 index = uint32(strings_.size());
+		strings_[s] = index;
+	}
+	maybe_flush();
+}
+
+void BinaryArchiveWriter::fixed(uint64 bits, size_t bytes) {
+	// Going through the bit pattern keeps the byte order little-endian on any host.
+	for (size_t i = 0; i < bytes; ++i) buffer_ += char(bits >> (8 * i));
+}
+
+void BinaryArchiveWriter::begin_map() {
+	tag(BinaryFormat::Map);
+	stack_.push_back(Container{false, 0});
+}
+
+void BinaryArchiveWriter::key(const std::string& name) {
+	if (stack_.size() && stack_.back().is_record) {
+		// The schema has the names; records only have the values, in ordinal order.
+		ASSERT(stack_.back().fields_left != 0);
+		--stack_.back().fields_left;
+		return;
+	}
+	string(name, true);
+}
+
+void BinaryArchiveWriter::end_map() {
+	ASSERT(stack_.size() && !stack_.back().is_record);
+	stack_.pop_back();
+	tag(BinaryFormat::End);
+	maybe_flush();
+}
+
+void BinaryArchiveWriter::begin_array() {
+	tag(BinaryFormat::Array);
+	stack_.push_back(Container{false, 0});
+}
+
+void BinaryArchiveWriter::end_array() {
+	ASSERT(stack_.size() && !stack_.back().is_record);
+	stack_.pop_back();
+	tag(BinaryFormat::End);
+	maybe_flush();
+}
+
+void BinaryArchiveWriter::begin_object(const ObjectTypeBase& type) {
+	tag(BinaryFormat::Record);
+	size_t n = type.num_properties();
+	auto it = schemas_.find(&type);
+	if (it != schemas_.end()) {
+		varint(uint64(it->second) + 1);
+	} else {
+		uint32 index = uint32(schemas_.size());
+		schemas_[&type] = index;
+		varint(0);
+		string(type.name());
+		fixed(BinaryFormat::schema_hash(type), 8);
+		varint(n);
+		for (size_t i = 0; i < n; ++i) {
+			const AttributeBase* property = type.property_at(i);
+			string(property->name());
+			string(property->type()->name());
+		}
+	}
+	stack_.push_back(Container{true, n});
+}
+
+void BinaryArchiveWriter::end_object() {
+	ASSERT(stack_.size() && stack_.back().is_record && stack_.back().fields_left == 0);
+	stack_.pop_back();
+	maybe_flush();
+}
+
+bool BinaryArchiveWriter::packed_array(const SimpleType& element_type, const byte* data, size_t count, size_t stride) {
+	if (!BinaryFormat::is_little_endian()) return false;
+	BinaryFormat::PackedLayout layout = BinaryFormat::packed_layout(element_type);
+	tag(BinaryFormat::Packed);
+	buffer_ += char(layout.kind);
+	buffer_ += char(layout.width);
+	buffer_ += char(layout.components);
+	varint(count);
+	size_t element_size = layout.element_size();
+	if (stride == element_size) {
+		buffer_.append(reinterpret_cast<const char*>(data), count * element_size);
+	} else {
+		for (size_t i = 0; i < count; ++i) {
+			buffer_.append(reinterpret_cast<const char*>(data + i * stride), element_size);
+		}
+	}
+	maybe_flush();
+	return true;
+}
+
+void BinaryArchiveWriter::null() {
+	tag(BinaryFormat::Null);
+}
+
+void BinaryArchiveWriter::value(int64 n) {
+	tag(BinaryFormat::Integer);
+	varint(BinaryFormat::zigzag_encode(n));
+}
+
+void BinaryArchiveWriter::value(float64 f) {
+	float32 narrow = float32(f);
+	if (float64(narrow) == f) {
+		uint32 bits;
+		memcpy(&bits, &narrow, sizeof(bits));
+		tag(BinaryFormat::Float32);
+		fixed(bits, 4);
+	} else {
+		uint64 bits;
+		memcpy(&bits, &f, sizeof(bits));
+		tag(BinaryFormat::Float64);
+		fixed(bits, 8);
+	}
+}
+
+void BinaryArchiveWriter::value(const std::string& s) {
+	tag(BinaryFormat::String);
+	string(s);
+}
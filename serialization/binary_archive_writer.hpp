@@ -0,0 +1,65 @@
+#pragma once
+#ifndef BINARY_ARCHIVE_WRITER_HPP_M5XH2RDC
+#define BINARY_ARCHIVE_WRITER_HPP_M5XH2RDC
+
+#include "serialization/archive_writer.hpp"
+#include "serialization/binary_format.hpp"
+#include "base/array.hpp"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+// Streams serialized values in the binary format described in binary_format.hpp.
+// Objects are written as keyless records, and the schema of each type only once.
+struct BinaryArchiveWriter : ArchiveWriter {
+	// Without a stream, everything accumulates in buffer(). With one, the buffer is
+	// written out whenever it grows past FlushSize, and on flush().
+	explicit BinaryArchiveWriter(std::ostream* os = nullptr) : os_(os) {}
+	~BinaryArchiveWriter() { flush(); }
+	
+	std::string& buffer() { return buffer_; }
+	void flush();
+	
+	void begin_map() override;
+	void key(const std::string& name) override;
+	void end_map() override;
+	void begin_array() override;
+	void end_array() override;
+	void null() override;
+	void value(int64 n) override;
+	void value(float64 f) override;
+	void value(const std::string& s) override;
+	void begin_object(const ObjectTypeBase& type) override;
+	void end_object() override;
+	void reference(const Object* object, const IUniverse& universe) override;
+	bool packed_array(const SimpleType& element_type, const byte* data, size_t count, size_t stride) override;
+	
+	// Starts the object table with 'ids', for replaying a tree whose references index them.
+	void preset_object_table(const Array<std::string>& ids) { object_ids_ = ids; }
+protected:
+	void begin_document() override;
+	void end_document() override;
+private:
+	static const size_t FlushSize = 64 * 1024;
+	void maybe_flush() { if (os_ && buffer_.size() >= FlushSize) flush(); }
+	
+	void tag(BinaryFormat::Tag t) { buffer_ += char(t); }
+	void varint(uint64 n);
+	void string(const std::string& s, bool is_key = false);
+	void fixed(uint64 bits, size_t bytes);
+	
+	struct Container {
+		bool is_record;
+		size_t fields_left; // properties of a record whose keys have not been passed in yet
+	};
+	
+	std::ostream* os_;
+	std::string buffer_;
+	std::unordered_map<std::string, uint32> strings_;
+	std::unordered_map<const ObjectTypeBase*, uint32> schemas_;
+	std::unordered_map<const Object*, uint32> objects_;
+	Array<std::string> object_ids_;
+	Array<Container> stack_;
+};
+
+#endif /* end of include guard: BINARY_ARCHIVE_WRITER_HPP_M5XH2RDC */
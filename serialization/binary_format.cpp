@@ -0,0 +1,37 @@
+#include "serialization/binary_format.hpp"
+#include "object/struct_type.hpp"
+
+namespace {
+	void hash_string(uint64& h, const std::string& s) {
+		for (char c: s) {
+			h ^= uint8(c);
+			h *= 1099511628211ull;
+		}
+		// Terminate it, so that "ab", "c" and "a", "bc" hash differently.
+		h ^= 0xff;
+		h *= 1099511628211ull;
+	}
+}
+
+uint64 BinaryFormat::schema_hash(const ObjectTypeBase& type) {
+	uint64 h = 14695981039346656037ull;
+	hash_string(h, type.name());
+	size_t n = type.num_properties();
+	for (size_t i = 0; i < n; ++i) {
+		const AttributeBase* property = type.property_at(i);
+		hash_string(h, property->name());
+		hash_string(h, property->type()->name());
+	}
+	return h;
+}
+
+BinaryFormat::PackedLayout BinaryFormat::packed_layout(const SimpleType& type) {
+	uint8 kind = type.is_float() ? PackedFloat : type.is_signed() ? PackedSigned : PackedUnsigned;
+	return PackedLayout{kind, uint8(type.component_width()), uint8(type.num_components())};
+}
+
+bool BinaryFormat::PackedLayout::is_valid() const {
+	if (components == 0 || components > 4) return false;
+	if (kind == PackedFloat) return width == 4 || width == 8;
+	return kind <= PackedFloat && (width == 1 || width == 2 || width == 4 || width == 8);
+}
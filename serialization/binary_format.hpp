@@ -0,0 +1,96 @@
+#pragma once
+#ifndef BINARY_FORMAT_HPP_K3TQ8NWA
+#define BINARY_FORMAT_HPP_K3TQ8NWA
+
+#include "base/basic.hpp"
+
+struct ObjectTypeBase;
+struct SimpleType;
+
+// The encoding shared by BinaryArchiveWriter and BinaryArchiveReader.
+//
+// A document is the header (Magic, then Version) followed by one value and, if any
+// references were written, the object table: an Array of the IDs of the objects they
+// point to. Each reference is written as an Integer index into it. Every value
+// starts with a tag byte:
+//   Null
+//   Integer  zigzag varint
+//   Float32  4 bytes little-endian, for doubles that survive the round trip through float
+//   Float64  8 bytes little-endian
+//   String   string reference
+//   Map      (key, value)* End
+//   Array    value* End
+//   Record   schema reference, value*
+//   Packed   element layout, count (varint), the elements
+// A string reference is a varint. Zero is followed by the length as a varint and the
+// bytes; the string is appended to the string table if it is at most MaxInternedLength
+// long. Any other n refers to entry n-1 of the table, so keys, class names and IDs are
+// only spelled out once per document. The key of a map entry is a string reference that
+// is stored one higher from End up, so that it cannot be taken for the End of the map.
+//
+// A record is an object written by ObjectType, with one value per property in ordinal
+// order and no keys. Its schema reference works like a string reference: zero is
+// followed by a new schema, which is added to the schema table, and any other n refers
+// to entry n-1. A schema is the class name (a string reference), its schema_hash() as
+// 8 bytes little-endian, the number of properties as a varint, and the name and type
+// name of each property (string references). Readers present records as maps with
+// "class" first.
+//
+// Arrays of numbers and vectors are packed: their components are stored back to back,
+// little-endian, as they are in memory. The layout is three bytes, the PackedKind of
+// the components, their width in bytes and their number per element. Readers present a
+// packed array as an array of numbers, or of arrays of components, unless the caller
+// takes the elements in one piece.
+struct BinaryFormat {
+	enum Tag : uint8 {
+		Null,
+		Integer,
+		Float32,
+		Float64,
+		String,
+		Map,
+		Array,
+		End,
+		Record,
+		Packed,
+	};
+	
+	enum PackedKind : uint8 {
+		PackedSigned,
+		PackedUnsigned,
+		PackedFloat,
+	};
+	
+	struct PackedLayout {
+		uint8 kind;
+		uint8 width;
+		uint8 components;
+		size_t element_size() const { return size_t(width) * components; }
+		bool is_valid() const;
+		bool operator==(const PackedLayout& other) const { return kind == other.kind && width == other.width && components == other.components; }
+		bool operator!=(const PackedLayout& other) const { return !(*this == other); }
+	};
+	
+	static const size_t MagicLength = 4;
+	static const char* magic() { return "ASPB"; }
+	static const uint8 Version = 5; // 1 had no records, 2 no object table, 3 no packed arrays, 4 keys that read as End
+	static const size_t MaxInternedLength = 64;
+	static const size_t MaxVarintLength = 10;
+	
+	static uint64 zigzag_encode(int64 n) { return (uint64(n) << 1) ^ uint64(n >> 63); }
+	static int64 zigzag_decode(uint64 n) { return int64(n >> 1) ^ -int64(n & 1); }
+	static uint64 key_encode(uint64 ref) { return ref >= End ? ref + 1 : ref; }
+	static uint64 key_decode(uint64 n) { return n > End ? n - 1 : n; }
+	
+	// FNV-1a over the class name and the names and type names of its properties.
+	static uint64 schema_hash(const ObjectTypeBase& type);
+	// How arrays of 'type' are packed.
+	static PackedLayout packed_layout(const SimpleType& type);
+	// Packed elements are copied as they are in memory, which is only the stored byte order on little-endian hosts.
+	static bool is_little_endian() {
+		const uint16 one = 1;
+		return *reinterpret_cast<const uint8*>(&one) == 1;
+	}
+};
+
+#endif /* end of include guard: BINARY_FORMAT_HPP_K3TQ8NWA */
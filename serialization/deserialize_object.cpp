@@ -1,7 +1,10 @@
 #include "serialization/deserialize_object.hpp"
 #include "serialization/archive_node.hpp"
+#include "serialization/archive_reader.hpp"
+#include "serialization/archive.hpp"
 #include "type/type_registry.hpp"
 #include "object/composite_type.hpp"
+#include "object/composite_type_registry.hpp"
 #include "object/struct_type.hpp"
 #include "object/universe.hpp"
 #include <memory>
@@ -9,12 +12,7 @@
 namespace {
 	const DerivedType* get_type_from_map(const ArchiveNode& node, std::string& out_error);
 	
-	const ObjectTypeBase* get_class_from_map(const ArchiveNode& node, std::string& out_error) {
-		std::string clsname;
-		if (!node["class"].get(clsname)) {
-			out_error = "Class not specified.";
-			return nullptr;
-		}
+	const ObjectTypeBase* get_class(const std::string& clsname, std::string& out_error) {
 		const ObjectTypeBase* struct_type = TypeRegistry::get(clsname);
 		if (struct_type == nullptr) {
 			out_error = "Class '" + clsname + "' not registered.";
@@ -23,31 +21,183 @@ namespace {
 		return struct_type;
 	}
 	
-	const DerivedType* transform_if_composite_type(const ArchiveNode& node, const ObjectTypeBase* base_type, std::string& out_error) {
-		const ArchiveNode& aspects = node["aspects"];
+	const ObjectTypeBase* get_class_from_map(const ArchiveNode& node, std::string& out_error) {
+		std::string clsname;
+		if (!node[ArchiveNodeMap::class_key()].get(clsname)) {
+			out_error = "Class not specified.";
+			return nullptr;
+		}
+		return get_class(clsname, out_error);
+	}
+	
+	const DerivedType* transform_if_composite_type(const ArchiveNode& aspects, const ObjectTypeBase* base_type, std::string& out_error) {
 		if (!aspects.is_array()) return base_type;
 		if (aspects.array_size() == 0) return base_type;
 		
-		CompositeType* type = new CompositeType("Composite", base_type);
+		Array<const DerivedType*> aspect_types;
+		aspect_types.reserve(aspects.array_size());
 		for (size_t i = 0; i < aspects.array_size(); ++i) {
 			const ArchiveNode& aspect = aspects[i];
 			const DerivedType* aspect_type = get_type_from_map(aspect, out_error);
 			if (aspect_type == nullptr) {
 				return nullptr;
 			}
-			type->add_aspect(aspect_type);
+			aspect_types.push_back(aspect_type);
 		}
-		type->freeze();
-		return type;
+		return CompositeTypeRegistry::get(base_type, aspect_types);
 	}
 	
 	const DerivedType* get_type_from_map(const ArchiveNode& node, std::string& out_error) {
 		const ObjectTypeBase* struct_type = get_class_from_map(node, out_error);
 		if (struct_type != nullptr) {
-			return transform_if_composite_type(node, struct_type, out_error);
+			return transform_if_composite_type(node[ArchiveNodeMap::aspects_key()], struct_type, out_error);
 		}
 		return nullptr;
 	}
+	
+	ObjectPtr<> create_object(const DerivedType* type, const std::string& id, IUniverse& universe) {
+		ObjectPtr<> ptr = universe.create_object(type, id);
+		if (ptr->object_id() != id) {
+			std::cerr << "WARNING: Object '" << id << "' was renamed to '" << ptr->object_id() << "' because of a collision.\n";
+		}
+		return ptr;
+	}
+	
+	// Reads one entry of the map of an object of 'type'. Returns false if 'key' is not
+	// something the type reads, in which case the value has not been consumed.
+	bool deserialize_entry(const DerivedType* type, byte* place, const std::string& key, ArchiveReader& reader, IUniverse& universe) {
+		const ObjectTypeBase* struct_type;
+		if (type->kind() == TypeKind::Composite) {
+			auto composite = static_cast<const CompositeType*>(type);
+			if (key == "aspects") {
+				composite->deserialize_aspects(place, reader, universe);
+				return true;
+			}
+			struct_type = composite->base_type();
+		} else {
+			struct_type = static_cast<const ObjectTypeBase*>(type);
+		}
+		return struct_type->deserialize_field(place, key, reader, universe);
+	}
+	
+	// Reads the entries of an object's map. The object can only be created once its
+	// class and aspects are known. Writers put those first; entries that come before
+	// them are kept as nodes until then, and so is the "aspects" array, since every
+	// aspect must be known before the object is created.
+	struct ObjectMapReader {
+		ObjectMapReader(ArchiveReader& reader, IUniverse& universe) : reader_(reader), universe_(universe), type_(nullptr), pending_(nullptr), aspects_(nullptr), has_class_(false), has_id_(false) {}
+		ObjectPtr<> read();
+	private:
+		void keep(const std::string& key);
+		bool create();
+		void read_entry(const std::string& key, ArchiveReader& reader);
+		
+		ArchiveReader& reader_;
+		IUniverse& universe_;
+		const DerivedType* type_;
+		ObjectPtr<> object_;
+		std::unique_ptr<ScratchArchive> scratch_;
+		ArchiveNode* pending_;
+		const ArchiveNode* aspects_;
+		std::string class_name_;
+		std::string id_;
+		bool has_class_;
+		bool has_id_;
+	};
+	
+	ObjectPtr<> ObjectMapReader::read() {
+		std::string key;
+		while (reader_.next_key(key)) {
+			if (object_ != nullptr) {
+				read_entry(key, reader_);
+			} else if (key == "class" && !has_class_) {
+				has_class_ = reader_.read(class_name_);
+			} else if (!has_class_ || key == "aspects") {
+				keep(key);
+			} else {
+				// The ID usually comes right after the class, so the object can be created
+				// with it instead of being renamed.
+				bool is_id = key == "id" && !has_id_ && reader_.peek() == ArchiveNodeType::String;
+				if (is_id) {
+					has_id_ = reader_.read(id_);
+				}
+				if (!create()) {
+					if (!is_id) reader_.skip();
+					while (reader_.next_key(key)) reader_.skip();
+					return nullptr;
+				}
+				if (!is_id) read_entry(key, reader_);
+			}
+		}
+		if (object_ == nullptr) {
+			if (!has_class_) {
+				std::cerr << "ERROR: Class not specified.\n";
+				return nullptr;
+			}
+			if (!create()) return nullptr;
+		}
+		if (!has_id_) {
+			std::cerr << "WARNING: Object without id.\n";
+		}
+		return object_;
+	}
+	
+	void ObjectMapReader::keep(const std::string& key) {
+		if (scratch_ == nullptr) {
+			scratch_.reset(new ScratchArchive);
+			pending_ = scratch_->make(ArchiveNodeType::Map);
+		}
+		if (key == "aspects") {
+			aspects_ = &reader_.read_node(*scratch_);
+		} else {
+			has_id_ = has_id_ || key == "id";
+			reader_.read_node((*pending_)[key]);
+		}
+	}
+	
+	bool ObjectMapReader::create() {
+		std::string error;
+		const ObjectTypeBase* base_type = get_class(class_name_, error);
+		type_ = base_type && aspects_ ? transform_if_composite_type(*aspects_, base_type, error) : base_type;
+		if (type_ == nullptr) {
+			std::cerr << "ERROR: " << error << '\n';
+			return false;
+		}
+		
+		// Without an ID yet, the object is named after its class until the "id" property renames it.
+		if (id_.empty() && pending_) {
+			static_cast<const ArchiveNode&>(*pending_)[ArchiveNodeMap::id_key()].get(id_);
+		}
+		if (!id_.empty()) {
+			object_ = create_object(type_, id_, universe_);
+		} else {
+			object_ = universe_.create_object(type_, class_name_);
+		}
+		
+		if (pending_) {
+			ArchiveNodeReader pending_reader(*pending_, &reader_);
+			pending_reader.begin_map();
+			std::string key;
+			while (pending_reader.next_key(key)) {
+				read_entry(key, pending_reader);
+			}
+		}
+		if (aspects_ && type_->kind() == TypeKind::Composite) {
+			ArchiveNodeReader aspects_reader(*aspects_, &reader_);
+			static_cast<const CompositeType*>(type_)->deserialize_aspects(reinterpret_cast<byte*>(object_.get()), aspects_reader, universe_);
+		}
+		return true;
+	}
+	
+	void ObjectMapReader::read_entry(const std::string& key, ArchiveReader& reader) {
+		has_id_ = has_id_ || key == "id";
+		if (!deserialize_entry(type_, reinterpret_cast<byte*>(object_.get()), key, reader, universe_)) {
+			if (key == "aspects") {
+				std::cerr << "WARNING: The aspects of '" << object_->object_id() << "' come after its properties, and were ignored.\n";
+			}
+			reader.skip();
+		}
+	}
 }
 
 ObjectPtr<> deserialize_object(const ArchiveNode& node, IUniverse& universe) {
@@ -64,16 +214,29 @@ ObjectPtr<> deserialize_object(const ArchiveNode& node, IUniverse& universe) {
 	}
 	
 	std::string id;
-	if (!node["id"].get(id)) {
+	if (!node[ArchiveNodeMap::id_key()].get(id)) {
 		std::cerr << "WARNING: Object without id.\n";
 	}
 	
-	ObjectPtr<> ptr = universe.create_object(type, id);
-	if (ptr->object_id() != id) {
-		std::cerr << "WARNING: Object '" << id << "' was renamed to '" << ptr->object_id() << "' because of a collision.\n";
-	}
-	
+	ObjectPtr<> ptr = create_object(type, id, universe);
 	type->deserialize(reinterpret_cast<byte*>(ptr.get()), node, universe);
 	
 	return ptr;
 }
+
+ObjectPtr<> deserialize_object(ArchiveReader& reader, IUniverse& universe) {
+	if (!reader.begin_map()) {
+		std::cerr << "Expected object, got non-map.\n";
+		return nullptr;
+	}
+	ObjectMapReader map_reader(reader, universe);
+	return map_reader.read();
+}
+
+ObjectPtr<> deserialize_document(ArchiveReader& reader, IUniverse& universe) {
+	if (!reader.begin_document()) return nullptr;
+	ObjectPtr<> ptr = deserialize_object(reader, universe);
+	if (!reader.end_document()) return nullptr;
+	reader.perform_deferred(universe);
+	return ptr;
+}
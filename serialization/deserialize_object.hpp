@@ -6,7 +6,14 @@
 
 struct IUniverse;
 struct ArchiveNode;
+struct ArchiveReader;
 
 ObjectPtr<> deserialize_object(const ArchiveNode& representation, IUniverse& universe);
+// Reads the next value of 'reader' as an object. Its references and signals are left
+// with the reader until perform_deferred().
+ObjectPtr<> deserialize_object(ArchiveReader& reader, IUniverse& universe);
+// Reads the root object of a document and resolves its references and signals. Returns
+// nullptr if the document could not be read, with the reason in reader.error().
+ObjectPtr<> deserialize_document(ArchiveReader& reader, IUniverse& universe);
 
 #endif /* end of include guard: DESERIALIZE_OBJECT_HPP_F2934JFR */
@@ -1,10 +1,26 @@
 #include "serialization/json_archive.hpp"
 
-JSONArchive::JSONArchive() : root_(nullptr) {
+JSONArchive::JSONArchive() : root_(nullptr), num_nodes_(0) {
 	empty_ = make_internal();
 }
 
+void JSONArchive::reset() {
+	// The empty node is the first one, and stays.
+	for (size_t i = 1; i < num_nodes_; ++i) {
+		nodes_.begin()[i]->clear();
+	}
+	num_nodes_ = 1;
+	root_ = nullptr;
+	clear_document();
+}
+
 JSONArchiveNode* JSONArchive::make_internal(ArchiveNode::Type node_type) {
+	if (num_nodes_ < nodes_.size()) {
+		JSONArchiveNode* node = nodes_.begin()[num_nodes_++];
+		node->clear(node_type);
+		return node;
+	}
+	++num_nodes_;
 	return nodes_.allocate(*this, node_type);
 }
 
@@ -21,10 +37,23 @@ const ArchiveNode& JSONArchive::root() const {
 }
 
 void JSONArchive::write(std::ostream& os) const {
-	os << "{ \"root\": ";
+	JSONWriter::OStreamSink sink(os);
+	JSONWriter writer(true, &sink);
+	write(writer);
+}
+
+void JSONArchive::write(JSONWriter& writer) const {
+	if (writer.is_pretty()) {
+		writer.raw("{ \"root\": ", 10);
+	} else {
+		writer.raw("{\"root\":", 8);
+	}
 	if (root_ != nullptr)
-		root_->write(os, false, 1);
-	os << "\n}\n";
+		root_->write(writer, false, 1);
+	writer.newline(0);
+	writer.raw('}');
+	writer.newline(0);
+	writer.flush();
 }
 
 const ArchiveNode& JSONArchive::operator[](const std::string& key) const {
@@ -35,79 +64,65 @@ ArchiveNode& JSONArchive::operator[](const std::string& key) {
 	return root()[key];
 }
 
-static void print_indentation(std::ostream& os, int level) {
-	for (int i = 0; i < level; ++i) {
-		os << "  ";
-	}
-}
-
-static void print_string(std::ostream& os, const std::string& str) {
-	// TODO: Escape
-	os << '"';
-	os << str;
-	os << '"';
+void JSONArchiveNode::write(std::ostream& os) const {
+	JSONWriter::OStreamSink sink(os);
+	JSONWriter writer(true, &sink);
+	write(writer, false, 0);
 }
 
-void JSONArchiveNode::write(std::ostream& os, bool print_inline, int indent) const {
+void JSONArchiveNode::write(JSONWriter& writer, bool print_inline, int indent) const {
+	// Minified output has no line breaks, so it takes the inline paths.
+	print_inline = print_inline || !writer.is_pretty();
 	switch (type()) {
-		case ArchiveNodeType::Empty: os << "null"; break;
+		case ArchiveNodeType::Empty: writer.null(); break;
 		case ArchiveNodeType::Array: {
-			os << '[';
+			writer.raw('[');
 			if (print_inline) {
-				for (size_t i = 0; i < array_.size(); ++i) {
-					dynamic_cast<const JSONArchiveNode*>(array_[i])->write(os, true, indent);
-					if (i+1 != array_.size()) {
-						os << ", ";
+				for (size_t i = 0; i < array_->size(); ++i) {
+					static_cast<const JSONArchiveNode*>((*array_)[i])->write(writer, true, indent);
+					if (i+1 != array_->size()) {
+						writer.raw(',');
+						writer.space();
 					}
 				}
 			} else {
-				for (size_t i = 0; i < array_.size(); ++i) {
-					os << '\n';
-					print_indentation(os, indent+1);
-					dynamic_cast<const JSONArchiveNode*>(array_[i])->write(os, indent > 2, indent+1);
-					if (i+1 != array_.size()) {
-						os << ',';
+				for (size_t i = 0; i < array_->size(); ++i) {
+					writer.newline(indent+1);
+					static_cast<const JSONArchiveNode*>((*array_)[i])->write(writer, indent > 2, indent+1);
+					if (i+1 != array_->size()) {
+						writer.raw(',');
 					}
 				}
-				os << '\n';
-				print_indentation(os, indent);
+				writer.newline(indent);
 			}
-			os << ']';
+			writer.raw(']');
 			break;
 		}
 		case ArchiveNodeType::Map: {
-			os << '{';
-			if (print_inline) {
-				for (auto it = map_.begin(); it != map_.end();) {
-					print_string(os, it->first);
-					os << ": ";
-					dynamic_cast<const JSONArchiveNode*>(it->second)->write(os, true, indent);
-					++it;
-					if (it != map_.end()) {
-						os << ", ";
-					}
-				}
-			} else {
-				for (auto it = map_.begin(); it != map_.end();) {
-					os << '\n';
-					print_indentation(os, indent+1);
-					print_string(os, it->first);
-					os << ": ";
-					dynamic_cast<const JSONArchiveNode*>(it->second)->write(os, indent > 2, indent+1);
-					++it;
-					if (it != map_.end()) {
-						os << ',';
+			writer.raw('{');
+			bool first = true;
+			map_->for_each_in_write_order([&](Symbol key, const ArchiveNode& value) {
+				if (print_inline) {
+					if (!first) {
+						writer.raw(',');
+						writer.space();
 					}
+				} else {
+					if (!first) writer.raw(',');
+					writer.newline(indent+1);
 				}
-				os << '\n';
-				print_indentation(os, indent);
-			}
-			os << '}';
+				first = false;
+				writer.string(key.str());
+				writer.raw(':');
+				writer.space();
+				static_cast<const JSONArchiveNode&>(value).write(writer, print_inline || indent > 2, print_inline ? indent : indent+1);
+			});
+			if (!print_inline) writer.newline(indent);
+			writer.raw('}');
 			break;
 		}
-		case ArchiveNodeType::Integer: os << integer_value; break;
-		case ArchiveNodeType::Float: os << float_value; break;
-		case ArchiveNodeType::String: print_string(os, string_value); break;
+		case ArchiveNodeType::Integer: writer.integer(integer_value); break;
+		case ArchiveNodeType::Float: writer.real(float_value); break;
+		case ArchiveNodeType::String: writer.string(*string_); break;
 	}
 }
-
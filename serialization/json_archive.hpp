@@ -4,6 +4,7 @@
 
 #include "serialization/archive.hpp"
 #include "serialization/archive_node.hpp"
+#include "serialization/json_writer.hpp"
 #include "base/bag.hpp"
 #include <map>
 #include <string>
@@ -13,25 +14,40 @@ struct JSONArchive;
 
 struct JSONArchiveNode : ArchiveNode {
 	JSONArchiveNode(JSONArchive& archive, ArchiveNodeType::Type t = ArchiveNodeType::Empty);
-	void write(std::ostream& os) const override { write(os, false, 0); }
-	void write(std::ostream& os, bool print_inline, int indent) const;
+	void write(std::ostream& os) const override;
+	void write(JSONWriter& writer, bool print_inline, int indent) const;
 };
 
 struct JSONArchive : Archive {
 	JSONArchive();
+	// Empties the archive for the next document. The nodes are kept, along with the
+	// memory of their maps, arrays and strings, and are reused in the order they were
+	// made, so writing documents of the same shape again allocates nothing.
+	void reset();
 	ArchiveNode& root() override;
 	const ArchiveNode& root() const override;
 	void write(std::ostream& os) const override;
+	// Writes the archive in the writer's style, pretty-printed or minified.
+	void write(JSONWriter& writer) const;
+	// Reads a JSON document into the archive, replacing the root. Documents written by
+	// write() have the root node as their only key, "root"; any other document becomes the root itself.
+	// Returns false and describes the problem in 'out_error' if the input is not valid JSON.
+	bool read(const char* data, size_t len, std::string* out_error = nullptr);
 	const ArchiveNode& operator[](const std::string& key) const override;
 	ArchiveNode& operator[](const std::string& key) override;
 	ArchiveNode* make(ArchiveNode::Type t = ArchiveNodeType::Empty) override { return make_internal(t); }
 	
 	const ArchiveNode& empty() const { return *empty_; }
+	// The nodes in use, including the empty node.
+	size_t num_nodes() const { return num_nodes_; }
+protected:
+	Archive* new_fragment() const override { return new JSONArchive; }
 private:
 	friend struct JSONArchiveNode;
 	JSONArchiveNode* empty_;
 	JSONArchiveNode* root_;
 	ContainedBag<JSONArchiveNode> nodes_;
+	size_t num_nodes_;
 	JSONArchiveNode* make_internal(ArchiveNodeType::Type t = ArchiveNodeType::Empty);
 };
 
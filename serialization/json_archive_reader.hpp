@@ -0,0 +1,48 @@
+#pragma once
+#ifndef JSON_ARCHIVE_READER_HPP_P8M2VYSE
+#define JSON_ARCHIVE_READER_HPP_P8M2VYSE
+
+#include "serialization/archive_reader.hpp"
+
+// Pull parser over JSON text. Only the stack of open containers is kept, so memory
+// grows with the nesting depth rather than with the size of the input. Errors are
+// reported through error() with the byte offset they were found at.
+struct JSONArchiveReader : ArchiveReader {
+	static const int MaxDepth = 512;
+	
+	JSONArchiveReader(const char* data, size_t len) : begin_(data), p_(data), end_(data + len) {}
+	
+	NodeType peek() override;
+	bool begin_map() override;
+	bool next_key(std::string& key) override;
+	bool begin_array() override;
+	bool next_element() override;
+	bool read(int64& n) override;
+	bool read(float64& f) override;
+	bool read(std::string& s) override;
+	void skip() override;
+	
+	// Documents written by JSONArchive have the root object in "root".
+	bool begin_document() override;
+	bool end_document() override;
+	// Checks that nothing but whitespace follows the last value.
+	bool finish();
+private:
+	const char* begin_;
+	const char* p_;
+	const char* end_;
+	Array<bool> is_first_; // per open container: no element has been read yet
+	std::string scratch_;
+	
+	bool fail(const char* message);
+	void skip_whitespace();
+	bool open(char bracket);
+	bool next(char close);
+	bool parse_literal(const char* literal, size_t len);
+	bool parse_number(int64& n, float64& f, bool& is_float);
+	bool parse_hex4(uint32& out);
+	bool parse_escape(std::string& out);
+	bool parse_string(std::string& out);
+};
+
+#endif /* end of include guard: JSON_ARCHIVE_READER_HPP_P8M2VYSE */
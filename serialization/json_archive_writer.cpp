@@ -0,0 +1,109 @@
+#include "serialization/json_archive_writer.hpp"
+
+void JSONArchiveWriter::begin_document() {
+	if (writer_.is_pretty()) {
+		writer_.raw("{ \"root\": ", 10);
+	} else {
+		writer_.raw("{\"root\":", 8);
+	}
+}
+
+void JSONArchiveWriter::end_document() {
+	ASSERT(stack_.size() == 0);
+	writer_.newline(0);
+	writer_.raw('}');
+	writer_.newline(0);
+	writer_.flush();
+}
+
+// Writes the separator and line break in front of the next element. Map values
+// follow their key on the same line.
+void JSONArchiveWriter::begin_element() {
+	if (after_key_) {
+		after_key_ = false;
+		return;
+	}
+	if (stack_.size() == 0) return;
+	Container& c = stack_.back();
+	if (!c.is_empty) {
+		writer_.raw(',');
+	}
+	if (c.is_inline) {
+		if (!c.is_empty) writer_.space();
+	} else {
+		writer_.newline(c.indent + 1);
+	}
+	c.is_empty = false;
+}
+
+void JSONArchiveWriter::open(char bracket) {
+	begin_element();
+	writer_.raw(bracket);
+	// Same layout rules as JSONArchiveNode::write: the root is at indent 1, and
+	// containers more than two levels in are written on one line.
+	Container c;
+	if (stack_.size() == 0) {
+		c.indent = 1;
+		c.is_inline = !writer_.is_pretty();
+	} else {
+		const Container& parent = stack_.back();
+		c.indent = parent.is_inline ? parent.indent : parent.indent + 1;
+		c.is_inline = parent.is_inline || parent.indent > 2;
+	}
+	c.is_empty = true;
+	stack_.push_back(c);
+}
+
+void JSONArchiveWriter::close(char bracket) {
+	ASSERT(stack_.size() != 0);
+	Container c = stack_.back();
+	stack_.pop_back();
+	if (!c.is_inline) {
+		writer_.newline(c.indent);
+	}
+	writer_.raw(bracket);
+}
+
+void JSONArchiveWriter::begin_map() {
+	open('{');
+}
+
+void JSONArchiveWriter::key(const std::string& name) {
+	begin_element();
+	writer_.string(name);
+	writer_.raw(':');
+	writer_.space();
+	after_key_ = true;
+}
+
+void JSONArchiveWriter::end_map() {
+	close('}');
+}
+
+void JSONArchiveWriter::begin_array() {
+	open('[');
+}
+
+void JSONArchiveWriter::end_array() {
+	close(']');
+}
+
+void JSONArchiveWriter::null() {
+	begin_element();
+	writer_.null();
+}
+
+void JSONArchiveWriter::value(int64 n) {
+	begin_element();
+	writer_.integer(n);
+}
+
+void JSONArchiveWriter::value(float64 f) {
+	begin_element();
+	writer_.real(f);
+}
+
+void JSONArchiveWriter::value(const std::string& s) {
+	begin_element();
+	writer_.string(s);
+}
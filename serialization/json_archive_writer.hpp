@@ -0,0 +1,42 @@
+#pragma once
+#ifndef JSON_ARCHIVE_WRITER_HPP_XN4T8QLC
+#define JSON_ARCHIVE_WRITER_HPP_XN4T8QLC
+
+#include "serialization/archive_writer.hpp"
+#include "serialization/json_writer.hpp"
+#include "base/array.hpp"
+
+// Streams serialized values straight to a JSONWriter, laid out like JSONArchive::write.
+// Only the stack of open containers is kept, so memory does not grow with the output.
+struct JSONArchiveWriter : ArchiveWriter {
+	explicit JSONArchiveWriter(JSONWriter& writer) : writer_(writer), after_key_(false) {}
+	
+	void begin_map() override;
+	void key(const std::string& name) override;
+	void end_map() override;
+	void begin_array() override;
+	void end_array() override;
+	void null() override;
+	void value(int64 n) override;
+	void value(float64 f) override;
+	void value(const std::string& s) override;
+protected:
+	void begin_document() override;
+	void end_document() override;
+private:
+	struct Container {
+		int indent;
+		bool is_inline;
+		bool is_empty;
+	};
+	
+	void begin_element();
+	void open(char c);
+	void close(char c);
+	
+	JSONWriter& writer_;
+	Array<Container> stack_;
+	bool after_key_;
+};
+
+#endif /* end of include guard: JSON_ARCHIVE_WRITER_HPP_XN4T8QLC */
@@ -0,0 +1,393 @@
+#include "serialization/json_archive.hpp"
+#include "serialization/json_archive_reader.hpp"
+#include "serialization/json_scan.hpp"
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+	// Whether the integer with these decimal digits, which have no leading zeros, fits in
+	// an int64. Digit strings of the same length compare like the numbers.
+	bool fits_int64(const char* digits, size_t num_digits, bool negative) {
+		if (num_digits != 19) return num_digits < 19;
+		return memcmp(digits, negative ? "9223372036854775808" : "9223372036854775807", 19) <= 0;
+	}
+	
+	// Length of the UTF-8 sequence starting at 'p' (which is not ASCII), or 0 if it is
+	// not valid: truncated, overlong, a surrogate, or beyond U+10FFFF.
+	size_t validate_utf8_sequence(const unsigned char* p, const unsigned char* end) {
+		unsigned char c = p[0];
+		size_t n;
+		uint32 min;
+		uint32 cp;
+		if (c >= 0xc2 && c <= 0xdf) { n = 2; min = 0x80; cp = c & 0x1f; }
+		else if (c >= 0xe0 && c <= 0xef) { n = 3; min = 0x800; cp = c & 0x0f; }
+		else if (c >= 0xf0 && c <= 0xf4) { n = 4; min = 0x10000; cp = c & 0x07; }
+		else return 0;
+		if (size_t(end - p) < n) return 0;
+		for (size_t i = 1; i < n; ++i) {
+			if ((p[i] & 0xc0) != 0x80) return 0;
+			cp = (cp << 6) | (p[i] & 0x3f);
+		}
+		if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) return 0;
+		return n;
+	}
+	
+	void append_utf8(std::string& out, uint32 cp) {
+		if (cp < 0x80) {
+			out += char(cp);
+		} else if (cp < 0x800) {
+			out += char(0xc0 | (cp >> 6));
+			out += char(0x80 | (cp & 0x3f));
+		} else if (cp < 0x10000) {
+			out += char(0xe0 | (cp >> 12));
+			out += char(0x80 | ((cp >> 6) & 0x3f));
+			out += char(0x80 | (cp & 0x3f));
+		} else {
+			out += char(0xf0 | (cp >> 18));
+			out += char(0x80 | ((cp >> 12) & 0x3f));
+			out += char(0x80 | ((cp >> 6) & 0x3f));
+			out += char(0x80 | (cp & 0x3f));
+		}
+	}
+}
+
+bool JSONArchiveReader::fail(const char* message) {
+	if (!failed()) {
+		std::stringstream ss;
+		ss << message << " at offset " << (p_ - begin_) << ".";
+		set_error(ss.str());
+	}
+	return false;
+}
+
+void JSONArchiveReader::skip_whitespace() {
+	if (p_ != end_ && json_is_whitespace(*p_)) {
+		p_ += json_skip_whitespace(p_, end_ - p_);
+	}
+}
+
+ArchiveReader::NodeType JSONArchiveReader::peek() {
+	if (failed()) return ArchiveNodeType::Empty;
+	skip_whitespace();
+	if (p_ == end_) {
+		fail("Unexpected end of input");
+		return ArchiveNodeType::Empty;
+	}
+	switch (*p_) {
+		case '{': return ArchiveNodeType::Map;
+		case '[': return ArchiveNodeType::Array;
+		case '"': return ArchiveNodeType::String;
+		// There are no boolean nodes, so booleans read as integers.
+		case 't': case 'f': return ArchiveNodeType::Integer;
+		case 'n': return ArchiveNodeType::Empty;
+		default: {
+			// Look ahead just far enough to tell integers from floats, the way parse_number will.
+			const char* q = p_;
+			if (*q == '-') ++q;
+			const char* digits = q;
+			while (q != end_ && *q >= '0' && *q <= '9') ++q;
+			if (q != end_ && (*q == '.' || *q == 'e' || *q == 'E')) return ArchiveNodeType::Float;
+			return fits_int64(digits, q - digits, *p_ == '-') ? ArchiveNodeType::Integer : ArchiveNodeType::Float;
+		}
+	}
+}
+
+bool JSONArchiveReader::open(char bracket) {
+	if (failed()) return false;
+	skip_whitespace();
+	if (p_ == end_) return fail("Unexpected end of input");
+	if (*p_ != bracket) {
+		skip();
+		return false;
+	}
+	if (int(is_first_.size()) >= MaxDepth) return fail("Nesting too deep");
+	++p_;
+	is_first_.push_back(true);
+	return true;
+}
+
+// Moves to the next element of the innermost container, or past its end.
+bool JSONArchiveReader::next(char close) {
+	if (failed()) return false;
+	skip_whitespace();
+	if (p_ == end_) return fail("Unexpected end of input");
+	if (*p_ == close) {
+		++p_;
+		is_first_.pop_back();
+		return false;
+	}
+	bool& is_first = is_first_.back();
+	if (!is_first) {
+		if (*p_ != ',') return fail(close == '}' ? "Expected ',' or '}'" : "Expected ',' or ']'");
+		++p_;
+		skip_whitespace();
+	}
+	is_first = false;
+	return true;
+}
+
+bool JSONArchiveReader::begin_map() {
+	return open('{');
+}
+
+bool JSONArchiveReader::next_key(std::string& key) {
+	if (!next('}')) return false;
+	if (p_ == end_ || *p_ != '"') return fail("Expected a key");
+	if (!parse_string(key)) return false;
+	skip_whitespace();
+	if (p_ == end_ || *p_ != ':') return fail("Expected ':'");
+	++p_;
+	return true;
+}
+
+bool JSONArchiveReader::begin_array() {
+	return open('[');
+}
+
+bool JSONArchiveReader::next_element() {
+	return next(']');
+}
+
+bool JSONArchiveReader::read(int64& n) {
+	if (failed()) return false;
+	skip_whitespace();
+	if (p_ == end_) return fail("Unexpected end of input");
+	switch (*p_) {
+		case 't': if (!parse_literal("true", 4)) return false; n = 1; return true;
+		case 'f': if (!parse_literal("false", 5)) return false; n = 0; return true;
+		case '{': case '[': case '"': case 'n': skip(); return false;
+		default: {
+			float64 f;
+			bool is_float;
+			return parse_number(n, f, is_float) && !is_float;
+		}
+	}
+}
+
+bool JSONArchiveReader::read(float64& f) {
+	if (failed()) return false;
+	skip_whitespace();
+	if (p_ == end_) return fail("Unexpected end of input");
+	if (*p_ == '-' || (*p_ >= '0' && *p_ <= '9')) {
+		int64 n;
+		bool is_float;
+		return parse_number(n, f, is_float) && is_float;
+	}
+	skip();
+	return false;
+}
+
+bool JSONArchiveReader::read(std::string& s) {
+	if (failed()) return false;
+	skip_whitespace();
+	if (p_ == end_) return fail("Unexpected end of input");
+	if (*p_ == '"') return parse_string(s);
+	skip();
+	return false;
+}
+
+void JSONArchiveReader::skip() {
+	if (failed()) return;
+	skip_whitespace();
+	if (p_ == end_) {
+		fail("Unexpected end of input");
+		return;
+	}
+	switch (*p_) {
+		case '{': {
+			if (!open('{')) return;
+			while (next_key(scratch_)) skip();
+			return;
+		}
+		case '[': {
+			if (!open('[')) return;
+			while (next_element()) skip();
+			return;
+		}
+		case '"': parse_string(scratch_); return;
+		case 't': parse_literal("true", 4); return;
+		case 'f': parse_literal("false", 5); return;
+		case 'n': parse_literal("null", 4); return;
+		default: {
+			int64 n;
+			float64 f;
+			bool is_float;
+			parse_number(n, f, is_float);
+			return;
+		}
+	}
+}
+
+bool JSONArchiveReader::begin_document() {
+	if (!begin_map()) return fail("Expected a document");
+	std::string key;
+	if (!next_key(key) || key != "root") return fail("Expected \"root\"");
+	return true;
+}
+
+bool JSONArchiveReader::end_document() {
+	std::string key;
+	while (next_key(key)) skip();
+	return finish();
+}
+
+bool JSONArchiveReader::finish() {
+	if (failed()) return false;
+	skip_whitespace();
+	if (p_ != end_) return fail("Unexpected data after the document");
+	return true;
+}
+
+bool JSONArchiveReader::parse_literal(const char* literal, size_t len) {
+	if (size_t(end_ - p_) < len || memcmp(p_, literal, len) != 0) return fail("Invalid literal");
+	p_ += len;
+	return true;
+}
+
+bool JSONArchiveReader::parse_number(int64& n, float64& f, bool& is_float) {
+	const char* start = p_;
+	const char* q = p_;
+	bool negative = false;
+	if (q != end_ && *q == '-') { negative = true; ++q; }
+	const char* digits = q;
+	uint64 value = 0;
+	while (q != end_ && *q >= '0' && *q <= '9') {
+		value = value * 10 + (*q - '0');
+		++q;
+	}
+	size_t num_digits = q - digits;
+	if (num_digits == 0) return fail("Invalid value");
+	if (num_digits > 1 && *digits == '0') return fail("Leading zeros are not allowed");
+	bool is_integer = true;
+	if (q != end_ && *q == '.') {
+		is_integer = false;
+		++q;
+		const char* fraction = q;
+		while (q != end_ && *q >= '0' && *q <= '9') ++q;
+		if (q == fraction) return fail("Invalid number");
+	}
+	if (q != end_ && (*q == 'e' || *q == 'E')) {
+		is_integer = false;
+		++q;
+		if (q != end_ && (*q == '+' || *q == '-')) ++q;
+		const char* exponent = q;
+		while (q != end_ && *q >= '0' && *q <= '9') ++q;
+		if (q == exponent) return fail("Invalid number");
+	}
+	p_ = q;
+	
+	// Integers that do not fit in an int64 are read as floats.
+	if (is_integer && fits_int64(digits, num_digits, negative)) {
+		n = negative ? int64(0 - value) : int64(value);
+		is_float = false;
+		return true;
+	}
+	
+	// strtod needs a terminated string, and the input need not be.
+	is_float = true;
+	char buffer[64];
+	size_t len = q - start;
+	if (len >= sizeof(buffer)) {
+		std::string copy(start, len);
+		f = strtod(copy.c_str(), nullptr);
+	} else {
+		memcpy(buffer, start, len);
+		buffer[len] = '\0';
+		f = strtod(buffer, nullptr);
+	}
+	return true;
+}
+
+bool JSONArchiveReader::parse_hex4(uint32& out) {
+	if (end_ - p_ < 4) return fail("Truncated \\u escape");
+	out = 0;
+	for (int i = 0; i < 4; ++i) {
+		char c = *p_++;
+		out <<= 4;
+		if (c >= '0' && c <= '9') out |= c - '0';
+		else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+		else return fail("Invalid \\u escape");
+	}
+	return true;
+}
+
+bool JSONArchiveReader::parse_escape(std::string& out) {
+	++p_; // '\\'
+	if (p_ == end_) return fail("Unexpected end of input");
+	char c = *p_++;
+	switch (c) {
+		case '"': out += '"'; return true;
+		case '\\': out += '\\'; return true;
+		case '/': out += '/'; return true;
+		case 'b': out += '\b'; return true;
+		case 'f': out += '\f'; return true;
+		case 'n': out += '\n'; return true;
+		case 'r': out += '\r'; return true;
+		case 't': out += '\t'; return true;
+		case 'u': {
+			uint32 cp;
+			if (!parse_hex4(cp)) return false;
+			if (cp >= 0xdc00 && cp <= 0xdfff) return fail("Unpaired surrogate");
+			if (cp >= 0xd800 && cp <= 0xdbff) {
+				uint32 low;
+				if (end_ - p_ < 2 || p_[0] != '\\' || p_[1] != 'u') return fail("Unpaired surrogate");
+				p_ += 2;
+				if (!parse_hex4(low)) return false;
+				if (low < 0xdc00 || low > 0xdfff) return fail("Unpaired surrogate");
+				cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+			}
+			append_utf8(out, cp);
+			return true;
+		}
+		default: --p_; return fail("Invalid escape");
+	}
+}
+
+// Reads the string at p_ into 'out'. Runs without escapes are copied straight from the input.
+bool JSONArchiveReader::parse_string(std::string& out) {
+	++p_; // '"'
+	out.clear();
+	const char* run = p_;
+	while (true) {
+		p_ += json_find_string_special(p_, end_ - p_);
+		if (p_ == end_) return fail("Unterminated string");
+		unsigned char c = *p_;
+		if (c == '"') {
+			out.append(run, p_ - run);
+			++p_;
+			return true;
+		} else if (c == '\\') {
+			out.append(run, p_ - run);
+			if (!parse_escape(out)) return false;
+			run = p_;
+		} else if (c < 0x20) {
+			return fail("Control character in string");
+		} else {
+			size_t n = validate_utf8_sequence(reinterpret_cast<const unsigned char*>(p_), reinterpret_cast<const unsigned char*>(end_));
+			if (n == 0) return fail("Invalid UTF-8");
+			p_ += n;
+		}
+	}
+}
+
+bool JSONArchive::read(const char* data, size_t len, std::string* out_error) {
+	JSONArchiveNode* document = make_internal();
+	JSONArchiveReader reader(data, len);
+	reader.read_node(*document);
+	if (!reader.finish()) {
+		if (out_error) *out_error = reader.error();
+		return false;
+	}
+	// Documents written by write() hold the root node under "root", and nothing else.
+	if (document->is_map() && document->map_->size() == 1) {
+		const JSONArchiveNode& doc = *document;
+		const ArchiveNode& root = doc["root"];
+		if (&root != &empty()) {
+			root_ = static_cast<JSONArchiveNode*>(const_cast<ArchiveNode*>(&root));
+			return true;
+		}
+	}
+	root_ = document;
+	return true;
+}
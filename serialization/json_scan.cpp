@@ -0,0 +1,157 @@
+#include "serialization/json_scan.hpp"
+#include "base/simd.hpp"
+
+#if defined(__SSE2__) && !defined(NO_SIMD)
+#define USE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace {
+	inline bool is_string_special(char c) {
+		return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20 || static_cast<unsigned char>(c) >= 0x80;
+	}
+	
+	inline bool needs_escape(char c) {
+		return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+	}
+	
+	size_t skip_whitespace_scalar(const char* p, size_t len) {
+		size_t i = 0;
+		while (i < len && json_is_whitespace(p[i])) ++i;
+		return i;
+	}
+	
+	size_t find_string_special_scalar(const char* p, size_t len) {
+		size_t i = 0;
+		while (i < len && !is_string_special(p[i])) ++i;
+		return i;
+	}
+	
+	size_t find_escape_scalar(const char* p, size_t len) {
+		size_t i = 0;
+		while (i < len && !needs_escape(p[i])) ++i;
+		return i;
+	}
+	
+#if defined(USE_X86_SIMD)
+	size_t skip_whitespace_sse2(const char* p, size_t len) {
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i newline = _mm_set1_epi8('\n');
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i tab = _mm_set1_epi8('\t');
+		size_t i = 0;
+		for (; i + 16 <= len; i += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			__m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, newline)), _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+			int mask = ~_mm_movemask_epi8(ws) & 0xffff;
+			if (mask != 0) return i + __builtin_ctz(mask);
+		}
+		return i + skip_whitespace_scalar(p + i, len - i);
+	}
+	
+	__attribute__((target("avx2")))
+	size_t skip_whitespace_avx2(const char* p, size_t len) {
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i newline = _mm256_set1_epi8('\n');
+		const __m256i cr = _mm256_set1_epi8('\r');
+		const __m256i tab = _mm256_set1_epi8('\t');
+		size_t i = 0;
+		for (; i + 32 <= len; i += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+			__m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, newline)), _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, tab)));
+			uint32 mask = ~uint32(_mm256_movemask_epi8(ws));
+			if (mask != 0) return i + __builtin_ctz(mask);
+		}
+		return i + skip_whitespace_sse2(p + i, len - i);
+	}
+	
+	// A signed compare against 0x20 catches both control characters and bytes >= 0x80.
+	size_t find_string_special_sse2(const char* p, size_t len) {
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i space = _mm_set1_epi8(0x20);
+		size_t i = 0;
+		for (; i + 16 <= len; i += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			__m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), _mm_cmplt_epi8(v, space));
+			int mask = _mm_movemask_epi8(special);
+			if (mask != 0) return i + __builtin_ctz(mask);
+		}
+		return i + find_string_special_scalar(p + i, len - i);
+	}
+	
+	__attribute__((target("avx2")))
+	size_t find_string_special_avx2(const char* p, size_t len) {
+		const __m256i quote = _mm256_set1_epi8('"');
+		const __m256i backslash = _mm256_set1_epi8('\\');
+		const __m256i space = _mm256_set1_epi8(0x20);
+		size_t i = 0;
+		for (; i + 32 <= len; i += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+			__m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)), _mm256_cmpgt_epi8(space, v));
+			uint32 mask = _mm256_movemask_epi8(special);
+			if (mask != 0) return i + __builtin_ctz(mask);
+		}
+		return i + find_string_special_sse2(p + i, len - i);
+	}
+	
+	// Unsigned v <= 0x1f is tested as max(v, 0x1f) == 0x1f, so UTF-8 passes through.
+	size_t find_escape_sse2(const char* p, size_t len) {
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i control = _mm_set1_epi8(0x1f);
+		size_t i = 0;
+		for (; i + 16 <= len; i += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			__m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+			int mask = _mm_movemask_epi8(special);
+			if (mask != 0) return i + __builtin_ctz(mask);
+		}
+		return i + find_escape_scalar(p + i, len - i);
+	}
+	
+	__attribute__((target("avx2")))
+	size_t find_escape_avx2(const char* p, size_t len) {
+		const __m256i quote = _mm256_set1_epi8('"');
+		const __m256i backslash = _mm256_set1_epi8('\\');
+		const __m256i control = _mm256_set1_epi8(0x1f);
+		size_t i = 0;
+		for (; i + 32 <= len; i += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+			__m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)), _mm256_cmpeq_epi8(_mm256_max_epu8(v, control), control));
+			uint32 mask = _mm256_movemask_epi8(special);
+			if (mask != 0) return i + __builtin_ctz(mask);
+		}
+		return i + find_escape_sse2(p + i, len - i);
+	}
+	
+	bool use_avx2() {
+		static const bool avx2 = cpu_has_avx2();
+		return avx2;
+	}
+#endif
+}
+
+size_t json_skip_whitespace(const char* p, size_t len) {
+#if defined(USE_X86_SIMD)
+	return use_avx2() ? skip_whitespace_avx2(p, len) : skip_whitespace_sse2(p, len);
+#else
+	return skip_whitespace_scalar(p, len);
+#endif
+}
+
+size_t json_find_string_special(const char* p, size_t len) {
+#if defined(USE_X86_SIMD)
+	return use_avx2() ? find_string_special_avx2(p, len) : find_string_special_sse2(p, len);
+#else
+	return find_string_special_scalar(p, len);
+#endif
+}
+
+size_t json_find_escape(const char* p, size_t len) {
+#if defined(USE_X86_SIMD)
+	return use_avx2() ? find_escape_avx2(p, len) : find_escape_sse2(p, len);
+#else
+	return find_escape_scalar(p, len);
+#endif
+}
@@ -0,0 +1,22 @@
+#pragma once
+#ifndef JSON_SCAN_HPP_W8N2KQ4D
+#define JSON_SCAN_HPP_W8N2KQ4D
+
+#include "base/basic.hpp"
+
+// Scanning kernels shared by the JSON reader and writer. Each returns the number of
+// bytes before the first byte it stops at (or 'len'). They use AVX2 or SSE2 when
+// available, so long strings and indentation are passed over 16 or 32 bytes at a time.
+
+inline bool json_is_whitespace(char c) {
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Stops at the first byte that is not JSON whitespace.
+size_t json_skip_whitespace(const char* p, size_t len);
+// Stops at '"', '\\', control characters and non-ASCII bytes, which the reader handles one at a time.
+size_t json_find_string_special(const char* p, size_t len);
+// Stops at '"', '\\' and control characters, which the writer must escape.
+size_t json_find_escape(const char* p, size_t len);
+
+#endif /* end of include guard: JSON_SCAN_HPP_W8N2KQ4D */
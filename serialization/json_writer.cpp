@@ -0,0 +1,343 @@
+#include "serialization/json_writer.hpp"
+#include "serialization/json_scan.hpp"
+#include <cstring>
+
+namespace {
+	const char DigitPairs[201] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+	
+	// Writes the digits of 'value' backwards, two at a time, ending just before 'end'.
+	char* write_digits_backwards(uint64 value, char* end) {
+		while (value >= 100) {
+			uint32 pair = uint32(value % 100) * 2;
+			value /= 100;
+			*--end = DigitPairs[pair + 1];
+			*--end = DigitPairs[pair];
+		}
+		if (value >= 10) {
+			uint32 pair = uint32(value) * 2;
+			*--end = DigitPairs[pair + 1];
+			*--end = DigitPairs[pair];
+		} else {
+			*--end = char('0' + value);
+		}
+		return end;
+	}
+	
+	// Grisu2, after Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+	// Accurately with Integers" (PLDI 2010). The result always reads back as the same
+	// double, and is the shortest such representation in all but rare cases.
+	struct DiyFp {
+		uint64 f;
+		int e;
+		
+		DiyFp(uint64 f, int e) : f(f), e(e) {}
+		explicit DiyFp(float64 d) {
+			uint64 bits;
+			memcpy(&bits, &d, sizeof(bits));
+			int biased_e = int((bits & ExponentMask) >> 52);
+			uint64 significand = bits & SignificandMask;
+			if (biased_e != 0) {
+				f = significand + HiddenBit;
+				e = biased_e - 1075;
+			} else {
+				f = significand;
+				e = -1074;
+			}
+		}
+		
+		DiyFp operator-(const DiyFp& rhs) const { return DiyFp(f - rhs.f, e); }
+		DiyFp operator*(const DiyFp& rhs) const {
+			const uint64 M32 = 0xffffffffu;
+			uint64 a = f >> 32, b = f & M32, c = rhs.f >> 32, d = rhs.f & M32;
+			uint64 ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+			uint64 tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+			tmp += 1U << 31; // round
+			return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+		}
+		DiyFp normalize() const {
+			DiyFp r = *this;
+			while (!(r.f & (uint64(1) << 63))) { r.f <<= 1; r.e--; }
+			return r;
+		}
+		DiyFp normalize_boundary() const {
+			DiyFp r = *this;
+			while (!(r.f & (HiddenBit << 1))) { r.f <<= 1; r.e--; }
+			r.f <<= 64 - 52 - 2;
+			r.e -= 64 - 52 - 2;
+			return r;
+		}
+		void normalized_boundaries(DiyFp& minus, DiyFp& plus) const {
+			DiyFp p = DiyFp((f << 1) + 1, e - 1).normalize_boundary();
+			DiyFp m = (f == HiddenBit) ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+			m.f <<= m.e - p.e;
+			m.e = p.e;
+			plus = p;
+			minus = m;
+		}
+		
+		static const uint64 ExponentMask = 0x7ff0000000000000ull;
+		static const uint64 SignificandMask = 0x000fffffffffffffull;
+		static const uint64 HiddenBit = 0x0010000000000000ull;
+	};
+	
+	// Normalized 10^k for k = -348, -340, ..., 340.
+	const uint64 CachedPowersF[] = {
+		0xfa8fd5a0081c0288, 0xbaaee17fa23ebf76, 0x8b16fb203055ac76,
+		0xcf42894a5dce35ea, 0x9a6bb0aa55653b2d, 0xe61acf033d1a45df,
+		0xab70fe17c79ac6ca, 0xff77b1fcbebcdc4f, 0xbe5691ef416bd60c,
+		0x8dd01fad907ffc3c, 0xd3515c2831559a83, 0x9d71ac8fada6c9b5,
+		0xea9c227723ee8bcb, 0xaecc49914078536d, 0x823c12795db6ce57,
+		0xc21094364dfb5637, 0x9096ea6f3848984f, 0xd77485cb25823ac7,
+		0xa086cfcd97bf97f4, 0xef340a98172aace5, 0xb23867fb2a35b28e,
+		0x84c8d4dfd2c63f3b, 0xc5dd44271ad3cdba, 0x936b9fcebb25c996,
+		0xdbac6c247d62a584, 0xa3ab66580d5fdaf6, 0xf3e2f893dec3f126,
+		0xb5b5ada8aaff80b8, 0x87625f056c7c4a8b, 0xc9bcff6034c13053,
+		0x964e858c91ba2655, 0xdff9772470297ebd, 0xa6dfbd9fb8e5b88f,
+		0xf8a95fcf88747d94, 0xb94470938fa89bcf, 0x8a08f0f8bf0f156b,
+		0xcdb02555653131b6, 0x993fe2c6d07b7fac, 0xe45c10c42a2b3b06,
+		0xaa242499697392d3, 0xfd87b5f28300ca0e, 0xbce5086492111aeb,
+		0x8cbccc096f5088cc, 0xd1b71758e219652c, 0x9c40000000000000,
+		0xe8d4a51000000000, 0xad78ebc5ac620000, 0x813f3978f8940984,
+		0xc097ce7bc90715b3, 0x8f7e32ce7bea5c70, 0xd5d238a4abe98068,
+		0x9f4f2726179a2245, 0xed63a231d4c4fb27, 0xb0de65388cc8ada8,
+		0x83c7088e1aab65db, 0xc45d1df942711d9a, 0x924d692ca61be758,
+		0xda01ee641a708dea, 0xa26da3999aef774a, 0xf209787bb47d6b85,
+		0xb454e4a179dd1877, 0x865b86925b9bc5c2, 0xc83553c5c8965d3d,
+		0x952ab45cfa97a0b3, 0xde469fbd99a05fe3, 0xa59bc234db398c25,
+		0xf6c69a72a3989f5c, 0xb7dcbf5354e9bece, 0x88fcf317f22241e2,
+		0xcc20ce9bd35c78a5, 0x98165af37b2153df, 0xe2a0b5dc971f303a,
+		0xa8d9d1535ce3b396, 0xfb9b7cd9a4a7443c, 0xbb764c4ca7a44410,
+		0x8bab8eefb6409c1a, 0xd01fef10a657842c, 0x9b10a4e5e9913129,
+		0xe7109bfba19c0c9d, 0xac2820d9623bf429, 0x80444b5e7aa7cf85,
+		0xbf21e44003acdd2d, 0x8e679c2f5e44ff8f, 0xd433179d9c8cb841,
+		0x9e19db92b4e31ba9, 0xeb96bf6ebadf77d9, 0xaf87023b9bf0ee6b,
+	};
+	const int16 CachedPowersE[] = {
+		-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+		-901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+		-582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+		-263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+		56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+		375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+		694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+		1013, 1039, 1066,
+	};
+	const uint64 Pow10[] = {
+		1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+		10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull,
+		1000000000000000ull, 10000000000000000ull, 100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull,
+	};
+	
+	DiyFp get_cached_power(int e, int& K) {
+		double dk = (-61 - e) * 0.30102999566398114 + 347; // dk must be positive, so floor() can be a cast
+		int k = static_cast<int>(dk);
+		if (dk - k > 0.0) k++;
+		unsigned index = static_cast<unsigned>((k >> 3) + 1);
+		K = -(-348 + static_cast<int>(index * 8));
+		return DiyFp(CachedPowersF[index], CachedPowersE[index]);
+	}
+	
+	void grisu_round(char* buffer, int len, uint64 delta, uint64 rest, uint64 ten_kappa, uint64 wp_w) {
+		while (rest < wp_w && delta - rest >= ten_kappa && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+			buffer[len - 1]--;
+			rest += ten_kappa;
+		}
+	}
+	
+	int count_decimal_digits(uint32 n) {
+		int digits = 1;
+		while (digits < 10 && n >= Pow10[digits]) digits++;
+		return digits;
+	}
+	
+	void digit_gen(const DiyFp& W, const DiyFp& Mp, uint64 delta, char* buffer, int& len, int& K) {
+		const DiyFp one(uint64(1) << -Mp.e, Mp.e);
+		const DiyFp wp_w = Mp - W;
+		uint32 p1 = static_cast<uint32>(Mp.f >> -one.e);
+		uint64 p2 = Mp.f & (one.f - 1);
+		int kappa = count_decimal_digits(p1);
+		len = 0;
+		
+		while (kappa > 0) {
+			uint32 d = p1 / uint32(Pow10[kappa - 1]);
+			p1 %= uint32(Pow10[kappa - 1]);
+			if (d || len) buffer[len++] = char('0' + d);
+			kappa--;
+			uint64 tmp = (static_cast<uint64>(p1) << -one.e) + p2;
+			if (tmp <= delta) {
+				K += kappa;
+				grisu_round(buffer, len, delta, tmp, Pow10[kappa] << -one.e, wp_w.f);
+				return;
+			}
+		}
+		
+		while (true) {
+			p2 *= 10;
+			delta *= 10;
+			char d = static_cast<char>(p2 >> -one.e);
+			if (d || len) buffer[len++] = char('0' + d);
+			p2 &= one.f - 1;
+			kappa--;
+			if (p2 < delta) {
+				K += kappa;
+				int index = -kappa;
+				grisu_round(buffer, len, delta, p2, one.f, wp_w.f * (index < 20 ? Pow10[index] : 0));
+				return;
+			}
+		}
+	}
+	
+	// Digits of a positive, finite 'value' in 'buffer'; value = digits * 10^K.
+	void grisu2(float64 value, char* buffer, int& len, int& K) {
+		const DiyFp v(value);
+		DiyFp w_m(0, 0), w_p(0, 0);
+		v.normalized_boundaries(w_m, w_p);
+		
+		const DiyFp c_mk = get_cached_power(w_p.e, K);
+		const DiyFp W = v.normalize() * c_mk;
+		DiyFp Wp = w_p * c_mk;
+		DiyFp Wm = w_m * c_mk;
+		Wm.f++;
+		Wp.f--;
+		digit_gen(W, Wp, Wp.f - Wm.f, buffer, len, K);
+	}
+	
+	char* write_exponent(int k, char* out) {
+		*out++ = 'e';
+		if (k < 0) {
+			*out++ = '-';
+			k = -k;
+		}
+		char digits[4];
+		char* end = digits + sizeof(digits);
+		char* begin = write_digits_backwards(uint64(k), end);
+		memcpy(out, begin, end - begin);
+		return out + (end - begin);
+	}
+	
+	// Lays out 'len' digits times 10^k as a JSON number, in place.
+	char* prettify(char* buffer, int len, int k) {
+		const int kk = len + k; // 10^(kk-1) <= v < 10^kk
+		if (0 <= k && kk <= 21) {
+			// 1234e7 -> 12340000000.0
+			for (int i = len; i < kk; i++) buffer[i] = '0';
+			buffer[kk] = '.';
+			buffer[kk + 1] = '0';
+			return buffer + kk + 2;
+		} else if (0 < kk && kk <= 21) {
+			// 1234e-2 -> 12.34
+			memmove(buffer + kk + 1, buffer + kk, len - kk);
+			buffer[kk] = '.';
+			return buffer + len + 1;
+		} else if (-6 < kk && kk <= 0) {
+			// 1234e-6 -> 0.001234
+			const int offset = 2 - kk;
+			memmove(buffer + offset, buffer, len);
+			buffer[0] = '0';
+			buffer[1] = '.';
+			for (int i = 2; i < offset; i++) buffer[i] = '0';
+			return buffer + len + offset;
+		} else if (len == 1) {
+			// 1e30
+			return write_exponent(kk - 1, buffer + 1);
+		} else {
+			// 1234e30 -> 1.234e33
+			memmove(buffer + 2, buffer + 1, len - 1);
+			buffer[1] = '.';
+			return write_exponent(kk - 1, buffer + len + 1);
+		}
+	}
+}
+
+char* format_integer(int64 value, char* out) {
+	uint64 magnitude = static_cast<uint64>(value);
+	if (value < 0) {
+		*out++ = '-';
+		magnitude = 0 - magnitude;
+	}
+	char digits[20];
+	char* end = digits + sizeof(digits);
+	char* begin = write_digits_backwards(magnitude, end);
+	memcpy(out, begin, end - begin);
+	return out + (end - begin);
+}
+
+char* format_float(float64 value, char* out) {
+	if (value != value || value - value != 0) {
+		// NaN or infinity, which JSON has no way to write.
+		memcpy(out, "null", 4);
+		return out + 4;
+	}
+	if (value < 0 || (value == 0 && 1 / value < 0)) {
+		*out++ = '-';
+		value = -value;
+	}
+	if (value == 0) {
+		memcpy(out, "0.0", 3);
+		return out + 3;
+	}
+	int len, K;
+	grisu2(value, out, len, K);
+	return prettify(out, len, K);
+}
+
+void JSONWriter::flush() {
+	if (sink_ && buffer_.size()) {
+		sink_->write(buffer_.data(), buffer_.size());
+		buffer_.clear();
+	}
+}
+
+void JSONWriter::integer(int64 value) {
+	char tmp[MaxNumberLength];
+	raw(tmp, format_integer(value, tmp) - tmp);
+}
+
+void JSONWriter::real(float64 value) {
+	char tmp[MaxNumberLength];
+	raw(tmp, format_float(value, tmp) - tmp);
+}
+
+void JSONWriter::string(const char* data, size_t len) {
+	static const char Hex[] = "0123456789abcdef";
+	buffer_ += '"';
+	const char* end = data + len;
+	while (data != end) {
+		size_t run = json_find_escape(data, end - data);
+		buffer_.append(data, run);
+		data += run;
+		if (data == end) break;
+		char c = *data++;
+		switch (c) {
+			case '"': buffer_.append("\\\"", 2); break;
+			case '\\': buffer_.append("\\\\", 2); break;
+			case '\b': buffer_.append("\\b", 2); break;
+			case '\f': buffer_.append("\\f", 2); break;
+			case '\n': buffer_.append("\\n", 2); break;
+			case '\r': buffer_.append("\\r", 2); break;
+			case '\t': buffer_.append("\\t", 2); break;
+			default: {
+				char escape[6] = { '\\', 'u', '0', '0', Hex[(c >> 4) & 0xf], Hex[c & 0xf] };
+				buffer_.append(escape, 6);
+			}
+		}
+	}
+	buffer_ += '"';
+	maybe_flush();
+}
+
+void JSONWriter::newline(int indent) {
+	if (!pretty_) return;
+	buffer_ += '\n';
+	buffer_.append(2 * indent, ' ');
+}
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef JSON_WRITER_HPP_J6T0VBXP
+#define JSON_WRITER_HPP_J6T0VBXP
+
+#include "base/basic.hpp"
+#include <string>
+#include <ostream>
+
+// Number formatting used by the writer. Both write at most MaxNumberLength characters
+// to 'out' (no terminator) and return the end of what they wrote.
+static const size_t MaxNumberLength = 32;
+char* format_integer(int64 value, char* out);
+// Shortest representation that reads back as the same double (Grisu2), always with a
+// '.' or an exponent so it reads back as a float. NaN and infinities become null.
+char* format_float(float64 value, char* out);
+
+struct JSONWriter {
+	// Receives the output in chunks.
+	struct Sink {
+		virtual ~Sink() {}
+		virtual void write(const char* data, size_t len) = 0;
+	};
+	
+	struct OStreamSink : Sink {
+		explicit OStreamSink(std::ostream& os) : os_(os) {}
+		void write(const char* data, size_t len) override { os_.write(data, len); }
+	private:
+		std::ostream& os_;
+	};
+	
+	// Without a sink, everything accumulates in buffer(). With one, the buffer is
+	// handed over whenever it grows past FlushSize, and on flush().
+	explicit JSONWriter(bool pretty = true, Sink* sink = nullptr) : pretty_(pretty), sink_(sink) {}
+	~JSONWriter() { flush(); }
+	
+	bool is_pretty() const { return pretty_; }
+	std::string& buffer() { return buffer_; }
+	void flush();
+	
+	void raw(char c) { buffer_ += c; }
+	void raw(const char* data, size_t len) { buffer_.append(data, len); maybe_flush(); }
+	void null() { raw("null", 4); }
+	void integer(int64 value);
+	void real(float64 value);
+	void string(const char* data, size_t len);
+	void string(const std::string& s) { string(s.data(), s.size()); }
+	
+	// Whitespace that is only written in pretty mode.
+	void space() { if (pretty_) buffer_ += ' '; }
+	void newline(int indent);
+private:
+	static const size_t FlushSize = 64 * 1024;
+	void maybe_flush() { if (sink_ && buffer_.size() >= FlushSize) flush(); }
+	
+	bool pretty_;
+	Sink* sink_;
+	std::string buffer_;
+};
+
+#endif /* end of include guard: JSON_WRITER_HPP_J6T0VBXP */
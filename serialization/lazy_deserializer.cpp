@@ -0,0 +1,124 @@
+#include "serialization/lazy_deserializer.hpp"
+#include "serialization/archive.hpp"
+#include "serialization/archive_node.hpp"
+#include "serialization/deserialize_object.hpp"
+#include "type/type_registry.hpp"
+#include "object/child_list.hpp"
+#include "object/struct_type.hpp"
+
+LazyDeserializer::LazyDeserializer(Archive& archive, IUniverse& universe) : archive_(archive), universe_(universe), num_pending_(0) {}
+
+LazyDeserializer::~LazyDeserializer() {
+	if (universe_.object_loader() == this) {
+		universe_.set_object_loader(nullptr);
+	}
+}
+
+ObjectPtr<> LazyDeserializer::deserialize() {
+	const ArchiveNode& root = archive_.root();
+	scan(root, -1);
+	if (entries_.size() == 0) {
+		// Let the eager path report what is wrong with the document.
+		return ::deserialize_object(root, universe_);
+	}
+	universe_.set_object_loader(this);
+	return materialize(0);
+}
+
+void LazyDeserializer::materialize_all() {
+	for (size_t i = 0; i < entries_.size(); ++i) {
+		materialize(i);
+	}
+}
+
+bool LazyDeserializer::load(const std::string& id) {
+	auto it = ids_.find(id);
+	if (it == ids_.end() || entries_[it->second].state != Pending) return false;
+	materialize(it->second);
+	return true;
+}
+
+bool LazyDeserializer::defer(const ArchiveNode& node, Array<ObjectPtr<>>& list, size_t index) {
+	auto it = nodes_.find(&node);
+	if (it == nodes_.end()) return false;
+	Entry& entry = entries_[it->second];
+	if (entry.state != Pending) return false;
+	entry.list = &list;
+	entry.index = index;
+	return true;
+}
+
+void LazyDeserializer::scan(const ArchiveNode& node, ptrdiff_t parent) {
+	std::string class_name;
+	if (!node.is_map() || !node[ArchiveNodeMap::class_key()].get(class_name)) return;
+	const ObjectTypeBase* type = TypeRegistry::get(class_name);
+	if (type == nullptr) return; // deserialize_object() reports it when the parent is created.
+	
+	size_t entry = entries_.size();
+	entries_.push_back(Entry{&node, parent, nullptr, 0, nullptr, Pending});
+	nodes_[&node] = entry;
+	++num_pending_;
+	scan_members(node, type, entry);
+}
+
+void LazyDeserializer::scan_members(const ArchiveNode& node, const ObjectTypeBase* type, size_t entry) {
+	std::string id;
+	if (node[ArchiveNodeMap::id_key()].get(id)) {
+		ids_.insert(std::make_pair(std::move(id), entry));
+	}
+	
+	for (size_t i = 0; i < type->num_properties(); ++i) {
+		const AttributeBase* property = type->property_at(i);
+		if (property->type() != get_type<ChildList>()) continue;
+		const ArchiveNode& children = node[property->name()];
+		if (!children.is_array()) continue;
+		for (size_t j = 0; j < children.array_size(); ++j) {
+			scan(children[j], entry);
+		}
+	}
+	
+	// Aspects are created with the object that holds them, so their IDs and children belong to its entry.
+	const ArchiveNode& aspects = node[ArchiveNodeMap::aspects_key()];
+	if (!aspects.is_array()) return;
+	for (size_t i = 0; i < aspects.array_size(); ++i) {
+		const ArchiveNode& aspect = aspects[i];
+		std::string class_name;
+		if (!aspect.is_map() || !aspect[ArchiveNodeMap::class_key()].get(class_name)) continue;
+		const ObjectTypeBase* aspect_type = TypeRegistry::get(class_name);
+		if (aspect_type != nullptr) {
+			scan_members(aspect, aspect_type, entry);
+		}
+	}
+}
+
+ObjectPtr<> LazyDeserializer::materialize(size_t index) {
+	// The parent's ChildList decides where the object goes, so it is created first.
+	ptrdiff_t parent = entries_[index].parent;
+	if (entries_[index].state == Pending && parent >= 0) {
+		materialize(size_t(parent));
+	}
+	
+	Entry& entry = entries_[index];
+	if (entry.state != Pending) return entry.object;
+	entry.state = Loading;
+	entry.object = ::deserialize_object(*entry.node, universe_);
+	entry.state = Loaded;
+	--num_pending_;
+	
+	if (entry.object != nullptr && entry.list != nullptr) {
+		Array<ObjectPtr<>>& list = *entry.list;
+		if (entry.index < list.size() && list[entry.index] == nullptr) {
+			list[entry.index] = entry.object;
+		} else {
+			list.push_back(entry.object);
+		}
+	}
+	ObjectPtr<> object = entry.object;
+	
+	// Resolving the object's references creates the objects they point to.
+	archive_.perform_deserialize_references(universe_);
+	if (num_pending_ == 0 && universe_.object_loader() == this) {
+		universe_.set_object_loader(nullptr);
+	}
+	return object;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#ifndef LAZY_DESERIALIZER_HPP_Q7MX2KD5
+#define LAZY_DESERIALIZER_HPP_Q7MX2KD5
+
+#include "object/universe.hpp"
+#include "base/array.hpp"
+#include <map>
+#include <string>
+#include <unordered_map>
+
+struct Archive;
+struct ArchiveNode;
+
+// Deserializes the objects of an archive as they are needed. Only the root object is
+// created by deserialize(); the IDs of the objects in its ChildLists, recursively, are
+// registered with the universe, and each is created and deserialized the first time
+// get_object() asks for it, which is also how references to it are resolved. Until
+// then its ChildList slot holds null.
+//
+// The archive must outlive the deserializer, and objects still waiting when the
+// deserializer is destroyed are never created.
+struct LazyDeserializer : IObjectLoader {
+	LazyDeserializer(Archive& archive, IUniverse& universe);
+	~LazyDeserializer();
+	
+	ObjectPtr<> deserialize();
+	// Creates every object that is still waiting.
+	void materialize_all();
+	size_t num_pending() const { return num_pending_; }
+	
+	bool load(const std::string& id) override;
+	bool defer(const ArchiveNode& node, Array<ObjectPtr<>>& list, size_t index) override;
+private:
+	enum State {
+		Pending,
+		Loading,
+		Loaded,
+	};
+	
+	struct Entry {
+		const ArchiveNode* node;
+		ptrdiff_t parent;
+		Array<ObjectPtr<>>* list;
+		size_t index;
+		ObjectPtr<> object;
+		State state;
+	};
+	
+	void scan(const ArchiveNode& node, ptrdiff_t parent);
+	void scan_members(const ArchiveNode& node, const ObjectTypeBase* type, size_t entry);
+	ObjectPtr<> materialize(size_t index);
+	
+	Archive& archive_;
+	IUniverse& universe_;
+	Array<Entry> entries_;
+	std::map<std::string, size_t> ids_;
+	std::unordered_map<const ArchiveNode*, size_t> nodes_;
+	size_t num_pending_;
+};
+
+#endif /* end of include guard: LAZY_DESERIALIZER_HPP_Q7MX2KD5 */
@@ -0,0 +1,135 @@
+#include "serialization/mapped_archive.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+size_t MappedFormat::leading_rank(const char* key, size_t len) {
+	static const char* const leading[NumLeadingKeys] = {"class", "aspects", "id"};
+	for (size_t i = 0; i < NumLeadingKeys; ++i) {
+		if (strlen(leading[i]) == len && memcmp(leading[i], key, len) == 0) return i;
+	}
+	return NumLeadingKeys;
+}
+
+MappedNode MappedNode::make(const char* base, uint32 end, uint32 offset) {
+	if (offset % MappedFormat::Alignment != 0 || offset < MappedFormat::HeaderSize || uint64(offset) + MappedFormat::NodeHeaderSize > end) {
+		return MappedNode();
+	}
+	const char* p = base + offset;
+	uint64 count = MappedFormat::load32(p + 4);
+	uint64 size;
+	switch (MappedFormat::load32(p)) {
+		case ArchiveNodeType::Empty: size = 0; break;
+		case ArchiveNodeType::Integer: case ArchiveNodeType::Float: size = 8; break;
+		case ArchiveNodeType::String: size = count + 1; break;
+		case ArchiveNodeType::Array: size = count * 4; break;
+		case ArchiveNodeType::Map: size = count * 8; break;
+		default: return MappedNode();
+	}
+	if (uint64(offset) + MappedFormat::NodeHeaderSize + size > end) return MappedNode();
+	return MappedNode(base, offset);
+}
+
+MappedNode MappedNode::operator[](size_t idx) const {
+	if (idx >= array_size()) return MappedNode();
+	return child(MappedFormat::load32(payload() + 4 * idx));
+}
+
+MappedNode MappedNode::operator[](const std::string& key) const {
+	size_t lo = 0;
+	size_t hi = map_size();
+	const char* data;
+	size_t len;
+	// The leading keys come first, and the rest are sorted.
+	while (lo < hi) {
+		if (!key_at(lo).get(data, len)) return MappedNode();
+		if (MappedFormat::leading_rank(data, len) == MappedFormat::NumLeadingKeys) break;
+		if (len == key.size() && memcmp(data, key.data(), len) == 0) return value_at(lo);
+		++lo;
+	}
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (!key_at(mid).get(data, len)) return MappedNode();
+		int c = memcmp(data, key.data(), len < key.size() ? len : key.size());
+		if (c == 0) c = len < key.size() ? -1 : (len > key.size() ? 1 : 0);
+		if (c == 0) return value_at(mid);
+		if (c < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return MappedNode();
+}
+
+MappedNode MappedNode::key_at(size_t idx) const {
+	if (idx >= map_size()) return MappedNode();
+	return child(MappedFormat::load32(payload() + 8 * idx));
+}
+
+MappedNode MappedNode::value_at(size_t idx) const {
+	if (idx >= map_size()) return MappedNode();
+	return child(MappedFormat::load32(payload() + 8 * idx + 4));
+}
+
+bool MappedArchive::open(const std::string& path, std::string* out_error) {
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		if (out_error) *out_error = "Could not open '" + path + "'.";
+		return false;
+	}
+	struct stat st;
+	void* p = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	::close(fd);
+	if (p == MAP_FAILED) {
+		if (out_error) *out_error = "Could not map '" + path + "'.";
+		return false;
+	}
+	data_ = static_cast<const char*>(p);
+	size_ = size_t(st.st_size);
+	is_mapped_ = true;
+	return check(out_error);
+}
+
+bool MappedArchive::open(const char* data, size_t len, std::string* out_error) {
+	close();
+	data_ = data;
+	size_ = len;
+	return check(out_error);
+}
+
+void MappedArchive::close() {
+	if (is_mapped_) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+	data_ = nullptr;
+	size_ = 0;
+	is_mapped_ = false;
+	root_ = MappedNode();
+}
+
+bool MappedArchive::check(std::string* out_error) {
+	const char* error = nullptr;
+	if (size_ < MappedFormat::HeaderSize + MappedFormat::TrailerSize || size_ > UINT32_MAX
+		|| memcmp(data_, MappedFormat::magic(), MappedFormat::MagicLength) != 0
+		|| memcmp(data_ + size_ - MappedFormat::MagicLength, MappedFormat::magic(), MappedFormat::MagicLength) != 0) {
+		error = "Not a mapped archive.";
+	} else if (MappedFormat::load32(data_ + MappedFormat::MagicLength) == 0 || MappedFormat::load32(data_ + MappedFormat::MagicLength) > MappedFormat::Version) {
+		error = "Unsupported version.";
+	} else {
+		uint32 end = uint32(size_ - MappedFormat::TrailerSize);
+		root_ = MappedNode::make(data_, end, MappedFormat::load32(data_ + end));
+		if (root_.base_ == nullptr) error = "Invalid root node.";
+	}
+	if (error) {
+		if (out_error) *out_error = error;
+		close();
+		return false;
+	}
+	return true;
+}
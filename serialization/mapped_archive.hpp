@@ -0,0 +1,169 @@
+#pragma once
+#ifndef MAPPED_ARCHIVE_HPP_H6VQ2NXE
+#define MAPPED_ARCHIVE_HPP_H6VQ2NXE
+
+#include "base/basic.hpp"
+#include "serialization/archive_node_type.hpp"
+#include <cstring>
+#include <string>
+
+// A read-only archive format that is used in place, typically straight from a mapped
+// file. Nothing is parsed up front; MappedNode reads values as they are asked for.
+//
+// The file is the header ("ASPM", then the version as 4 bytes), the nodes, and the
+// trailer (the offset of the root node as 4 bytes, then "ASPM"). All numbers are
+// little-endian, and offsets are from the start of the file. Every node starts at a
+// multiple of 8 with its ArchiveNodeType as 4 bytes and a count as 4 bytes, followed by:
+//   Empty    nothing
+//   Integer  8 bytes, signed
+//   Float    8 bytes, IEEE double
+//   String   'count' bytes and a terminating zero
+//   Array    the offsets of the 'count' elements, 4 bytes each
+//   Map      'count' entries of the offset of the key, a String node, and of the value,
+//            4 bytes each: those for "class", "aspects" and "id" first, in that order,
+//            so a reader can create an object before it gets to its properties, and
+//            then the rest sorted by key so lookups can bisect
+// Nodes only refer to nodes before them, so reading a damaged file always terminates.
+//
+// Version 1 sorted all the entries of a map, which version 2 readers look up the same way.
+struct MappedFormat {
+	static const size_t MagicLength = 4;
+	static const char* magic() { return "ASPM"; }
+	static const uint32 Version = 2;
+	static const size_t HeaderSize = 8;
+	static const size_t TrailerSize = 8;
+	static const size_t NodeHeaderSize = 8;
+	static const size_t Alignment = 8;
+	
+	static uint32 load32(const char* p) {
+		const uint8* b = reinterpret_cast<const uint8*>(p);
+		return uint32(b[0]) | (uint32(b[1]) << 8) | (uint32(b[2]) << 16) | (uint32(b[3]) << 24);
+	}
+	static uint64 load64(const char* p) {
+		return uint64(load32(p)) | (uint64(load32(p + 4)) << 32);
+	}
+	
+	// The position of a key that goes before the sorted entries of a map, or
+	// NumLeadingKeys for the others.
+	static const size_t NumLeadingKeys = 3;
+	static size_t leading_rank(const char* key, size_t len);
+};
+
+// A node of a MappedArchive. It is a pointer into the archive's memory, and has the
+// const interface of ArchiveNode. A missing or damaged node reads as empty.
+struct MappedNode {
+	typedef ArchiveNodeType::Type Type;
+	
+	MappedNode() : base_(nullptr), offset_(0) {}
+	
+	bool is_empty() const { return type() == Type::Empty; }
+	bool is_array() const { return type() == Type::Array; }
+	bool is_map() const { return type() == Type::Map; }
+	Type type() const { return base_ ? Type(MappedFormat::load32(base_ + offset_)) : Type::Empty; }
+	
+	bool get(float32&) const;
+	bool get(float64&) const;
+	bool get(int8&) const;
+	bool get(int16&) const;
+	bool get(int32&) const;
+	bool get(int64&) const;
+	bool get(uint8&) const;
+	bool get(uint16&) const;
+	bool get(uint32&) const;
+	bool get(uint64&) const;
+	bool get(std::string&) const;
+	// The bytes of a string in place, without copying them.
+	bool get(const char*& data, size_t& len) const;
+	
+	MappedNode operator[](size_t idx) const;
+	MappedNode operator[](const std::string& key) const;
+	size_t array_size() const { return is_array() ? count() : 0; }
+	
+	size_t map_size() const { return is_map() ? count() : 0; }
+	// The entries of a map, in the order they are stored.
+	MappedNode key_at(size_t idx) const;
+	MappedNode value_at(size_t idx) const;
+private:
+	friend struct MappedArchive;
+	MappedNode(const char* base, uint32 offset) : base_(base), offset_(offset) {}
+	// The node at 'offset', if it is whole and lies before 'end'. Otherwise an empty node.
+	static MappedNode make(const char* base, uint32 end, uint32 offset);
+	
+	uint32 count() const { return MappedFormat::load32(base_ + offset_ + 4); }
+	const char* payload() const { return base_ + offset_ + MappedFormat::NodeHeaderSize; }
+	MappedNode child(uint32 offset) const { return make(base_, offset_, offset); }
+	template <typename T> bool get_integer(T& v) const;
+	template <typename T> bool get_float(T& v) const;
+	
+	const char* base_;
+	uint32 offset_;
+};
+
+struct MappedArchive {
+	MappedArchive() : data_(nullptr), size_(0), is_mapped_(false) {}
+	~MappedArchive() { close(); }
+	MappedArchive(const MappedArchive&) = delete;
+	MappedArchive& operator=(const MappedArchive&) = delete;
+	
+	// Maps the file at 'path' read-only. Returns false and describes the problem in
+	// 'out_error' if it cannot be mapped or is not a mapped archive.
+	bool open(const std::string& path, std::string* out_error = nullptr);
+	// Uses 'data' in place. It must stay valid and unchanged until close().
+	bool open(const char* data, size_t len, std::string* out_error = nullptr);
+	void close();
+	
+	MappedNode root() const { return root_; }
+	MappedNode operator[](const std::string& key) const { return root_[key]; }
+private:
+	bool check(std::string* out_error);
+	
+	const char* data_;
+	size_t size_;
+	bool is_mapped_;
+	MappedNode root_;
+};
+
+template <typename T>
+bool MappedNode::get_integer(T& v) const {
+	if (type() != Type::Integer) return false;
+	v = T(int64(MappedFormat::load64(payload())));
+	return true;
+}
+
+template <typename T>
+bool MappedNode::get_float(T& v) const {
+	if (type() != Type::Float) return false;
+	uint64 bits = MappedFormat::load64(payload());
+	float64 f;
+	memcpy(&f, &bits, sizeof(f));
+	v = T(f);
+	return true;
+}
+
+inline bool MappedNode::get(float32& v) const { return get_float(v); }
+inline bool MappedNode::get(float64& v) const { return get_float(v); }
+inline bool MappedNode::get(int8& v) const { return get_integer(v); }
+inline bool MappedNode::get(int16& v) const { return get_integer(v); }
+inline bool MappedNode::get(int32& v) const { return get_integer(v); }
+inline bool MappedNode::get(int64& v) const { return get_integer(v); }
+inline bool MappedNode::get(uint8& v) const { return get_integer(v); }
+inline bool MappedNode::get(uint16& v) const { return get_integer(v); }
+inline bool MappedNode::get(uint32& v) const { return get_integer(v); }
+inline bool MappedNode::get(uint64& v) const { return get_integer(v); }
+
+inline bool MappedNode::get(const char*& data, size_t& len) const {
+	if (type() != Type::String) return false;
+	data = payload();
+	len = count();
+	return true;
+}
+
+inline bool MappedNode::get(std::string& s) const {
+	const char* data;
+	size_t len;
+	if (!get(data, len)) return false;
+	s.assign(data, len);
+	return true;
+}
+
+#endif /* end of include guard: MAPPED_ARCHIVE_HPP_H6VQ2NXE */
@@ -0,0 +1,71 @@
+#include "serialization/mapped_archive_reader.hpp"
+
+bool MappedArchiveReader::take(MappedNode& node) {
+	if (!has_next_) return false;
+	node = next_;
+	has_next_ = false;
+	return true;
+}
+
+MappedArchiveReader::NodeType MappedArchiveReader::peek() {
+	return has_next_ ? next_.type() : ArchiveNodeType::Empty;
+}
+
+bool MappedArchiveReader::open(MappedNode node) {
+	// Damaged archives can nest as deep as they are long.
+	if (stack_.size() >= MaxDepth) {
+		set_error("Nesting too deep.");
+		return false;
+	}
+	stack_.push_back(Container{node, 0});
+	return true;
+}
+
+bool MappedArchiveReader::begin_map() {
+	MappedNode node;
+	return take(node) && node.is_map() && open(node);
+}
+
+bool MappedArchiveReader::next_key(std::string& key) {
+	Container& c = stack_.back();
+	if (c.index == c.node.map_size()) {
+		stack_.pop_back();
+		return false;
+	}
+	c.node.key_at(c.index).get(key);
+	next_ = c.node.value_at(c.index);
+	has_next_ = true;
+	++c.index;
+	return true;
+}
+
+bool MappedArchiveReader::begin_array() {
+	MappedNode node;
+	return take(node) && node.is_array() && open(node);
+}
+
+bool MappedArchiveReader::next_element() {
+	Container& c = stack_.back();
+	if (c.index == c.node.array_size()) {
+		stack_.pop_back();
+		return false;
+	}
+	next_ = c.node[c.index++];
+	has_next_ = true;
+	return true;
+}
+
+bool MappedArchiveReader::read(int64& n) {
+	MappedNode node;
+	return take(node) && node.get(n);
+}
+
+bool MappedArchiveReader::read(float64& f) {
+	MappedNode node;
+	return take(node) && node.get(f);
+}
+
+bool MappedArchiveReader::read(std::string& s) {
+	MappedNode node;
+	return take(node) && node.get(s);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef MAPPED_ARCHIVE_READER_HPP_Q4NJ8WXF
+#define MAPPED_ARCHIVE_READER_HPP_Q4NJ8WXF
+
+#include "serialization/archive_reader.hpp"
+#include "serialization/mapped_archive.hpp"
+
+// Reads the nodes of a MappedArchive through the cursor interface, so that
+// deserialize_object() works on them without building a node tree. Only the values
+// that are read are copied out of the archive.
+struct MappedArchiveReader : ArchiveReader {
+	static const size_t MaxDepth = 512;
+	
+	explicit MappedArchiveReader(MappedNode node, ArchiveReader* parent = nullptr) : ArchiveReader(parent), next_(node), has_next_(true) {}
+	
+	NodeType peek() override;
+	bool begin_map() override;
+	bool next_key(std::string& key) override;
+	bool begin_array() override;
+	bool next_element() override;
+	bool read(int64& n) override;
+	bool read(float64& f) override;
+	bool read(std::string& s) override;
+	void skip() override { has_next_ = false; }
+private:
+	struct Container {
+		MappedNode node;
+		size_t index;
+	};
+	
+	bool take(MappedNode& node);
+	bool open(MappedNode node);
+	
+	MappedNode next_;
+	bool has_next_;
+	Array<Container> stack_;
+};
+
+#endif /* end of include guard: MAPPED_ARCHIVE_READER_HPP_Q4NJ8WXF */
@@ -0,0 +1,162 @@
+#include "serialization/mapped_archive_writer.hpp"
+#include <algorithm>
+#include <cstring>
+
+void MappedArchiveWriter::flush() {
+	if (os_ && buffer_.size()) {
+		os_->write(buffer_.data(), buffer_.size());
+		buffer_.clear();
+	}
+}
+
+void MappedArchiveWriter::put32(uint32 n) {
+	for (int i = 0; i < 4; ++i) buffer_ += char(n >> (8 * i));
+	size_ += 4;
+}
+
+void MappedArchiveWriter::put64(uint64 n) {
+	put32(uint32(n));
+	put32(uint32(n >> 32));
+}
+
+uint32 MappedArchiveWriter::begin_node(ArchiveNodeType::Type type, size_t count) {
+	while (size_ % MappedFormat::Alignment != 0) {
+		buffer_ += char(0);
+		++size_;
+	}
+	// Offsets are 4 bytes, which limits archives to 4 GiB.
+	ASSERT(size_ + MappedFormat::NodeHeaderSize <= UINT32_MAX);
+	uint32 offset = uint32(size_);
+	put32(type);
+	put32(uint32(count));
+	return offset;
+}
+
+void MappedArchiveWriter::begin_document() {
+	buffer_.append(MappedFormat::magic(), MappedFormat::MagicLength);
+	size_ += MappedFormat::MagicLength;
+	put32(MappedFormat::Version);
+}
+
+void MappedArchiveWriter::end_document() {
+	ASSERT(open_.size() == 0);
+	put32(root_);
+	buffer_.append(MappedFormat::magic(), MappedFormat::MagicLength);
+	size_ += MappedFormat::MagicLength;
+	flush();
+}
+
+uint32 MappedArchiveWriter::string(const std::string& s) {
+	uint32 offset = begin_node(ArchiveNodeType::String, s.size());
+	buffer_.append(s);
+	buffer_ += char(0);
+	size_ += s.size() + 1;
+	if (os_ && buffer_.size() >= FlushSize) flush();
+	return offset;
+}
+
+// Records a complete node as the next element of the innermost container, or as the root.
+void MappedArchiveWriter::add(uint32 offset) {
+	if (open_.size() == 0) {
+		root_ = offset;
+		return;
+	}
+	entries_.push_back(Entry{key_, key_offset_, offset});
+	key_ = nullptr;
+}
+
+void MappedArchiveWriter::open() {
+	open_.push_back(Container{uint32(entries_.size()), key_, key_offset_});
+	key_ = nullptr;
+}
+
+void MappedArchiveWriter::begin_map() {
+	open();
+}
+
+void MappedArchiveWriter::key(const std::string& name) {
+	auto it = strings_.find(name);
+	if (it == strings_.end()) {
+		it = strings_.insert(std::make_pair(name, string(name))).first;
+	}
+	key_ = &it->first;
+	key_offset_ = it->second;
+}
+
+void MappedArchiveWriter::end_map() {
+	end_container(ArchiveNodeType::Map);
+}
+
+void MappedArchiveWriter::begin_array() {
+	open();
+}
+
+void MappedArchiveWriter::end_array() {
+	end_container(ArchiveNodeType::Array);
+}
+
+void MappedArchiveWriter::end_container(ArchiveNodeType::Type type) {
+	ASSERT(open_.size() != 0);
+	Container c = open_.back();
+	open_.pop_back();
+	uint32 first = c.first_entry;
+	Entry* begin = entries_.size() ? &entries_[0] + first : nullptr;
+	Entry* end = entries_.size() ? &entries_[0] + entries_.size() : nullptr;
+	if (type == ArchiveNodeType::Map) {
+		std::stable_sort(begin, end, [](const Entry& a, const Entry& b) {
+			size_t rank_a = MappedFormat::leading_rank(a.key->data(), a.key->size());
+			size_t rank_b = MappedFormat::leading_rank(b.key->data(), b.key->size());
+			return rank_a != rank_b ? rank_a < rank_b : *a.key < *b.key;
+		});
+		// A key given twice keeps its last value, as it would in a node tree.
+		Entry* out = begin;
+		for (Entry* it = begin; it != end; ++it) {
+			if (it + 1 != end && *it->key == *(it + 1)->key) continue;
+			*out++ = *it;
+		}
+		end = out;
+	}
+	
+	uint32 offset = begin_node(type, end - begin);
+	for (Entry* it = begin; it != end; ++it) {
+		if (type == ArchiveNodeType::Map) put32(it->key_offset);
+		put32(it->value);
+	}
+	while (entries_.size() > first) entries_.pop_back();
+	if (os_ && buffer_.size() >= FlushSize) flush();
+	key_ = c.key;
+	key_offset_ = c.key_offset;
+	add(offset);
+}
+
+void MappedArchiveWriter::null() {
+	if (null_ == 0) null_ = begin_node(ArchiveNodeType::Empty, 0);
+	add(null_);
+}
+
+void MappedArchiveWriter::value(int64 n) {
+	uint32 offset = begin_node(ArchiveNodeType::Integer, 0);
+	put64(uint64(n));
+	add(offset);
+}
+
+void MappedArchiveWriter::value(float64 f) {
+	uint64 bits;
+	memcpy(&bits, &f, sizeof(bits));
+	uint32 offset = begin_node(ArchiveNodeType::Float, 0);
+	put64(bits);
+	add(offset);
+}
+
+void MappedArchiveWriter::value(const std::string& s) {
+	auto it = strings_.find(s);
+	if (it != strings_.end()) {
+		add(it->second);
+		return;
+	}
+	uint32 offset = string(s);
+	if (s.size() <= MaxSharedLength) {
+		strings_[s] = offset;
+	}
+	add(offset);
+}
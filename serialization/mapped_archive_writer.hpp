@@ -0,0 +1,72 @@
+#pragma once
+#ifndef MAPPED_ARCHIVE_WRITER_HPP_2BRK6TZQ
+#define MAPPED_ARCHIVE_WRITER_HPP_2BRK6TZQ
+
+#include "serialization/archive_writer.hpp"
+#include "serialization/mapped_archive.hpp"
+#include "base/array.hpp"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+// Writes the format read by MappedArchive. Nodes are written bottom-up, each one as
+// soon as it is complete, so only the entries of the open containers are kept.
+// Keys and short strings are written once and shared.
+struct MappedArchiveWriter : ArchiveWriter {
+	// Without a stream, everything accumulates in buffer(). With one, the buffer is
+	// written out whenever it grows past FlushSize, and on flush().
+	explicit MappedArchiveWriter(std::ostream* os = nullptr) : os_(os), size_(0), root_(0), null_(0), key_(nullptr), key_offset_(0) {}
+	~MappedArchiveWriter() { flush(); }
+	
+	std::string& buffer() { return buffer_; }
+	void flush();
+	
+	void begin_map() override;
+	void key(const std::string& name) override;
+	void end_map() override;
+	void begin_array() override;
+	void end_array() override;
+	void null() override;
+	void value(int64 n) override;
+	void value(float64 f) override;
+	void value(const std::string& s) override;
+protected:
+	void begin_document() override;
+	void end_document() override;
+private:
+	static const size_t FlushSize = 64 * 1024;
+	static const size_t MaxSharedLength = 64;
+	
+	struct Entry {
+		const std::string* key; // null for array elements
+		uint32 key_offset;
+		uint32 value;
+	};
+	
+	struct Container {
+		uint32 first_entry;
+		const std::string* key; // the key the container itself is under
+		uint32 key_offset;
+	};
+	
+	uint32 begin_node(ArchiveNodeType::Type type, size_t count);
+	void put32(uint32 n);
+	void put64(uint64 n);
+	uint32 string(const std::string& s);
+	void open();
+	void add(uint32 offset);
+	void end_container(ArchiveNodeType::Type type);
+	
+	std::ostream* os_;
+	std::string buffer_;
+	uint64 size_;  // bytes written so far, including those flushed
+	uint32 root_;
+	uint32 null_;  // the shared Empty node, once there is one
+	const std::string* key_; // the key of the next value in a map
+	uint32 key_offset_;
+	Array<Entry> entries_;   // of all open containers, innermost last
+	Array<Container> open_;
+	std::unordered_map<std::string, uint32> strings_;
+};
+
+#endif /* end of include guard: MAPPED_ARCHIVE_WRITER_HPP_2BRK6TZQ */
@@ -0,0 +1,37 @@
+#include "serialization/object_table.hpp"
+#include "object/universe.hpp"
+
+Object* ObjectTable::get(size_t index, const IUniverse& universe) {
+	if (index >= ids.size()) return nullptr;
+	if (resolved_.size() != ids.size()) {
+		objects_.resize(ids.size(), nullptr);
+		resolved_.resize(ids.size(), 0);
+	}
+	if (!resolved_[index]) {
+		// Looking the object up may create it, and resolve other references through this table.
+		resolved_[index] = 1;
+		objects_[index] = universe.get_object(ids[index]).get();
+	}
+	return objects_[index];
+}
+
+size_t ObjectTable::add(Object* object, const IUniverse& universe) {
+	auto it = indices_.find(object);
+	if (it == indices_.end()) {
+		it = indices_.insert(std::make_pair(object, uint32(ids.size()))).first;
+		ids.push_back(universe.get_id(object));
+	}
+	return it->second;
+}
+
+void ObjectTable::forget_objects() {
+	objects_.clear(false);
+	resolved_.clear(false);
+}
+
+void ObjectTable::clear() {
+	ids.clear(false);
+	objects_.clear(false);
+	resolved_.clear(false);
+	indices_.clear();
+}
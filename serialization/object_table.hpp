@@ -0,0 +1,31 @@
+#pragma once
+#ifndef OBJECT_TABLE_HPP_H4ZR8WPN
+#define OBJECT_TABLE_HPP_H4ZR8WPN
+
+#include "base/array.hpp"
+#include <string>
+#include <unordered_map>
+
+struct Object;
+struct IUniverse;
+
+// The IDs of the objects a document's references point to, for formats that store
+// references as indices into it. Each ID is looked up once, the first time its index
+// is resolved, or added once, the first time its object is serialized.
+struct ObjectTable {
+	Array<std::string> ids;
+	
+	Object* get(size_t index, const IUniverse& universe);
+	// The index of 'object', adding it with its ID if it is not in the table yet.
+	size_t add(Object* object, const IUniverse& universe);
+	// Forgets the objects looked up so far, keeping the IDs, so they are looked up again
+	// in the universe the document is deserialized into next.
+	void forget_objects();
+	void clear();
+private:
+	Array<Object*> objects_;
+	Array<uint8> resolved_;
+	std::unordered_map<const Object*, uint32> indices_;
+};
+
+#endif /* end of include guard: OBJECT_TABLE_HPP_H4ZR8WPN */
@@ -3,6 +3,7 @@
 #define SERIALIZE_HPP_37QGG4TA
 
 #include "serialization/archive.hpp"
+#include "serialization/archive_writer.hpp"
 #include "object/struct_type.hpp"
 
 template <typename T>
@@ -11,4 +12,10 @@ void serialize(const T& object, ArchiveNode& node, IUniverse& universe) {
 	get_type(object)->serialize(memory, node, universe);
 }
 
+template <typename T>
+void serialize(const T& object, ArchiveWriter& writer, IUniverse& universe) {
+	const byte* memory = reinterpret_cast<const byte*>(&object);
+	get_type(object)->serialize(memory, writer, universe);
+}
+
 #endif /* end of include guard: SERIALIZE_HPP_37QGG4TA */
@@ -8,6 +8,7 @@
 #include "object/reflect.hpp"
 #include "type/type.hpp"
 #include "object/composite_type.hpp"
+#include "object/composite_type_registry.hpp"
 #include "object/struct_type.hpp"
 #include "base/array_type.hpp"
 #include "serialization/json_archive.hpp"
@@ -77,10 +78,10 @@ int main (int argc, char const *argv[])
 	
 	TestUniverse universe;
 	
-	auto t = new CompositeType("FooBar", get_type<Scene>());
-	t->add_aspect(get_type<Foo>());
-	t->add_aspect(get_type<Bar>());
-	t->freeze();
+	auto foobar = new CompositeType("FooBar", get_type<Scene>());
+	foobar->add_aspect(get_type<Foo>());
+	foobar->add_aspect(get_type<Bar>());
+	const CompositeType* t = CompositeTypeRegistry::intern(foobar);
 	
 	ObjectPtr<> p = universe.create_object(t, "Composite FooBar");
 	ObjectPtr<Bar> b = universe.create<Bar>("Bar");
@@ -99,6 +100,7 @@ int main (int argc, char const *argv[])
 	
 	TestUniverse universe2;
 	ObjectPtr<> root = json.deserialize(universe2);
+	ASSERT(root->object_type() == t); // deserialized composites are interned
 	ObjectPtr<Bar> bar2 = aspect_cast<Bar>(root);
 	bar2->when_something_happens(bar2->bar);
 	
@@ -0,0 +1,619 @@
+#include "object/object.hpp"
+#include "object/objectptr.hpp"
+#include "object/reflect.hpp"
+#include "object/universe.hpp"
+#include "object/child_list.hpp"
+#include "object/composite_type.hpp"
+#include "object/composite_type_registry.hpp"
+#include "base/array_type.hpp"
+#include "base/maybe_type.hpp"
+#include "base/simd.hpp"
+#include "serialization/binary_archive.hpp"
+#include "serialization/binary_archive_writer.hpp"
+#include "serialization/binary_archive_reader.hpp"
+#include "serialization/mapped_archive.hpp"
+#include "serialization/mapped_archive_writer.hpp"
+#include "serialization/mapped_archive_reader.hpp"
+#include "serialization/json_archive.hpp"
+#include "serialization/json_archive_writer.hpp"
+#include "serialization/deserialize_object.hpp"
+#include "serialization/lazy_deserializer.hpp"
+#include "type/type_registry.hpp"
+#include <sstream>
+#include <fstream>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+struct Unit : Object {
+	REFLECT;
+	int32 health;
+	float32 speed;
+	float64 mass;
+	std::string name;
+	Array<int32> path;
+	vec3 position;
+	Maybe<int32> level;
+	ObjectPtr<Unit> target;
+	ChildList children;
+	Signal<int32> hit;
+	int32 last_hit;
+	void on_hit(int32 n) { last_hit = n; }
+	Unit() : health(100), speed(1.5f), mass(0.1), position(vec3{{0, 0, 0}}), last_hit(0) {}
+};
+
+BEGIN_TYPE_INFO(Unit)
+	property(&Unit::health, "health", "A number.");
+	property(&Unit::speed, "speed", "A float.");
+	property(&Unit::mass, "mass", "A double.");
+	property(&Unit::name, "name", "A name.");
+	property(&Unit::path, "path", "Some numbers.");
+	property(&Unit::position, "position", "A vector.");
+	property(&Unit::level, "level", "An optional number.");
+	property(&Unit::target, "target", "Another unit.");
+	property(&Unit::children, "children", "Owned units.");
+	signal(&Unit::hit, "hit", "Emitted when hit.");
+	slot(&Unit::on_hit, "on_hit", "Receives hits.");
+END_TYPE_INFO()
+
+struct Armor : Object {
+	REFLECT;
+	int32 rating;
+	Armor() : rating(5) {}
+};
+
+BEGIN_TYPE_INFO(Armor)
+	property(&Armor::rating, "rating", "A number.");
+END_TYPE_INFO()
+
+struct Samples : Object {
+	REFLECT;
+	Array<float32> weights;
+	Array<int8> offsets;
+	Array<vec3> points;
+};
+
+BEGIN_TYPE_INFO(Samples)
+	property(&Samples::weights, "weights", "Floats.");
+	property(&Samples::offsets, "offsets", "Small signed numbers.");
+	property(&Samples::points, "points", "Vectors.");
+END_TYPE_INFO()
+
+static std::string minified_json(const Object& object, IUniverse& universe) {
+	JSONWriter writer(false);
+	JSONArchiveWriter(writer).write_document(object, universe);
+	return writer.buffer();
+}
+
+void test_values() {
+	const int64 integers[] = { 0, 1, -1, 63, -64, 64, 300, -300, INT64_MAX, INT64_MIN };
+	const float64 floats[] = { 0.0, -0.0, 1.5, 0.1, -1e300, 3.4028234663852886e38, INFINITY };
+	std::string long_string(1000, 'z');
+	
+	BinaryArchiveWriter writer;
+	writer.begin_map();
+	writer.key("floats");
+	writer.begin_array();
+	for (auto f: floats) writer.value(f);
+	writer.end_array();
+	writer.key("integers");
+	writer.begin_array();
+	for (auto n: integers) writer.value(n);
+	writer.end_array();
+	writer.key("strings");
+	writer.begin_array();
+	writer.value(std::string("integers"));
+	writer.value(std::string(""));
+	writer.value(long_string);
+	writer.value(long_string);
+	writer.null();
+	writer.end_array();
+	writer.end_map();
+	// A repeated key is a one-byte reference into the string table.
+	ASSERT(writer.buffer()[1] == 0 && writer.buffer().find("floats", 10) == std::string::npos);
+	std::string body = writer.buffer();
+	
+	BinaryArchive archive;
+	std::string error;
+	std::string document = std::string(BinaryFormat::magic(), BinaryFormat::MagicLength) + char(BinaryFormat::Version) + body;
+	ASSERT(archive.read(document.data(), document.size(), &error));
+	const ArchiveNode& root = archive.root();
+	for (size_t i = 0; i < sizeof(integers) / sizeof(integers[0]); ++i) {
+		int64 n;
+		ASSERT(root["integers"][i].get(n) && n == integers[i]);
+	}
+	for (size_t i = 0; i < sizeof(floats) / sizeof(floats[0]); ++i) {
+		float64 f;
+		ASSERT(root["floats"][i].get(f) && f == floats[i] && std::signbit(f) == std::signbit(floats[i]));
+	}
+	std::string s;
+	ASSERT(root["strings"][0].get(s) && s == "integers");
+	ASSERT(root["strings"][1].get(s) && s == "");
+	ASSERT(root["strings"][3].get(s) && s == long_string);
+	ASSERT(root["strings"][4].is_empty());
+	
+	// Writing the tree back gives the same bytes, since maps keep the order of their keys.
+	std::stringstream ss;
+	archive.write(ss);
+	ASSERT(ss.str() == document);
+	
+	// Every truncation and a few corruptions are rejected.
+	for (size_t len = 0; len < document.size(); ++len) {
+		BinaryArchive truncated;
+		ASSERT(!truncated.read(document.data(), len, &error));
+		ASSERT(error.size() > 0);
+	}
+	std::string corrupt[] = { "ASPB\x01\x09", "ASPB\x03\x00", "JSON\x01\x00", "ASPB\x01\x04\x05", std::string("ASPB\x01\x00\x00", 7), std::string("ASPB\x01\x01\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01", 17) };
+	for (auto& text: corrupt) {
+		BinaryArchive archive;
+		ASSERT(!archive.read(text.data(), text.size()));
+	}
+	std::string deep = "ASPB\x01" + std::string(10000, char(BinaryFormat::Array));
+	ASSERT(!archive.read(deep.data(), deep.size()));
+	
+	// A key can refer to the seventh string, whose reference is the byte of End.
+	BinaryArchiveWriter keys;
+	keys.begin_map();
+	for (char c = 'a'; c <= 'g'; ++c) {
+		keys.key(std::string(1, c));
+		keys.null();
+	}
+	keys.key("nested");
+	keys.begin_map();
+	keys.key("g");
+	keys.value(int64(7));
+	keys.end_map();
+	keys.end_map();
+	document = std::string(BinaryFormat::magic(), BinaryFormat::MagicLength) + char(BinaryFormat::Version) + keys.buffer();
+	int64 g;
+	ASSERT(archive.read(document.data(), document.size(), &error));
+	ASSERT(archive.root()["nested"]["g"].get(g) && g == 7);
+}
+
+void test_round_trip() {
+	TestUniverse universe;
+	CompositeType* armored = new CompositeType("ArmoredUnit", get_type<Unit>());
+	armored->add_aspect(get_type<Armor>());
+	const CompositeType* t = CompositeTypeRegistry::intern(armored);
+	
+	ObjectPtr<> o = universe.create_object(t, "Leader");
+	ObjectPtr<Unit> leader = o.cast<Unit>();
+	leader->name = "Leader";
+	leader->speed = 2.25f;
+	leader->mass = 81.7;
+	leader->position = vec3{{1.5f, -2, 3.25f}};
+	leader->level = 12;
+	aspect_cast<Armor>(o)->rating = 40;
+	for (int32 i = 0; i < 50; ++i) leader->path.push_back(i * 37 - 900);
+	for (int32 i = 0; i < 100; ++i) {
+		ObjectPtr<Unit> child = universe.create<Unit>("Child");
+		child->name = "Follower";
+		child->health = 10 * i;
+		child->target = leader;
+		leader->children.push_back(child);
+	}
+	ObjectPtr<Unit> receiver = leader->children[0].cast<Unit>();
+	for (auto& child: leader->children) {
+		child.cast<Unit>()->hit.connect(receiver, &Unit::on_hit);
+	}
+	leader->target = leader->children[3].cast<Unit>();
+	std::string expected = minified_json(*o, universe);
+	
+	// Through a node tree.
+	BinaryArchive out;
+	out.serialize(o, universe);
+	std::stringstream ss;
+	out.write(ss);
+	std::string tree_bytes = ss.str();
+	BinaryArchive in;
+	std::string error;
+	ASSERT(in.read(tree_bytes.data(), tree_bytes.size(), &error));
+	TestUniverse universe2;
+	ObjectPtr<> copy = in.deserialize(universe2);
+	ASSERT(copy != nullptr && copy->object_type() == t);
+	ASSERT(minified_json(*copy, universe2) == expected);
+	// Their references are indices into the object table too.
+	ASSERT(out.root()["target"].type() == ArchiveNodeType::Integer);
+	ASSERT(out.object_table().ids.size() == 3 && in.object_table().ids.size() == 3);
+	// Trees are written with the class, aspects and ID first, so they can be pulled too.
+	BinaryArchiveReader tree_reader(tree_bytes.data(), tree_bytes.size());
+	TestUniverse universe5;
+	ObjectPtr<> pulled = deserialize_document(tree_reader, universe5);
+	ASSERT(pulled != nullptr && pulled->object_type() == t);
+	ASSERT(minified_json(*pulled, universe5) == expected);
+	
+	// Streamed both ways.
+	BinaryArchiveWriter writer;
+	writer.write_document(*o, universe);
+	BinaryArchiveReader reader(writer.buffer().data(), writer.buffer().size());
+	TestUniverse universe3;
+	ObjectPtr<> streamed = deserialize_document(reader, universe3);
+	ASSERT(reader.error() == "");
+	ASSERT(streamed != nullptr && streamed->object_type() == t);
+	ASSERT(minified_json(*streamed, universe3) == expected);
+	
+	// References and signal receivers are indices into a table of the three objects they point to.
+	ASSERT(reader.object_table().ids.size() == 3 && reader.object_table().ids[0] == leader->target->object_id());
+	BinaryArchive indexed;
+	ASSERT(indexed.read(writer.buffer().data(), writer.buffer().size(), &error));
+	TestUniverse universe4;
+	ObjectPtr<> from_tree = indexed.deserialize(universe4);
+	ASSERT(from_tree != nullptr && minified_json(*from_tree, universe4) == expected);
+	
+	ObjectPtr<Unit> unit = streamed.cast<Unit>();
+	ASSERT(aspect_cast<Armor>(streamed)->rating == 40);
+	ASSERT(unit->speed == 2.25f && unit->mass == 81.7 && unit->level.is_set());
+	ObjectPtr<Unit> child = unit->children[5].cast<Unit>();
+	ASSERT(child->target == unit && unit->target == unit->children[3]);
+	child->hit(77);
+	ASSERT(unit->children[0].cast<Unit>()->last_hit == 77);
+	
+	// Objects are keyless records, and class names and IDs are only spelled out once.
+	const std::string& bytes = writer.buffer();
+	ASSERT(bytes.find("health") == bytes.rfind("health"));
+	ASSERT(bytes.size() * 3 < expected.size());
+	ASSERT(bytes.size() < tree_bytes.size());
+}
+
+void test_packed_arrays() {
+	TestUniverse universe;
+	ObjectPtr<Samples> samples = universe.create<Samples>("Samples");
+	const size_t count = 1000;
+	for (size_t i = 0; i < count; ++i) {
+		samples->weights.push_back(float32(i) * 0.5f);
+		samples->offsets.push_back(int8(int(i % 256) - 128));
+		samples->points.push_back(vec3{{float32(i), -float32(i), 0.25f}});
+	}
+	std::string expected = minified_json(*samples, universe);
+	
+	// Numbers and vectors are stored as they are in memory, without the vectors' padding.
+	BinaryArchiveWriter writer;
+	writer.write_document(*samples, universe);
+	const std::string& bytes = writer.buffer();
+	ASSERT(bytes.find(std::string(reinterpret_cast<const char*>(&samples->weights[0]), count * sizeof(float32))) != std::string::npos);
+	ASSERT(bytes.size() < count * (4 + 1 + 12) + 200);
+	
+	BinaryArchiveReader reader(bytes.data(), bytes.size());
+	TestUniverse universe2;
+	ObjectPtr<Samples> copy = deserialize_document(reader, universe2).cast<Samples>();
+	ASSERT(reader.error() == "");
+	ASSERT(copy != nullptr && minified_json(*copy, universe2) == expected);
+	ASSERT(copy->points.size() == count && copy->points[999][2] == 0.25f);
+	
+	// Node trees get them as numbers and arrays of components.
+	BinaryArchive tree;
+	ASSERT(tree.read(bytes.data(), bytes.size()));
+	const ArchiveNode& root = tree.root();
+	float64 f;
+	int64 n;
+	ASSERT(root["weights"].array_size() == count && root["weights"][3].get(f) && f == 1.5);
+	ASSERT(root["offsets"][1].get(n) && n == -127);
+	ASSERT(root["points"][2].array_size() == 3 && root["points"][2][1].get(f) && f == -2);
+	TestUniverse universe3;
+	ObjectPtr<> from_tree = tree.deserialize(universe3);
+	ASSERT(from_tree != nullptr && minified_json(*from_tree, universe3) == expected);
+	
+	// Elements of another layout are converted one at a time.
+	BinaryArchiveWriter numbers;
+	int32 values[] = { -5, 7, 1 << 20 };
+	ASSERT(numbers.packed_array(*static_cast<const SimpleType*>(get_type<int32>()), reinterpret_cast<const byte*>(values), 3, sizeof(int32)));
+	BinaryArchiveReader number_reader(numbers.buffer().data(), numbers.buffer().size());
+	Array<int64> wide;
+	get_type<Array<int64>>()->deserialize(reinterpret_cast<byte*>(&wide), number_reader, universe);
+	ASSERT(!number_reader.failed() && wide.size() == 3 && wide[0] == -5 && wide[2] == 1 << 20);
+}
+
+void test_string_ids() {
+	// A version 2 document, from before the object table, with a reference and a signal
+	// receiver stored as IDs. Keys were stored as they are then, so the only repeated
+	// keys are ones whose references are below End.
+	BinaryArchiveWriter writer;
+	writer.begin_map();
+	writer.key("class");
+	writer.value(std::string("Unit"));
+	writer.key("id");
+	writer.value(std::string("Alpha"));
+	writer.key("hit");
+	writer.begin_array();
+	writer.begin_map();
+	writer.key("receiver");
+	writer.value(std::string("Beta"));
+	writer.key("slot");
+	writer.value(std::string("on_hit"));
+	writer.end_map();
+	writer.end_array();
+	writer.key("children");
+	writer.begin_array();
+	writer.begin_map();
+	writer.key("class");
+	writer.value(std::string("Unit"));
+	writer.key("id");
+	writer.value(std::string("Beta"));
+	writer.key("target");
+	writer.value(std::string("Alpha"));
+	writer.end_map();
+	writer.end_array();
+	writer.end_map();
+	std::string doc = std::string(BinaryFormat::magic(), BinaryFormat::MagicLength) + char(2) + writer.buffer();
+	
+	BinaryArchiveReader reader(doc.data(), doc.size());
+	TestUniverse universe;
+	ObjectPtr<Unit> pulled = deserialize_document(reader, universe).cast<Unit>();
+	ASSERT(reader.error() == "");
+	BinaryArchive tree;
+	std::string error;
+	ASSERT(tree.read(doc.data(), doc.size(), &error));
+	ASSERT(tree.object_table().ids.size() == 0);
+	TestUniverse universe2;
+	ObjectPtr<Unit> from_tree = tree.deserialize(universe2).cast<Unit>();
+	
+	ObjectPtr<Unit> roots[] = { pulled, from_tree };
+	for (auto alpha: roots) {
+		ASSERT(alpha != nullptr && alpha->object_id() == "Alpha" && alpha->children.size() == 1);
+		ObjectPtr<Unit> beta = alpha->children[0].cast<Unit>();
+		ASSERT(beta->object_id() == "Beta" && beta->target == alpha);
+		alpha->hit(6);
+		ASSERT(beta->last_hit == 6);
+	}
+}
+
+static void append_string(std::string& out, const std::string& s) {
+	out += char(0);
+	out += char(s.size());
+	out += s;
+}
+
+void test_schema_mismatch() {
+	// An Armor record from a build where it had another property, in a different order.
+	std::string doc = std::string(BinaryFormat::magic(), BinaryFormat::MagicLength) + char(BinaryFormat::Version);
+	doc += char(BinaryFormat::Array);
+	for (int i = 0; i < 2; ++i) {
+		doc += char(BinaryFormat::Record);
+		if (i == 0) {
+			doc += char(0);
+			append_string(doc, "Armor");
+			doc += std::string(8, char(0));
+			doc += char(3);
+			append_string(doc, "weight");
+			append_string(doc, "int32");
+			append_string(doc, "rating");
+			doc += char(3); // "int32"
+			append_string(doc, "id");
+			append_string(doc, "std::string");
+		} else {
+			doc += char(1);
+		}
+		doc += char(BinaryFormat::Integer);
+		doc += char(BinaryFormat::zigzag_encode(-3));
+		doc += char(BinaryFormat::Integer);
+		doc += char(BinaryFormat::zigzag_encode(20 + i));
+		doc += char(BinaryFormat::String);
+		append_string(doc, i == 0 ? "Plate" : "Chain");
+	}
+	doc += char(BinaryFormat::End);
+	
+	TestUniverse universe;
+	BinaryArchiveReader reader(doc.data(), doc.size());
+	ASSERT(reader.begin_document() && reader.begin_array());
+	Array<ObjectPtr<Armor>> armors;
+	while (reader.next_element()) {
+		armors.push_back(deserialize_object(reader, universe).cast<Armor>());
+	}
+	ASSERT(reader.end_document());
+	ASSERT(armors.size() == 2);
+	ASSERT(armors[0]->object_id() == "Plate" && armors[0]->rating == 20);
+	ASSERT(armors[1]->object_id() == "Chain" && armors[1]->rating == 21);
+	
+	// Read as a tree, records are maps with the class first.
+	BinaryArchive archive;
+	std::string error;
+	ASSERT(archive.read(doc.data(), doc.size(), &error));
+	std::string s;
+	int64 n;
+	ASSERT(archive.root()[1]["class"].get(s) && s == "Armor");
+	ASSERT(archive.root()[1]["weight"].get(n) && n == -3);
+	ASSERT(archive.root()[1]["id"].get(s) && s == "Chain");
+}
+
+void test_mapped() {
+	TestUniverse universe;
+	ObjectPtr<Unit> leader = universe.create<Unit>("Leader");
+	leader->name = "Leader";
+	leader->mass = 81.7;
+	leader->position = vec3{{1.5f, -2, 3.25f}};
+	for (int32 i = 0; i < 20; ++i) {
+		ObjectPtr<Unit> child = universe.create<Unit>("Child");
+		child->health = i;
+		child->target = leader;
+		child->hit.connect(leader, &Unit::on_hit);
+		leader->children.push_back(child);
+	}
+	std::string expected = minified_json(*leader, universe);
+	
+	char path[] = "/tmp/mapped_testXXXXXX";
+	int fd = mkstemp(path);
+	ASSERT(fd >= 0);
+	::close(fd);
+	{
+		std::ofstream file(path, std::ios::binary);
+		MappedArchiveWriter(&file).write_document(*leader, universe);
+	}
+	
+	// Values can be looked at in place, without deserializing anything.
+	MappedArchive archive;
+	std::string error;
+	ASSERT(archive.open(path, &error));
+	MappedNode root = archive.root();
+	std::string s;
+	int32 n;
+	float64 f;
+	ASSERT(root["class"].get(s) && s == "Unit");
+	ASSERT(root["mass"].get(f) && f == 81.7);
+	ASSERT(root["position"].array_size() == 3 && root["position"][2].get(f) && f == 3.25);
+	ASSERT(root["children"].array_size() == 20);
+	ASSERT(root["children"][7]["health"].get(n) && n == 7);
+	ASSERT(root["children"][7]["target"].get(s) && s == "Leader");
+	ASSERT(root["level"].is_empty() && root["no such key"].is_empty() && root["children"][20].is_empty());
+	// The class and ID come first, so objects can be created before their properties are read.
+	ASSERT(root.map_size() == 12 && root.key_at(0).get(s) && s == "class" && root.key_at(1).get(s) && s == "id");
+	ASSERT(root.key_at(2).get(s) && s == "children" && root["id"].get(s) && s == "Leader");
+	
+	MappedArchiveReader reader(archive.root());
+	TestUniverse universe2;
+	ObjectPtr<> copy = deserialize_document(reader, universe2);
+	ASSERT(copy != nullptr && minified_json(*copy, universe2) == expected);
+	aspect_cast<Unit>(copy)->children[4].cast<Unit>()->hit(5);
+	ASSERT(aspect_cast<Unit>(copy)->last_hit == 5);
+	archive.close();
+	remove(path);
+	
+	// Damaged archives are rejected, or read as far as they make sense.
+	MappedArchiveWriter writer;
+	writer.write_document(*leader, universe);
+	std::string bytes = writer.buffer();
+	ASSERT(!archive.open(bytes.data(), bytes.size() - 1, &error));
+	ASSERT(!archive.open("ASPM\x01\x00\x00\x00\x08\x00\x00\x00" "ASPM", 16, &error));
+	std::mt19937 random(1);
+	for (int i = 0; i < 200; ++i) {
+		std::string damaged = bytes;
+		for (int j = 0; j < 4; ++j) {
+			damaged[8 + random() % (damaged.size() - 16)] = char(random());
+		}
+		if (!archive.open(damaged.data(), damaged.size())) continue;
+		MappedArchiveReader damaged_reader(archive.root());
+		TestUniverse universe3;
+		deserialize_document(damaged_reader, universe3);
+	}
+}
+
+void test_lazy() {
+	TestUniverse universe;
+	ObjectPtr<Unit> leader = universe.create<Unit>("Leader");
+	for (int32 i = 0; i < 10; ++i) {
+		ObjectPtr<Unit> squad = universe.create<Unit>("Squad");
+		squad->health = i;
+		for (int32 j = 0; j < 3; ++j) {
+			ObjectPtr<Unit> member = universe.create<Unit>("Member");
+			member->health = i * 10 + j;
+			squad->children.push_back(member);
+		}
+		leader->children.push_back(squad);
+	}
+	ObjectPtr<Unit> scout = leader->children[2].cast<Unit>()->children[1].cast<Unit>();
+	scout->target = leader->children[7].cast<Unit>()->children[0].cast<Unit>();
+	scout->hit.connect(leader, &Unit::on_hit);
+	std::string expected = minified_json(*leader, universe);
+	
+	BinaryArchive archive;
+	archive.serialize(leader, universe);
+	TestUniverse universe2;
+	LazyDeserializer lazy(archive, universe2);
+	ObjectPtr<Unit> copy = lazy.deserialize().cast<Unit>();
+	ASSERT(copy != nullptr && copy->children.size() == 10 && copy->children[2] == nullptr);
+	ASSERT(lazy.num_pending() == 40);
+	
+	// Asking for the scout creates its squad, then the unit it targets and that unit's squad.
+	ObjectPtr<Unit> copied_scout = universe2.get_object(scout->object_id()).cast<Unit>();
+	ASSERT(copied_scout != nullptr && copied_scout->health == 21);
+	ObjectPtr<Unit> squad = copy->children[2].cast<Unit>();
+	ASSERT(squad != nullptr && squad->children.size() == 3);
+	ASSERT(squad->children[1] == copied_scout && squad->children[0] == nullptr);
+	ASSERT(copied_scout->target != nullptr && copied_scout->target->health == 70);
+	ASSERT(copy->children[7].cast<Unit>()->children[0] == copied_scout->target);
+	ASSERT(lazy.num_pending() == 36);
+	copied_scout->hit(3);
+	ASSERT(copy->last_hit == 3);
+	ASSERT(universe2.get_object("No such unit") == nullptr);
+	
+	lazy.materialize_all();
+	ASSERT(lazy.num_pending() == 0 && universe2.object_loader() == nullptr);
+	ASSERT(minified_json(*copy, universe2) == expected);
+}
+
+void test_parallel() {
+	TestUniverse universe;
+	ObjectPtr<Unit> leader = universe.create<Unit>("Leader");
+	for (int32 i = 0; i < 500; ++i) {
+		ObjectPtr<Unit> child = universe.create<Unit>("Child");
+		child->health = i;
+		for (int32 j = 0; j < i % 4; ++j) {
+			child->children.push_back(universe.create<Unit>("Grandchild"));
+		}
+		leader->children.push_back(child);
+	}
+	for (int32 i = 0; i < 500; ++i) {
+		ObjectPtr<Unit> child = leader->children[i].cast<Unit>();
+		child->target = leader->children[(i * 7) % 500].cast<Unit>();
+		child->hit.connect(leader->children[499 - i].cast<Unit>(), &Unit::on_hit);
+	}
+	std::string expected = minified_json(*leader, universe);
+	
+	// Serializing on several threads builds the same tree.
+	BinaryArchive archive;
+	archive.set_serialize_threads(8);
+	archive.serialize(leader, universe);
+	BinaryArchive sequential;
+	sequential.serialize(leader, universe);
+	std::stringstream a, b;
+	archive.write(a);
+	sequential.write(b);
+	ASSERT(a.str() == b.str());
+	JSONArchive json;
+	json.set_serialize_threads(3);
+	json.serialize(leader, universe);
+	std::stringstream c;
+	json.write(c);
+	JSONArchive sequential_json;
+	sequential_json.serialize(leader, universe);
+	std::stringstream d;
+	sequential_json.write(d);
+	ASSERT(c.str() == d.str());
+	
+	archive.set_deserialize_threads(8);
+	TestUniverse universe2;
+	ObjectPtr<Unit> copy = archive.deserialize(universe2).cast<Unit>();
+	ASSERT(copy != nullptr && copy->children.size() == 500);
+	ASSERT(copy->children[123].cast<Unit>()->health == 123);
+	ASSERT(minified_json(*copy, universe2) == expected);
+	copy->children[10].cast<Unit>()->hit(4);
+	ASSERT(copy->children[489].cast<Unit>()->last_hit == 4);
+	
+	// IDs that look like the names the universe makes up from class names, which objects
+	// would collide with if they were created before their IDs were read.
+	TestUniverse universe3;
+	ObjectPtr<Unit> squad = universe3.create<Unit>("Squad");
+	for (int32 i = 0; i < 2000; ++i) {
+		ObjectPtr<Unit> unit = universe3.create<Unit>("Unit");
+		unit->health = i;
+		squad->children.push_back(unit);
+	}
+	for (int32 i = 0; i < 2000; ++i) {
+		squad->children[i].cast<Unit>()->target = squad->children[(i * 13) % 2000].cast<Unit>();
+	}
+	std::string squad_expected = minified_json(*squad, universe3);
+	BinaryArchive squad_archive;
+	squad_archive.serialize(squad, universe3);
+	squad_archive.set_deserialize_threads(8);
+	for (int run = 0; run < 5; ++run) {
+		TestUniverse universe4;
+		ObjectPtr<Unit> squad_copy = squad_archive.deserialize(universe4).cast<Unit>();
+		ASSERT(squad_copy != nullptr && minified_json(*squad_copy, universe4) == squad_expected);
+	}
+}
+
+int main (int argc, char const *argv[])
+{
+	TypeRegistry::add<Object>();
+	TypeRegistry::add<Unit>();
+	TypeRegistry::add<Armor>();
+	TypeRegistry::add<Samples>();
+	test_values();
+	test_round_trip();
+	test_packed_arrays();
+	test_string_ids();
+	test_schema_mismatch();
+	test_mapped();
+	test_lazy();
+	test_parallel();
+	return 0;
+}
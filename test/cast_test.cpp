@@ -0,0 +1,209 @@
+#include "object/object.hpp"
+#include "object/objectptr.hpp"
+#include "object/reflect.hpp"
+#include "object/composite_type.hpp"
+#include "object/universe.hpp"
+#include "base/array_type.hpp"
+#include "base/maybe_type.hpp"
+#include <thread>
+
+struct Base : Object {
+	REFLECT;
+	int32 base_value;
+	Base() : base_value(1) {}
+};
+
+BEGIN_TYPE_INFO(Base)
+	property(&Base::base_value, "base_value", "A number.");
+END_TYPE_INFO()
+
+struct Derived : Base {
+	REFLECT;
+	int32 derived_value;
+	Derived() : derived_value(2) {}
+};
+
+BEGIN_TYPE_INFO(Derived)
+	super(get_type<Base>());
+	property(&Derived::derived_value, "derived_value", "Another number.");
+END_TYPE_INFO()
+
+struct Other : Object {
+	REFLECT;
+	float32 other_value;
+	Other() : other_value(3) {}
+};
+
+BEGIN_TYPE_INFO(Other)
+	property(&Other::other_value, "other_value", "A float.");
+END_TYPE_INFO()
+
+struct Leaf : Object {
+	REFLECT;
+};
+
+BEGIN_TYPE_INFO(Leaf)
+END_TYPE_INFO()
+
+void test_type_ids_and_kinds() {
+	const Type* types[] = {
+		get_type<int32>(), get_type<float32>(), get_type<std::string>(), get_type<Base>(),
+		get_type<Derived>(), get_type<Array<int32>>(), get_type<ObjectPtr<Base>>(), get_type<Maybe<int32>>(),
+	};
+	const size_t n = sizeof(types) / sizeof(types[0]);
+	for (size_t i = 0; i < n; ++i) {
+		ASSERT(types[i]->type_id() < Type::num_type_ids());
+		for (size_t j = i+1; j < n; ++j) {
+			ASSERT(types[i]->type_id() != types[j]->type_id());
+		}
+	}
+
+	ASSERT(get_type<int32>()->kind() == TypeKind::Simple);
+	ASSERT(get_type<std::string>()->kind() == TypeKind::String);
+	ASSERT(get_type<void>()->kind() == TypeKind::Void);
+	ASSERT(get_type<Base>()->kind() == TypeKind::Object);
+	ASSERT(get_type<Array<int32>>()->kind() == TypeKind::Array);
+	ASSERT(get_type<ObjectPtr<Base>>()->kind() == TypeKind::Reference);
+	ASSERT(get_type<Maybe<int32>>()->kind() == TypeKind::Maybe);
+	ASSERT(get_type<Signal<int32>>()->kind() == TypeKind::Signal);
+	ASSERT(get_type<Base>()->is_derived_type());
+	ASSERT(!get_type<int32>()->is_derived_type());
+}
+
+void test_subtypes() {
+	const ObjectTypeBase* object = get_type<Object>();
+	const ObjectTypeBase* base = get_type<Base>();
+	const ObjectTypeBase* derived = get_type<Derived>();
+	const ObjectTypeBase* other = get_type<Other>();
+	
+	ASSERT(object->inheritance_depth() == 0);
+	ASSERT(base->inheritance_depth() == 1);
+	ASSERT(derived->inheritance_depth() == 2);
+	
+	ASSERT(derived->is_subtype_of(derived));
+	ASSERT(derived->is_subtype_of(base));
+	ASSERT(derived->is_subtype_of(object));
+	ASSERT(base->is_subtype_of(object));
+	ASSERT(!base->is_subtype_of(derived));
+	ASSERT(!object->is_subtype_of(base));
+	ASSERT(!other->is_subtype_of(base));
+	ASSERT(!derived->is_subtype_of(other));
+}
+
+void test_object_casts() {
+	TestUniverse universe;
+	ObjectPtr<Derived> d = universe.create<Derived>("Derived");
+	ObjectPtr<Base> b = universe.create<Base>("Base");
+
+	ASSERT(aspect_cast(d, get_type<Base>()) == d);
+	ASSERT(aspect_cast(d, get_type<Object>()) == d);
+	ASSERT(aspect_cast(b, get_type<Derived>()) == nullptr);
+	ASSERT(aspect_cast<Derived>(b) == nullptr);
+	ASSERT(aspect_cast<Other>(d) == nullptr);
+}
+
+void test_composite_casts() {
+	TestUniverse universe;
+
+	CompositeType* inner = new CompositeType("Inner", get_type<Other>());
+	inner->add_aspect(get_type<Derived>());
+	inner->freeze();
+
+	CompositeType* outer = new CompositeType("Outer", get_type<Base>());
+	outer->add_aspect(inner);
+	outer->add_aspect(get_type<Leaf>());
+	outer->freeze();
+
+	ObjectPtr<> o = universe.create_object(outer, "Outer");
+	ObjectPtr<Base> base = aspect_cast<Base>(o);
+	ObjectPtr<Other> other = aspect_cast<Other>(o);
+	ObjectPtr<Derived> derived = aspect_cast<Derived>(o);
+	ObjectPtr<Leaf> leaf = aspect_cast<Leaf>(o);
+	ASSERT(base == o.cast<Base>());
+	ASSERT(other != nullptr && other->other_value == 3);
+	ASSERT(derived != nullptr && derived->derived_value == 2);
+	ASSERT(leaf != nullptr);
+
+	// Casting from a nested composite searches down first, then through its parents.
+	ASSERT(aspect_cast<Base>(other) == derived);
+	ASSERT(aspect_cast<Leaf>(other) == leaf);
+	ASSERT(aspect_cast(other, outer) == o);
+	ASSERT(aspect_cast(o, inner) == other);
+	ASSERT(aspect_cast<Derived>(leaf) == nullptr);
+}
+
+void test_cast_cache() {
+	TestUniverse universe;
+	
+	CompositeType* t = new CompositeType("Cached", get_type<Other>());
+	t->add_aspect(get_type<Derived>());
+	t->freeze();
+	
+	// The second object of the same type is answered from the cache.
+	ObjectPtr<> a = universe.create_object(t, "First");
+	ObjectPtr<> b = universe.create_object(t, "Second");
+	for (int i = 0; i < 2; ++i) {
+		ASSERT(aspect_cast<Derived>(a) != nullptr && aspect_cast<Derived>(a)->derived_value == 2);
+		ASSERT(aspect_cast<Base>(b) == aspect_cast<Derived>(b));
+		ASSERT(aspect_cast<Derived>(a) != aspect_cast<Derived>(b));
+		ASSERT(aspect_cast<Leaf>(a) == nullptr);
+	}
+	
+	// Concurrent lookups and inserts on a cold cache.
+	CompositeType* t2 = new CompositeType("Cached2", get_type<Other>());
+	t2->add_aspect(get_type<Derived>());
+	t2->freeze();
+	ObjectPtr<> c = universe.create_object(t2, "Third");
+	Derived* expected = reinterpret_cast<Derived*>(reinterpret_cast<byte*>(c.get()) + get_type<Other>()->size());
+	Array<std::thread*> threads;
+	for (int i = 0; i < 8; ++i) {
+		threads.push_back(new std::thread([&]() {
+			for (int j = 0; j < 10000; ++j) {
+				ASSERT(aspect_cast<Derived>(c) == expected);
+				ASSERT(aspect_cast<Base>(c) == expected);
+				ASSERT(aspect_cast<Leaf>(c) == nullptr);
+			}
+		}));
+	}
+	for (auto thread: threads) {
+		thread->join();
+		delete thread;
+	}
+}
+
+void test_type_traits() {
+	ASSERT(get_type<int32>()->is_trivially_copyable());
+	ASSERT(get_type<float32>()->is_zero_initializable());
+	ASSERT(!get_type<std::string>()->is_trivially_copyable());
+	ASSERT(!get_type<std::string>()->is_trivially_destructible());
+	ASSERT(!get_type<Array<int32>>()->is_trivially_copyable());
+	ASSERT(!get_type<Base>()->is_zero_initializable());
+	ASSERT(!get_type<Base>()->is_trivially_destructible());
+	
+	TestUniverse universe;
+	int32 numbers[4] = {1, 2, 3, 4};
+	get_type<int32>()->construct_n(reinterpret_cast<byte*>(numbers), 3, sizeof(int32), universe);
+	ASSERT(numbers[0] == 0 && numbers[2] == 0 && numbers[3] == 4);
+	
+	Array<float32> a;
+	a.resize(10000, 1.5f);
+	Array<float32> b = a;
+	ASSERT(b.size() == 10000 && b[9999] == 1.5f);
+	Array<std::string> c;
+	c.push_back("x");
+	c.resize(3, "y");
+	Array<std::string> d;
+	d = c;
+	ASSERT(d.size() == 3 && d[0] == "x" && d[2] == "y");
+}
+
+int main (int argc, char const *argv[])
+{
+	test_type_ids_and_kinds();
+	test_subtypes();
+	test_object_casts();
+	test_composite_casts();
+	test_cast_cache();
+	test_type_traits();
+	return 0;
+}
@@ -0,0 +1,202 @@
+#include "object/object.hpp"
+#include "object/objectptr.hpp"
+#include "object/reflect.hpp"
+#include "object/composite_type.hpp"
+#include "object/composite_type_registry.hpp"
+#include "object/universe.hpp"
+#include "serialization/json_archive.hpp"
+#include "type/type_registry.hpp"
+
+struct Small : Object {
+	REFLECT;
+	int8 value;
+	Small() : value(1) {}
+};
+
+BEGIN_TYPE_INFO(Small)
+	property(&Small::value, "value", "A small number.");
+END_TYPE_INFO()
+
+struct alignas(32) Wide : Object {
+	REFLECT;
+	float32 lanes[8];
+	Wide() { for (auto& it: lanes) it = 2; }
+};
+
+BEGIN_TYPE_INFO(Wide)
+END_TYPE_INFO()
+
+struct SmallDerived : Small {
+	REFLECT;
+};
+
+BEGIN_TYPE_INFO(SmallDerived)
+	super(get_type<Small>());
+END_TYPE_INFO()
+
+static bool is_aligned(const void* p, size_t alignment) {
+	return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+void test_layout() {
+	CompositeType* t = new CompositeType("Layout", get_type<Small>());
+	t->add_aspect(get_type<Small>());
+	t->add_aspect(get_type<Wide>());
+	t->add_aspect(get_type<Small>(), true);
+	t->add_aspect(get_type<Small>());
+	t->freeze();
+	
+	ASSERT(t->offset_of_element(0) == get_type<Small>()->size());
+	ASSERT(t->offset_of_element(1) % 32 == 0);
+	ASSERT(t->offset_of_element(1) >= t->offset_of_element(0) + get_type<Small>()->size());
+	ASSERT(t->offset_of_element(2) % CompositeType::CacheLineSize == 0);
+	ASSERT(t->offset_of_element(3) % CompositeType::CacheLineSize == 0);
+	ASSERT(t->offset_of_element(3) >= t->offset_of_element(2) + get_type<Small>()->size());
+	ASSERT(t->alignment() == CompositeType::CacheLineSize);
+	ASSERT(t->size() % t->alignment() == 0);
+	
+	TestUniverse universe;
+	ObjectPtr<> o = universe.create_object(t, "Layout");
+	ASSERT(is_aligned(o.get(), t->alignment()));
+	ObjectPtr<Wide> wide = aspect_cast<Wide>(o);
+	ASSERT(wide != nullptr && is_aligned(wide.get(), 32));
+	ASSERT(wide->lanes[7] == 2);
+	ASSERT(reinterpret_cast<byte*>(wide.get()) == reinterpret_cast<byte*>(o.get()) + t->offset_of_element(1));
+}
+
+void test_interning() {
+	Array<const DerivedType*> aspects;
+	aspects.push_back(get_type<Small>());
+	aspects.push_back(get_type<Wide>());
+	const CompositeType* a = CompositeTypeRegistry::get(get_type<Small>(), aspects);
+	const CompositeType* b = CompositeTypeRegistry::get(get_type<Small>(), aspects);
+	ASSERT(a == b);
+	ASSERT(a->is_frozen());
+	
+	Array<const DerivedType*> reversed;
+	reversed.push_back(get_type<Wide>());
+	reversed.push_back(get_type<Small>());
+	ASSERT(CompositeTypeRegistry::get(get_type<Small>(), reversed) != a);
+	ASSERT(CompositeTypeRegistry::get(get_type<Wide>(), aspects) != a);
+	
+	CompositeType* by_hand = new CompositeType("ByHand", get_type<Small>());
+	by_hand->add_aspect(get_type<Small>());
+	by_hand->add_aspect(get_type<Wide>());
+	ASSERT(CompositeTypeRegistry::intern(by_hand) == a);
+	
+	CompositeType* hot = new CompositeType("Hot", get_type<Small>());
+	hot->add_aspect(get_type<Small>());
+	hot->add_aspect(get_type<Wide>(), true);
+	ASSERT(CompositeTypeRegistry::intern(hot) == hot);
+	
+	// Deserialized objects with the same composition share a type.
+	TestUniverse universe;
+	ObjectPtr<> original = universe.create_object(a, "Original");
+	JSONArchive archive;
+	archive.serialize(original, universe);
+	size_t num_composites = CompositeTypeRegistry::size();
+	TestUniverse universe2;
+	ObjectPtr<> copy1 = archive.deserialize(universe2);
+	ObjectPtr<> copy2 = archive.deserialize(universe2);
+	ASSERT(copy1->object_type() == a);
+	ASSERT(copy2->object_type() == a);
+	ASSERT(CompositeTypeRegistry::size() == num_composites);
+}
+
+void test_flattened_instances() {
+	CompositeType* inner = new CompositeType("Inner", get_type<Wide>());
+	inner->add_aspect(get_type<SmallDerived>());
+	inner->freeze();
+	
+	CompositeType* middle = new CompositeType("Middle", get_type<Small>());
+	middle->add_aspect(inner);
+	middle->freeze();
+	
+	CompositeType* outer = new CompositeType("Outer");
+	outer->add_aspect(get_type<Small>());
+	outer->add_aspect(middle);
+	outer->freeze();
+	
+	// Object, Small, [Small, [Wide, SmallDerived]]
+	const Array<CompositeType::Instance>& instances = outer->instances();
+	ASSERT(instances.size() == 5);
+	ASSERT(instances[0].type == get_type<Object>() && instances[0].offset == 0);
+	ASSERT(instances[1].type == get_type<Small>() && instances[1].offset == outer->offset_of_element(0));
+	ASSERT(instances[2].type == get_type<Small>() && instances[2].offset == outer->offset_of_element(1));
+	size_t inner_offset = outer->offset_of_element(1) + middle->offset_of_element(0);
+	ASSERT(instances[3].type == get_type<Wide>() && instances[3].offset == inner_offset);
+	ASSERT(instances[4].type == get_type<SmallDerived>() && instances[4].offset == inner_offset + inner->offset_of_element(0));
+	
+	size_t offset;
+	ASSERT(outer->find_instance_offset(get_type<Small>(), offset) && offset == instances[1].offset);
+	ASSERT(outer->find_instance_offset(get_type<SmallDerived>(), offset) && offset == instances[4].offset);
+	ASSERT(outer->find_instance_offset(get_type<Wide>(), offset) && offset == instances[3].offset);
+	ASSERT(outer->find_instance_offset(get_type<Object>(), offset) && offset == 0);
+	ASSERT(inner->find_instance_offset(get_type<Small>(), offset) && offset == inner->offset_of_element(0));
+	
+	TestUniverse universe;
+	ObjectPtr<> o = universe.create_object(outer, "Outer");
+	byte* base = reinterpret_cast<byte*>(o.get());
+	ASSERT(reinterpret_cast<byte*>(aspect_cast<SmallDerived>(o).get()) == base + instances[4].offset);
+	ASSERT(reinterpret_cast<byte*>(aspect_cast<Wide>(o).get()) == base + instances[3].offset);
+	for (auto& it: instances) {
+		Object* sub = reinterpret_cast<Object*>(base + it.offset);
+		ASSERT(sub->universe() == &universe);
+	}
+}
+
+void test_create_objects() {
+	CompositeType* t = new CompositeType("Batch", get_type<Small>());
+	t->add_aspect(get_type<Wide>());
+	t->add_aspect(get_type<SmallDerived>());
+	t->freeze();
+	
+	TestUniverse universe;
+	const size_t count = 1000;
+	Array<ObjectPtr<>> objects = universe.create_objects(t, count, "Unit");
+	ASSERT(objects.size() == count);
+	for (size_t i = 0; i < count; ++i) {
+		ObjectPtr<> o = objects[i];
+		ASSERT(reinterpret_cast<byte*>(o.get()) == reinterpret_cast<byte*>(objects[0].get()) + i * t->size());
+		ASSERT(is_aligned(o.get(), t->alignment()));
+		ASSERT(o->object_type() == t);
+		ASSERT(universe.get_object(o->object_id()) == o);
+		ASSERT(aspect_cast<Wide>(o) != nullptr && aspect_cast<Wide>(o)->lanes[7] == 2);
+		ASSERT(aspect_cast<SmallDerived>(o) != nullptr && aspect_cast<SmallDerived>(o)->value == 1);
+		ASSERT(aspect_cast<SmallDerived>(o)->object_offset() == t->offset_of_element(1));
+		ASSERT(universe.get_object(aspect_cast<Wide>(o)->object_id()) == aspect_cast<Wide>(o));
+	}
+	ASSERT(objects[0]->object_id() != objects[1]->object_id());
+	
+	// Aspects of nested composites are named in the same pass.
+	CompositeType* outer = new CompositeType("Outer", get_type<Small>());
+	outer->add_aspect(t);
+	outer->freeze();
+	Array<ObjectPtr<>> outers = universe.create_objects(outer, 2, "");
+	for (auto o: outers) {
+		ObjectPtr<Wide> wide = aspect_cast<Wide>(o);
+		ASSERT(wide != nullptr && wide->object_id().size() > 0);
+		ASSERT(universe.get_object(wide->object_id()) == wide);
+	}
+	ASSERT(aspect_cast<Wide>(outers[0])->object_id() != aspect_cast<Wide>(outers[1])->object_id());
+	
+	// Plain object types are batched too, and mix with individually created objects.
+	ObjectPtr<> single = universe.create_object(get_type<Small>(), "Unit01");
+	Array<ObjectPtr<>> smalls = universe.create_objects(get_type<Small>(), 3, "");
+	ASSERT(single->object_id() != "Unit01");
+	ASSERT(smalls.size() == 3 && smalls[2].cast<Small>()->value == 1);
+	ASSERT(universe.get_object(smalls[1]->object_id()) == smalls[1]);
+}
+
+int main (int argc, char const *argv[])
+{
+	TypeRegistry::add<Object>();
+	TypeRegistry::add<Small>();
+	TypeRegistry::add<Wide>();
+	
+	test_layout();
+	test_interning();
+	test_flattened_instances();
+	test_create_objects();
+	return 0;
+}
@@ -0,0 +1,491 @@
+#include "object/object.hpp"
+#include "object/objectptr.hpp"
+#include "object/reflect.hpp"
+#include "object/universe.hpp"
+#include "base/array_type.hpp"
+#include "base/arena.hpp"
+#include "serialization/json_archive.hpp"
+#include "serialization/json_archive_writer.hpp"
+#include "serialization/json_archive_reader.hpp"
+#include "serialization/deserialize_object.hpp"
+#include "type/type_registry.hpp"
+#include <sstream>
+#include <random>
+#include <cmath>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+
+// Counts heap allocations, so tests can check that warm paths make none, and keeps the
+// blocks the size of an arena page that are alive, so tests can check they are released.
+static size_t num_allocations = 0;
+static const size_t ArenaPageSize = 64 * 1024;
+static void* pages[256];
+static size_t num_pages = 0;
+
+void* operator new(size_t size) {
+	++num_allocations;
+	void* p = malloc(size ? size : 1);
+	if (p == nullptr) throw std::bad_alloc();
+	if (size == ArenaPageSize && num_pages < 256) pages[num_pages++] = p;
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	for (size_t i = 0; i < num_pages; ++i) {
+		if (pages[i] == p) {
+			pages[i] = pages[--num_pages];
+			break;
+		}
+	}
+	free(p);
+}
+
+struct Scene : Object {
+	REFLECT;
+	int32 count;
+	std::string title;
+	Array<int32> numbers;
+	ObjectPtr<Scene> next;
+	Scene() : count(0) {}
+};
+
+BEGIN_TYPE_INFO(Scene)
+	property(&Scene::count, "count", "A number.");
+	property(&Scene::title, "title", "A name.");
+	property(&Scene::numbers, "numbers", "Some numbers.");
+	property(&Scene::next, "next", "Another scene.");
+END_TYPE_INFO()
+
+struct Tagged : Object {
+	REFLECT;
+	Symbol kind;
+	Array<Symbol> tags;
+};
+
+BEGIN_TYPE_INFO(Tagged)
+	property(&Tagged::kind, "kind", "What it is.");
+	property(&Tagged::tags, "tags", "Repeated labels.");
+END_TYPE_INFO()
+
+static bool read(JSONArchive& archive, const std::string& text, std::string* error = nullptr) {
+	return archive.read(text.data(), text.size(), error);
+}
+
+void test_values() {
+	JSONArchive archive;
+	std::string error;
+	ASSERT(read(archive, " {\"a\": [1, -2, 3.5, -0.25e2, 12345678901234567890, true, false, null],\n\t\"b\": {}, \"c\": [], \"d\": \"x\\\"y\\u00e9\\ud83d\\ude00\\n\", \"e\": \"\xc3\xa9t\xc3\xa9\"} ", &error));
+	const ArchiveNode& root = archive.root();
+	ASSERT(root.is_map());
+	const ArchiveNode& a = root["a"];
+	ASSERT(a.array_size() == 8);
+	int64 n;
+	float64 f;
+	ASSERT(a[0].get(n) && n == 1);
+	ASSERT(a[1].get(n) && n == -2);
+	ASSERT(a[2].get(f) && f == 3.5);
+	ASSERT(a[3].get(f) && f == -25);
+	ASSERT(a[4].get(f) && f == 12345678901234567890.0);
+	ASSERT(a[5].get(n) && n == 1);
+	ASSERT(a[6].get(n) && n == 0);
+	ASSERT(a[7].is_empty());
+	ASSERT(root["b"].is_map());
+	ASSERT(root["c"].is_array() && root["c"].array_size() == 0);
+	std::string s;
+	ASSERT(root["d"].get(s) && s == "x\"y\xc3\xa9\xf0\x9f\x98\x80\n");
+	ASSERT(root["e"].get(s) && s == "\xc3\xa9t\xc3\xa9");
+	
+	// Long strings and indentation go through the vector loops.
+	std::string long_string(1000, 'z');
+	std::string indented = "[" + std::string(100, ' ') + "\"" + long_string + "\"" + std::string(50, '\n') + "]";
+	ASSERT(read(archive, indented));
+	ASSERT(archive.root()[0].get(s) && s == long_string);
+	
+	// Only a lone "root" key is unwrapped.
+	ASSERT(read(archive, "{\"root\": {\"x\": 1}}"));
+	ASSERT(archive.root()["x"].get(n) && n == 1);
+	ASSERT(read(archive, "{\"root\": {\"x\": 1}, \"y\": 2}"));
+	ASSERT(archive.root()["root"]["x"].get(n) && n == 1);
+	ASSERT(archive.root()["y"].get(n) && n == 2);
+	
+	// Integers that fit in an int64 read back exactly, at either end of the range.
+	JSONArchive limits;
+	limits.root()["max"].set(int64(INT64_MAX));
+	limits.root()["min"].set(int64(INT64_MIN));
+	limits.root()["umax"].set(uint64(UINT64_MAX));
+	std::stringstream ss;
+	limits.write(ss);
+	ASSERT(read(archive, ss.str()));
+	uint64 u;
+	ASSERT(archive.root()["max"].get(n) && n == INT64_MAX);
+	ASSERT(archive.root()["min"].get(n) && n == INT64_MIN);
+	ASSERT(archive.root()["umax"].get(u) && u == UINT64_MAX);
+	ASSERT(read(archive, "[9223372036854775808, -9223372036854775809]"));
+	ASSERT(archive.root()[0].get(f) && archive.root()[1].get(f));
+}
+
+void test_errors() {
+	const char* invalid[] = {
+		"", "{", "[1,]", "{\"a\" 1}", "{\"a\": 1,}", "01", "1.", "-", "tru", "\"abc", "\"a\x01\"", "\"\\x\"",
+		"\"\\ud800\"", "\"\xc3\"", "\"\xc0\xaf\"", "\"\xed\xa0\x80\"", "[1] 2", "{1: 2}",
+	};
+	for (auto text: invalid) {
+		JSONArchive archive;
+		std::string error;
+		ASSERT(!read(archive, text, &error));
+		ASSERT(error.size() > 0);
+	}
+	
+	std::string deep(10000, '[');
+	JSONArchive archive;
+	ASSERT(!read(archive, deep));
+}
+
+void test_round_trip() {
+	TestUniverse universe;
+	ObjectPtr<Scene> a = universe.create<Scene>("A");
+	a->count = 42;
+	a->title = "First";
+	a->next = a;
+	for (int32 i = 0; i < 100; ++i) a->numbers.push_back(i * i - 50);
+	
+	JSONArchive out;
+	out.serialize(a, universe);
+	std::stringstream ss;
+	out.write(ss);
+	std::string text = ss.str();
+	// The class and ID come first, so the pull reader can create objects without buffering.
+	ASSERT(text.find("\"class\"") < text.find("\"id\""));
+	ASSERT(text.find("\"id\"") < text.find("\"count\""));
+	
+	JSONArchive in;
+	std::string error;
+	ASSERT(in.read(text.data(), text.size(), &error));
+	TestUniverse universe2;
+	ObjectPtr<Scene> copy = in.deserialize(universe2).cast<Scene>();
+	ASSERT(copy != nullptr);
+	ASSERT(copy->count == 42);
+	ASSERT(copy->title == "First");
+	ASSERT(copy->numbers.size() == 100 && copy->numbers[99] == 99 * 99 - 50);
+	ASSERT(copy->next == copy);
+}
+
+void test_reset() {
+	TestUniverse universe;
+	ObjectPtr<Scene> a = universe.create<Scene>("A");
+	a->title = "Replicated";
+	a->next = a;
+	for (int32 i = 0; i < 50; ++i) a->numbers.push_back(i);
+	
+	JSONArchive archive;
+	JSONWriter writer(false);
+	std::string first;
+	size_t allocations = 0;
+	for (int i = 0; i < 10; ++i) {
+		a->count = i;
+		archive.reset();
+		archive.serialize(a, universe);
+		writer.buffer().clear();
+		archive.write(writer);
+		if (i == 0) first = writer.buffer();
+		// After warming up, the same shape of document is written without allocating.
+		if (i == 2) allocations = num_allocations;
+	}
+	ASSERT(num_allocations == allocations);
+	
+	a->count = 0;
+	JSONArchive fresh;
+	fresh.serialize(a, universe);
+	JSONWriter fresh_writer(false);
+	fresh.write(fresh_writer);
+	ASSERT(fresh_writer.buffer() == first);
+	
+	// A reset archive reads and deserializes like a new one.
+	archive.reset();
+	ASSERT(archive.read(first.data(), first.size()));
+	TestUniverse universe2;
+	ObjectPtr<Scene> copy = archive.deserialize(universe2).cast<Scene>();
+	ASSERT(copy != nullptr && copy->title == "Replicated" && copy->numbers.size() == 50);
+	ASSERT(copy->next == copy);
+}
+
+void test_arena() {
+	size_t pages = num_pages;
+	const char* adopted;
+	{
+		Arena arena;
+		const char* first = arena.copy("first");
+		for (int64 i = 0; i < 20000; ++i) arena.make<int64>(i);
+		size_t used = num_pages - pages;
+		ASSERT(used > 1);
+		
+		// A reset arena allocates from its pages again, the first one first.
+		arena.reset();
+		ASSERT(num_pages - pages == used);
+		size_t allocations = num_allocations;
+		ASSERT(arena.copy("first") == first);
+		for (int64 i = 0; i < 20000; ++i) arena.make<int64>(i);
+		ASSERT(num_allocations == allocations);
+		
+		// Adopted pages live as long as the arena that took them.
+		{
+			Arena other;
+			adopted = other.copy("adopted");
+			for (int64 i = 0; i < 20000; ++i) other.make<int64>(i);
+			arena.adopt(other);
+		}
+		ASSERT(num_pages - pages == 2 * used);
+		ASSERT(strcmp(adopted, "adopted") == 0);
+	}
+	ASSERT(num_pages == pages);
+	
+	// The records of an archive are released by clear_deferred(), which keeps the pages
+	// for the next document, and the pages with the archive.
+	{
+		JSONArchive archive;
+		for (int64 i = 0; i < 20000; ++i) archive.fixup_arena().make<int64>(i);
+		size_t used = num_pages - pages;
+		ASSERT(used > 1);
+		archive.clear_deferred();
+		size_t allocations = num_allocations;
+		for (int64 i = 0; i < 20000; ++i) archive.fixup_arena().make<int64>(i);
+		ASSERT(num_allocations == allocations && num_pages - pages == used);
+	}
+	ASSERT(num_pages == pages);
+}
+
+void test_map_keys() {
+	ASSERT(Symbol("speed") == Symbol(std::string("speed")));
+	ASSERT(Symbol("speed") != Symbol("health"));
+	ASSERT(Symbol("speed").str() == "speed" && Symbol().str() == "");
+	
+	// Small maps are searched linearly, larger ones through a hash index; both keep their
+	// keys in the order they were added.
+	JSONArchive archive;
+	ArchiveNode& root = archive.root();
+	for (int i = 39; i >= 0; --i) {
+		root["key" + std::to_string(i % 2 ? i : 79 - i)] = i;
+	}
+	ASSERT(root["key1"].type() == ArchiveNodeType::Integer);
+	const ArchiveNode& croot = root;
+	int64 n;
+	ASSERT(croot[Symbol("key41")].get(n) && n == 38);
+	ASSERT(croot["key79"].get(n) && n == 0);
+	ASSERT(croot["key2"].is_empty());
+	ASSERT(croot["never interned anywhere"].is_empty());
+	JSONWriter writer(false);
+	archive.write(writer);
+	std::string start = "{\"root\":{\"key39\":39,\"key41\":38,";
+	ASSERT(writer.buffer().compare(0, start.size(), start) == 0);
+}
+
+void test_symbols() {
+	ASSERT(TypeRegistry::get("Tagged") == get_type<Tagged>());
+	ASSERT(TypeRegistry::get(get_type<Tagged>()->symbol()) == get_type<Tagged>());
+	ASSERT(TypeRegistry::get("NoSuchTypeAnywhere") == nullptr);
+	ASSERT(get_type<Symbol>()->kind() == TypeKind::Symbol);
+	Symbol grown("grown0");
+	for (int i = 1; i < 5000; ++i) Symbol("grown" + std::to_string(i));
+	ASSERT(Symbol::lookup("grown0") == grown && Symbol::lookup("grown4999").str() == "grown4999");
+	
+	// Keys read from a document are the archive's own, and are not interned.
+	{
+		JSONArchive keys;
+		const JSONArchive& ckeys = keys;
+		ASSERT(read(keys, "{\"unheard_of\": {\"never_seen\": 3, \"count\": 1}}"));
+		Symbol symbol;
+		ASSERT(!Symbol::find("unheard_of", symbol) && !Symbol::find("never_seen", symbol));
+		int64 n;
+		ASSERT(ckeys["unheard_of"]["never_seen"].get(n) && n == 3);
+		keys["unheard_of"]["never_seen"] = 4;
+		ASSERT(Symbol::lookup("never_seen").empty());
+		// A symbol interned later finds the key with its text.
+		ASSERT(ckeys["unheard_of"][Symbol("never_seen")].get(n) && n == 4);
+		JSONWriter key_writer(false);
+		keys.write(key_writer);
+		ASSERT(key_writer.buffer() == "{\"root\":{\"unheard_of\":{\"never_seen\":4,\"count\":1}}}");
+	}
+	
+	TestUniverse universe;
+	ObjectPtr<Tagged> a = universe.create<Tagged>("Tagged");
+	a->kind = Symbol("enemy");
+	for (int i = 0; i < 4; ++i) a->tags.push_back(Symbol(i % 2 ? "red" : "blue"));
+	
+	JSONArchive out;
+	out.serialize(a, universe);
+	JSONWriter writer(false);
+	out.write(writer);
+	ASSERT(writer.buffer().find("\"kind\":\"enemy\"") != std::string::npos);
+	
+	JSONArchive in;
+	ASSERT(read(in, writer.buffer()));
+	TestUniverse universe2;
+	ObjectPtr<Tagged> copy = in.deserialize(universe2).cast<Tagged>();
+	ASSERT(copy != nullptr && copy->kind == Symbol("enemy"));
+	ASSERT(copy->tags.size() == 4 && copy->tags[0] == Symbol("blue") && copy->tags[1] == Symbol("red"));
+	JSONArchiveReader reader(writer.buffer().data(), writer.buffer().size());
+	ObjectPtr<Tagged> pulled = deserialize_document(reader, universe2).cast<Tagged>();
+	ASSERT(pulled != nullptr && pulled->kind == copy->kind && pulled->tags[3] == copy->tags[1]);
+}
+
+static std::string float_string(float64 f) {
+	char buffer[MaxNumberLength];
+	return std::string(buffer, format_float(f, buffer));
+}
+
+static std::string integer_string(int64 n) {
+	char buffer[MaxNumberLength];
+	return std::string(buffer, format_integer(n, buffer));
+}
+
+void test_number_formatting() {
+	ASSERT(integer_string(0) == "0");
+	ASSERT(integer_string(-7) == "-7");
+	ASSERT(integer_string(1234567) == "1234567");
+	ASSERT(integer_string(INT64_MIN) == "-9223372036854775808");
+	ASSERT(integer_string(INT64_MAX) == "9223372036854775807");
+	
+	ASSERT(float_string(0) == "0.0");
+	ASSERT(float_string(-0.0) == "-0.0");
+	ASSERT(float_string(1) == "1.0");
+	ASSERT(float_string(1.5) == "1.5");
+	ASSERT(float_string(0.1) == "0.1");
+	ASSERT(float_string(-123.456) == "-123.456");
+	ASSERT(float_string(0.001234) == "0.001234");
+	ASSERT(float_string(1e30) == "1e30");
+	ASSERT(float_string(1.5e-10) == "1.5e-10");
+	ASSERT(float_string(5e-324) == "5e-324");
+	ASSERT(float_string(1.7976931348623157e308) == "1.7976931348623157e308");
+	ASSERT(float_string(float32(0.1f)) == "0.10000000149011612");
+	ASSERT(float_string(NAN) == "null");
+	
+	// Everything must read back exactly.
+	std::mt19937_64 random(1234);
+	for (int i = 0; i < 100000; ++i) {
+		uint64 bits = random();
+		float64 f;
+		memcpy(&f, &bits, sizeof(f));
+		if (f != f || f - f != 0) continue;
+		std::string s = float_string(f);
+		ASSERT(strtod(s.c_str(), nullptr) == f);
+	}
+}
+
+void test_writer() {
+	JSONArchive archive;
+	ArchiveNode& root = archive.root();
+	root["text"] = std::string("a\"b\\c\n\x01\xc3\xa9 and a long tail that needs no escaping at all");
+	root["list"].array_push() = int64(1);
+	root["list"].array_push() = 2.5;
+	root["empty"];
+	
+	JSONWriter minified(false);
+	archive.write(minified);
+	ASSERT(minified.buffer() == "{\"root\":{\"text\":\"a\\\"b\\\\c\\n\\u0001\xc3\xa9 and a long tail that needs no escaping at all\",\"list\":[1,2.5],\"empty\":null}}");
+	
+	JSONArchive copy;
+	ASSERT(copy.read(minified.buffer().data(), minified.buffer().size()));
+	std::string text;
+	ASSERT(copy.root()["text"].get(text) && text == "a\"b\\c\n\x01\xc3\xa9 and a long tail that needs no escaping at all");
+	float64 f;
+	ASSERT(copy.root()["list"][1].get(f) && f == 2.5);
+	
+	JSONWriter pretty;
+	archive.write(pretty);
+	ASSERT(pretty.buffer() == "{ \"root\": {\n    \"text\": \"a\\\"b\\\\c\\n\\u0001\xc3\xa9 and a long tail that needs no escaping at all\",\n    \"list\": [\n      1,\n      2.5\n    ],\n    \"empty\": null\n  }\n}\n");
+}
+
+void test_streaming() {
+	TestUniverse universe;
+	ObjectPtr<Scene> a = universe.create<Scene>("A");
+	a->count = 7;
+	a->title = "Streamed";
+	a->next = a;
+	a->numbers.push_back(3);
+	
+	JSONWriter minified(false);
+	JSONArchiveWriter(minified).write_document(*a, universe);
+	const std::string& id = a->object_id();
+	ASSERT(minified.buffer() == "{\"root\":{\"class\":\"Scene\",\"id\":\"" + id + "\",\"count\":7,\"title\":\"Streamed\",\"numbers\":[3],\"next\":\"" + id + "\"}}");
+	
+	JSONArchive in;
+	ASSERT(in.read(minified.buffer().data(), minified.buffer().size()));
+	TestUniverse universe2;
+	ObjectPtr<Scene> copy = in.deserialize(universe2).cast<Scene>();
+	ASSERT(copy != nullptr && copy->count == 7 && copy->title == "Streamed");
+	ASSERT(copy->numbers.size() == 1 && copy->next == copy);
+	
+	// Pretty output is laid out like the tree writer's; only the key order differs.
+	JSONArchive tree;
+	tree.serialize(a, universe);
+	JSONWriter written;
+	tree.write(written);
+	JSONWriter streamed;
+	JSONArchiveWriter(streamed).write_document(*a, universe);
+	ASSERT(streamed.buffer().size() == written.buffer().size());
+}
+
+static ObjectPtr<Scene> pull(const std::string& text, IUniverse& universe, std::string* error = nullptr) {
+	JSONArchiveReader reader(text.data(), text.size());
+	ObjectPtr<> root = deserialize_document(reader, universe);
+	if (error) *error = reader.error();
+	return root != nullptr ? root.cast<Scene>() : nullptr;
+}
+
+void test_pull_reader() {
+	TestUniverse universe;
+	ObjectPtr<Scene> a = universe.create<Scene>("Original");
+	a->count = 3;
+	a->title = "Pulled";
+	a->next = a;
+	for (int32 i = 0; i < 10; ++i) a->numbers.push_back(i);
+	
+	// Streamed and tree documents both have the class first.
+	JSONWriter streamed(false);
+	JSONArchiveWriter(streamed).write_document(*a, universe);
+	JSONArchive tree;
+	tree.serialize(a, universe);
+	std::stringstream ss;
+	tree.write(ss);
+	std::string texts[] = { streamed.buffer(), ss.str() };
+	for (auto& text: texts) {
+		TestUniverse universe2;
+		ObjectPtr<Scene> copy = pull(text, universe2);
+		ASSERT(copy != nullptr && copy->object_id() == "Original");
+		ASSERT(copy->count == 3 && copy->title == "Pulled" && copy->next == copy);
+		ASSERT(copy->numbers.size() == 10 && copy->numbers[9] == 9);
+	}
+	
+	// Properties before the class, unknown keys and mismatched values.
+	TestUniverse universe3;
+	ObjectPtr<Scene> copy = pull("{\"root\": {\"title\": \"T\", \"extra\": [1, {\"a\": [2]}], \"class\": \"Scene\", \"count\": \"x\", \"numbers\": [1, 2.5, 3], \"id\": \"Third\"}}", universe3);
+	ASSERT(copy != nullptr && copy->object_id() == "Third");
+	ASSERT(copy->title == "T" && copy->count == 0 && copy->next == nullptr);
+	ASSERT(copy->numbers.size() == 3 && copy->numbers[2] == 3);
+	
+	std::string error;
+	TestUniverse universe4;
+	ASSERT(pull("{\"root\": {\"class\": \"Scene\", \"count\": 1", universe4, &error) == nullptr);
+	ASSERT(error.size() > 0);
+	ASSERT(pull("[1]", universe4, &error) == nullptr);
+}
+
+int main (int argc, char const *argv[])
+{
+	TypeRegistry::add<Object>();
+	TypeRegistry::add<Scene>();
+	TypeRegistry::add<Tagged>();
+	test_values();
+	test_errors();
+	test_round_trip();
+	test_reset();
+	test_arena();
+	test_map_keys();
+	test_symbols();
+	test_number_formatting();
+	test_writer();
+	test_streaming();
+	test_pull_reader();
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include "object/object.hpp"
+#include "object/objectptr.hpp"
+#include "object/reflect.hpp"
+#include "object/universe.hpp"
+#include "base/array_type.hpp"
+#include "base/simd.hpp"
+#include "serialization/json_archive.hpp"
+#include "type/type_registry.hpp"
+
+struct Particle : Object {
+	REFLECT;
+	vec3 position;
+	ivec2 cell;
+	Array<vec4> colors;
+	Particle() : position({{0, 0, 0}}), cell({{0, 0}}) {}
+};
+
+BEGIN_TYPE_INFO(Particle)
+	property(&Particle::position, "position", "Where it is.");
+	property(&Particle::cell, "cell", "The grid cell it is in.");
+	property(&Particle::colors, "colors", "Colours over its lifetime.");
+END_TYPE_INFO()
+
+void test_vector_types() {
+	ASSERT(get_type<vec2>()->kind() == TypeKind::Vector);
+	ASSERT(get_type<vec3>()->size() == 16);
+	ASSERT(get_type<ivec4>()->alignment() == 16);
+	ASSERT(static_cast<const VectorType*>(get_type<vec3>())->num_components() == 3);
+	ASSERT(static_cast<const VectorType*>(get_type<ivec2>())->is_float() == false);
+	ASSERT(get_type<vec4>()->is_simple_type());
+	ASSERT(get_type<vec4>()->is_trivially_copyable());
+	ASSERT(get_type<Array<vec4>>()->name() == "vec4[]");
+}
+
+void test_conversions() {
+	// Odd lengths exercise both the vector kernels and the scalar tail.
+	const size_t n = 37;
+	float64 doubles[n];
+	int64 longs[n];
+	for (size_t i = 0; i < n; ++i) {
+		doubles[i] = float64(i) * 0.5 - 7;
+		longs[i] = int64(i) * 1000 - 5000;
+	}
+	float32 floats[n];
+	int32 ints[n];
+	convert_float64_to_float32(doubles, floats, n);
+	convert_int64_to_int32(longs, ints, n);
+	for (size_t i = 0; i < n; ++i) {
+		ASSERT(floats[i] == float32(doubles[i]));
+		ASSERT(ints[i] == int32(longs[i]));
+	}
+	float64 doubles2[n];
+	int64 longs2[n];
+	convert_float32_to_float64(floats, doubles2, n);
+	convert_int32_to_int64(ints, longs2, n);
+	for (size_t i = 0; i < n; ++i) {
+		ASSERT(doubles2[i] == doubles[i]);
+		ASSERT(longs2[i] == longs[i]);
+	}
+}
+
+void test_round_trip() {
+	TestUniverse universe;
+	ObjectPtr<Particle> p = universe.create<Particle>("Particle");
+	p->position = vec3{{1.5f, -2, 3.25f}};
+	p->cell = ivec2{{-4, 9}};
+	for (int i = 0; i < 1000; ++i) {
+		p->colors.push_back(vec4{{float32(i), 0.5f, -float32(i), 1}});
+	}
+	
+	JSONArchive archive;
+	archive.serialize(p, universe);
+	TestUniverse universe2;
+	ObjectPtr<Particle> copy = archive.deserialize(universe2).cast<Particle>();
+	ASSERT(copy != nullptr);
+	ASSERT(copy->position == p->position);
+	ASSERT(copy->cell == p->cell);
+	ASSERT(copy->colors.size() == 1000);
+	for (int i = 0; i < 1000; ++i) {
+		ASSERT(copy->colors[i] == p->colors[i]);
+	}
+}
+
+int main (int argc, char const *argv[])
+{
+	TypeRegistry::add<Object>();
+	TypeRegistry::add<Particle>();
+	test_vector_types();
+	test_conversions();
+	test_round_trip();
+	return 0;
+}
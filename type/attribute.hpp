@@ -5,16 +5,19 @@
 #include "object/object.hpp"
 #include "type/type.hpp"
 #include "serialization/archive.hpp"
+#include "serialization/archive_writer.hpp"
+#include "serialization/archive_reader.hpp"
 
 struct AttributeBase {
-	AttributeBase(std::string name, std::string description) : name_(std::move(name)), description_(std::move(description)) {}
+	AttributeBase(const std::string& name, std::string description) : name_(name), description_(std::move(description)) {}
 	virtual ~AttributeBase() {}
 	
 	virtual const Type* type() const = 0;
-	const std::string& name() const { return name_; }
+	const std::string& name() const { return name_.str(); }
+	Symbol symbol() const { return name_; }
 	const std::string& description() const { return description_; }
 protected:
-	std::string name_;
+	Symbol name_;
 	std::string description_;
 };
 
@@ -29,9 +32,13 @@ struct AttributeForObject {
 	virtual ~AttributeForObject() {}
 	virtual const Type* attribute_type() const = 0;
 	virtual const std::string& attribute_name() const = 0;
+	virtual Symbol attribute_symbol() const = 0;
 	virtual const std::string& attribute_description() const = 0;
+	virtual const AttributeBase* attribute_base() const = 0;
 	virtual bool deserialize_attribute(T* object, const ArchiveNode&, IUniverse&) const = 0;
+	virtual bool deserialize_attribute(T* object, ArchiveReader&, IUniverse&) const = 0;
 	virtual bool serialize_attribute(const T* object, ArchiveNode&, IUniverse&) const = 0;
+	virtual bool serialize_attribute(const T* object, ArchiveWriter&, IUniverse&) const = 0;
 };
 
 template <typename ObjectType, typename MemberType, typename GetterType = MemberType>
@@ -42,8 +49,10 @@ struct AttributeForObjectOfType : AttributeForObject<ObjectType>, Attribute<Memb
 	virtual void set(ObjectType&, MemberType value) const = 0;
 	
 	const Type* attribute_type() const { return get_type<MemberType>(); }
-	const std::string& attribute_name() const { return this->name_; }
+	const std::string& attribute_name() const { return this->name_.str(); }
+	Symbol attribute_symbol() const { return this->name_; }
 	const std::string& attribute_description() const { return this->description_; }
+	const AttributeBase* attribute_base() const { return this; }
 	
 	bool deserialize_attribute(ObjectType* object, const ArchiveNode& node, IUniverse& universe) const {
 		MemberType value;
@@ -52,11 +61,24 @@ struct AttributeForObjectOfType : AttributeForObject<ObjectType>, Attribute<Memb
 		return true; // eh...
 	}
 	
+	bool deserialize_attribute(ObjectType* object, ArchiveReader& reader, IUniverse& universe) const {
+		MemberType value;
+		this->type()->deserialize(reinterpret_cast<byte*>(&value), reader, universe);
+		set(*object, std::move(value));
+		return true;
+	}
+	
 	bool serialize_attribute(const ObjectType* object, ArchiveNode& node, IUniverse& universe) const {
 		GetterType value = get(*object);
 		this->type()->serialize(reinterpret_cast<const byte*>(&value), node, universe);
 		return true; // eh...
 	}
+	
+	bool serialize_attribute(const ObjectType* object, ArchiveWriter& writer, IUniverse& universe) const {
+		GetterType value = get(*object);
+		this->type()->serialize(reinterpret_cast<const byte*>(&value), writer, universe);
+		return true;
+	}
 };
 
 template <typename ObjectType, typename MemberType>
@@ -80,6 +102,12 @@ struct MemberAttribute : AttributeForObjectOfType<ObjectType, MemberType, const
 		return true; // eh...
 	}
 	
+	bool deserialize_attribute(ObjectType* object, ArchiveReader& reader, IUniverse& universe) const {
+		MemberType* ptr = &(object->*member_);
+		this->type()->deserialize(reinterpret_cast<byte*>(ptr), reader, universe);
+		return true;
+	}
+	
 	MemberPointer member_;
 };
 
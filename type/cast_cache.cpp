@@ -0,0 +1,87 @@
+#include "type/cast_cache.hpp"
+
+namespace {
+	inline uint64 make_entry(uint32 type_id, int32 offset) {
+		return (uint64(type_id) + 1) << 32 | uint32(offset);
+	}
+	inline uint32 entry_key(uint64 entry) {
+		return uint32(entry >> 32);
+	}
+	inline int32 entry_offset(uint64 entry) {
+		return int32(uint32(entry));
+	}
+}
+
+CastCache::~CastCache() {
+	deallocate_table(table_.load());
+	for (auto t: retired_) {
+		deallocate_table(t);
+	}
+}
+
+bool CastCache::lookup(uint32 type_id, int32& out_offset) const {
+	const Table* t = table_.load(std::memory_order_acquire);
+	if (t == nullptr) return false;
+	const uint32 key = type_id + 1;
+	const uint32 mask = t->capacity - 1;
+	for (uint32 i = hash(type_id) & mask;; i = (i + 1) & mask) {
+		uint64 entry = t->entries[i].load(std::memory_order_acquire);
+		if (entry == 0) return false;
+		if (entry_key(entry) == key) {
+			out_offset = entry_offset(entry);
+			return true;
+		}
+	}
+}
+
+void CastCache::insert(uint32 type_id, int32 offset) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	Table* t = table_.load(std::memory_order_relaxed);
+	
+	// Keep the load factor at or below 1/2, so probes stay short and always terminate.
+	if (t == nullptr || (t->size + 1) * 2 > t->capacity) {
+		Table* grown = allocate_table(t ? t->capacity * 2 : 8);
+		if (t != nullptr) {
+			for (uint32 i = 0; i < t->capacity; ++i) {
+				uint64 entry = t->entries[i].load(std::memory_order_relaxed);
+				if (entry != 0) insert_into(grown, entry);
+			}
+			retired_.push_back(t);
+		}
+		table_.store(grown, std::memory_order_release);
+		t = grown;
+	}
+	
+	insert_into(t, make_entry(type_id, offset));
+}
+
+CastCache::Table* CastCache::allocate_table(uint32 capacity) {
+	Table* t = new Table;
+	t->capacity = capacity;
+	t->size = 0;
+	t->entries = new std::atomic<uint64>[capacity];
+	for (uint32 i = 0; i < capacity; ++i) {
+		t->entries[i].store(0, std::memory_order_relaxed);
+	}
+	return t;
+}
+
+void CastCache::deallocate_table(Table* t) {
+	if (t == nullptr) return;
+	delete[] t->entries;
+	delete t;
+}
+
+void CastCache::insert_into(Table* t, uint64 entry) {
+	const uint32 key = entry_key(entry);
+	const uint32 mask = t->capacity - 1;
+	for (uint32 i = hash(key - 1) & mask;; i = (i + 1) & mask) {
+		uint64 existing = t->entries[i].load(std::memory_order_relaxed);
+		if (existing == 0) {
+			t->entries[i].store(entry, std::memory_order_release);
+			t->size++;
+			return;
+		}
+		if (entry_key(existing) == key) return; // another thread got here first
+	}
+}
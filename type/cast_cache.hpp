@@ -0,0 +1,44 @@
+#pragma once
+#ifndef CAST_CACHE_HPP_Q8N3ZT1D
+#define CAST_CACHE_HPP_Q8N3ZT1D
+
+#include "base/basic.hpp"
+#include "base/array.hpp"
+#include <atomic>
+#include <mutex>
+#include <limits.h>
+
+// Maps target type IDs to the byte offset at which an instance of that type
+// was found (or NotFound). Lookups are lock-free and may run on any number of
+// threads concurrently with each other and with insert().
+class CastCache {
+public:
+	static const int32 NotFound = INT_MIN;
+	
+	CastCache() : table_(nullptr) {}
+	~CastCache();
+	
+	bool lookup(uint32 type_id, int32& out_offset) const;
+	void insert(uint32 type_id, int32 offset);
+private:
+	CastCache(const CastCache&) = delete;
+	CastCache& operator=(const CastCache&) = delete;
+	
+	// An entry is (type_id+1) in the upper 32 bits and the offset in the lower 32 bits; 0 is empty.
+	struct Table {
+		uint32 capacity; // power of two
+		uint32 size;
+		std::atomic<uint64>* entries;
+	};
+	
+	static Table* allocate_table(uint32 capacity);
+	static void deallocate_table(Table* table);
+	static void insert_into(Table* table, uint64 entry);
+	static uint32 hash(uint32 type_id) { return type_id * 0x9e3779b9u; }
+	
+	std::atomic<Table*> table_;
+	std::mutex mutex_;
+	Array<Table*> retired_; // old tables may still be read by concurrent lookups
+};
+
+#endif /* end of include guard: CAST_CACHE_HPP_Q8N3ZT1D */
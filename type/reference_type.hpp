@@ -4,9 +4,11 @@
 
 #include "type/type.hpp"
 #include "serialization/archive_node.hpp"
+#include "serialization/archive_writer.hpp"
+#include "serialization/archive_reader.hpp"
 
 struct ReferenceType : Type {
-	ReferenceType(std::string name) : name_(std::move(name)) {}
+	ReferenceType(std::string name) : Type(TypeKind::Reference), name_(std::move(name)) {}
 	
 	virtual const Type* pointee_type() const = 0;
 	
@@ -28,7 +30,9 @@ struct ReferenceTypeImpl : TypeFor<T, ReferenceType> {
 	
 	// Type interface
 	void deserialize(T& ptr, const ArchiveNode& node, IUniverse&) const;
+	void deserialize(T& ptr, ArchiveReader& reader, IUniverse&) const;
 	void serialize(const T& ptr, ArchiveNode& node, IUniverse&) const;
+	void serialize(const T& ptr, ArchiveWriter& writer, IUniverse&) const;
 };
 
 template <typename T>
@@ -36,9 +40,31 @@ void ReferenceTypeImpl<T>::deserialize(T& ptr, const ArchiveNode& node, IUnivers
 	node.register_reference_for_deserialization(ptr);
 }
 
+template <typename T>
+void ReferenceTypeImpl<T>::deserialize(T& ptr, ArchiveReader& reader, IUniverse&) const {
+	if (reader.peek() == ArchiveNodeType::Integer) {
+		// An index into the document's object table.
+		int64 index;
+		if (reader.read(index) && index >= 0) {
+			reader.register_reference_for_deserialization(reader.fixup_arena().make<DeserializeReference<T>>(size_t(index), ptr));
+		}
+		return;
+	}
+	std::string id;
+	if (reader.read(id)) {
+		reader.register_reference_for_deserialization(reader.fixup_arena().make<DeserializeReference<T>>(reader.fixup_arena().copy(id), ptr));
+	}
+}
+
 template <typename T>
 void ReferenceTypeImpl<T>::serialize(const T& ptr, ArchiveNode& node, IUniverse&) const {
 	node.register_reference_for_serialization(ptr);
 }
 
+template <typename T>
+void ReferenceTypeImpl<T>::serialize(const T& ptr, ArchiveWriter& writer, IUniverse& universe) const {
+	// Object IDs are assigned when objects are created, so there is nothing to defer.
+	writer.reference(ptr.get(), universe);
+}
+
 #endif /* end of include guard: REFERENCE_TYPE_HPP_EAHSMBCU */
@@ -1,6 +1,54 @@
 #include "type/type.hpp"
 #include "serialization/archive_node.hpp"
+#include "serialization/archive_writer.hpp"
+#include "serialization/archive_reader.hpp"
+#include "serialization/archive.hpp"
+#include "base/simd.hpp"
 #include <map>
+#include <atomic>
+#include <cstring>
+
+namespace {
+	std::atomic<uint32> g_next_type_id(0);
+}
+
+Type::Type(TypeKind::Kind kind) : type_id_(g_next_type_id++), kind_(kind) {}
+
+void Type::construct_n(byte* place, size_t count, size_t stride, IUniverse& universe) const {
+	if (is_zero_initializable() && stride == size()) {
+		memset(place, 0, count * stride);
+		return;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		construct(place + i * stride, universe);
+	}
+}
+
+void Type::destruct_n(byte* place, size_t count, size_t stride, IUniverse& universe) const {
+	if (is_trivially_destructible()) return;
+	for (size_t i = 0; i < count; ++i) {
+		destruct(place + i * stride, universe);
+	}
+}
+
+void Type::serialize(const byte* place, ArchiveWriter& writer, IUniverse& universe) const {
+	ScratchArchive scratch;
+	ArchiveNode& node = *scratch.make();
+	serialize(place, node, universe);
+	scratch.perform_serialize_references(universe);
+	writer.write_node(node);
+}
+
+void Type::deserialize(byte* place, ArchiveReader& reader, IUniverse& universe) const {
+	ScratchArchive scratch;
+	ArchiveNode& node = reader.read_node(scratch);
+	deserialize(place, node, universe);
+	scratch.move_deferred_to(reader);
+}
+
+uint32 Type::num_type_ids() {
+	return g_next_type_id;
+}
 
 #define DEFINE_SIMPLE_TYPE(T, IS_FLOAT, IS_SIGNED) template <> const Type* build_type_info<T>() { \
 	if (IS_FLOAT) { \
@@ -23,6 +71,20 @@ DEFINE_SIMPLE_TYPE(uint64, false, false)
 DEFINE_SIMPLE_TYPE(float32, true, true)
 DEFINE_SIMPLE_TYPE(float64, true, true)
 
+#define DEFINE_VECTOR_TYPE(T) template <> const Type* build_type_info<T>() { \
+	typedef T::ComponentType C; \
+	static_assert(sizeof(T) == VectorType::Alignment && std::alignment_of<T>::value == VectorType::Alignment, "Unexpected vector layout."); \
+	static const VectorType type(#T, sizeof(C) * T::NumComponents, sizeof(C), std::is_floating_point<C>::value); \
+	return &type; \
+}
+
+DEFINE_VECTOR_TYPE(vec2)
+DEFINE_VECTOR_TYPE(vec3)
+DEFINE_VECTOR_TYPE(vec4)
+DEFINE_VECTOR_TYPE(ivec2)
+DEFINE_VECTOR_TYPE(ivec3)
+DEFINE_VECTOR_TYPE(ivec4)
+
 
 void IntegerType::deserialize(byte* place, const ArchiveNode& node, IUniverse&) const {
 	if (is_signed_) {
@@ -44,6 +106,28 @@ void IntegerType::deserialize(byte* place, const ArchiveNode& node, IUniverse&)
 	}
 }
 
+void IntegerType::deserialize(byte* place, ArchiveReader& reader, IUniverse&) const {
+	int64 n;
+	if (!reader.read(n)) return;
+	if (is_signed_) {
+		switch (width_) {
+			case 1: *reinterpret_cast<int8* >(place) = n; return;
+			case 2: *reinterpret_cast<int16*>(place) = n; return;
+			case 4: *reinterpret_cast<int32*>(place) = n; return;
+			case 8: *reinterpret_cast<int64*>(place) = n; return;
+			default: ASSERT(false); // non-standard integer size
+		}
+	} else {
+		switch (width_) {
+			case 1: *reinterpret_cast<uint8* >(place) = n; return;
+			case 2: *reinterpret_cast<uint16*>(place) = n; return;
+			case 4: *reinterpret_cast<uint32*>(place) = n; return;
+			case 8: *reinterpret_cast<uint64*>(place) = n; return;
+			default: ASSERT(false); // non-standard integer size
+		}
+	}
+}
+
 void IntegerType::serialize(const byte* place, ArchiveNode& node, IUniverse&) const {
 	if (is_signed_) {
 		switch (width_) {
@@ -64,11 +148,32 @@ void IntegerType::serialize(const byte* place, ArchiveNode& node, IUniverse&) co
 	}
 }
 
+void IntegerType::serialize(const byte* place, ArchiveWriter& writer, IUniverse&) const {
+	if (is_signed_) {
+		switch (width_) {
+			case 1: writer.value(int64(*reinterpret_cast<const int8* >(place))); return;
+			case 2: writer.value(int64(*reinterpret_cast<const int16*>(place))); return;
+			case 4: writer.value(int64(*reinterpret_cast<const int32*>(place))); return;
+			case 8: writer.value(int64(*reinterpret_cast<const int64*>(place))); return;
+			default: ASSERT(false); // non-standard integer size
+		}
+	} else {
+		switch (width_) {
+			case 1: writer.value(int64(*reinterpret_cast<const uint8* >(place))); return;
+			case 2: writer.value(int64(*reinterpret_cast<const uint16*>(place))); return;
+			case 4: writer.value(int64(*reinterpret_cast<const uint32*>(place))); return;
+			case 8: writer.value(int64(*reinterpret_cast<const uint64*>(place))); return;
+			default: ASSERT(false); // non-standard integer size
+		}
+	}
+}
+
 void* IntegerType::cast(const SimpleType* to, void* memory) const {
 	if (to == this) return memory;
 	
-	auto enum_type = dynamic_cast<const EnumType*>(to);
-	if (enum_type != nullptr && enum_type->size() <= width_) {
+	if (to->kind() != TypeKind::Enum) return nullptr;
+	auto enum_type = static_cast<const EnumType*>(to);
+	if (enum_type->size() <= width_) {
 		if (is_signed_) {
 			ASSERT(width_ <= sizeof(ssize_t));
 			ssize_t n = 0;
@@ -90,8 +195,23 @@ void* IntegerType::cast(const SimpleType* to, void* memory) const {
 void FloatType::deserialize(byte* place, const ArchiveNode& node, IUniverse&) const {
 	if (width_ == 4) {
 		node.get(*reinterpret_cast<float32*>(place));
+		return;
 	} else if (width_ == 8) {
 		node.get(*reinterpret_cast<float64*>(place));
+		return;
+	}
+	ASSERT(false); // FloatType with neither 32-bit nor 64-bit floats?
+}
+
+void FloatType::deserialize(byte* place, ArchiveReader& reader, IUniverse&) const {
+	float64 f;
+	if (!reader.read(f)) return;
+	if (width_ == 4) {
+		*reinterpret_cast<float32*>(place) = f;
+		return;
+	} else if (width_ == 8) {
+		*reinterpret_cast<float64*>(place) = f;
+		return;
 	}
 	ASSERT(false); // FloatType with neither 32-bit nor 64-bit floats?
 }
@@ -99,8 +219,21 @@ void FloatType::deserialize(byte* place, const ArchiveNode& node, IUniverse&) co
 void FloatType::serialize(const byte* place, ArchiveNode& node, IUniverse&) const {
 	if (width_ == 4) {
 		node.set(*reinterpret_cast<const float32*>(place));
+		return;
 	} else if (width_ == 8) {
 		node.set(*reinterpret_cast<const float64*>(place));
+		return;
+	}
+	ASSERT(false); // FloatType with neither 32-bit nor 64-bit floats?
+}
+
+void FloatType::serialize(const byte* place, ArchiveWriter& writer, IUniverse&) const {
+	if (width_ == 4) {
+		writer.value(float64(*reinterpret_cast<const float32*>(place)));
+		return;
+	} else if (width_ == 8) {
+		writer.value(*reinterpret_cast<const float64*>(place));
+		return;
 	}
 	ASSERT(false); // FloatType with neither 32-bit nor 64-bit floats?
 }
@@ -119,7 +252,7 @@ bool EnumType::name_for_value(ssize_t value, std::string& name) const {
 	if (value >= min() && value <= max()) {
 		for (auto& tuple: entries_) {
 			if (std::get<1>(tuple) == value) {
-				name = std::get<0>(tuple);
+				name = std::get<0>(tuple).str();
 				return true;
 			}
 		}
@@ -128,6 +261,11 @@ bool EnumType::name_for_value(ssize_t value, std::string& name) const {
 }
 
 bool EnumType::value_for_name(const std::string& name, ssize_t& out_value) const {
+	Symbol symbol;
+	return Symbol::find(name, symbol) && value_for_name(symbol, out_value);
+}
+
+bool EnumType::value_for_name(Symbol name, ssize_t& out_value) const {
 	for (auto& tuple: entries_) {
 		if (std::get<0>(tuple) == name) {
 			out_value = std::get<1>(tuple);
@@ -153,6 +291,19 @@ void EnumType::deserialize(byte* place, const ArchiveNode& node, IUniverse&) con
 	}
 }
 
+void EnumType::deserialize(byte* place, ArchiveReader& reader, IUniverse&) const {
+	std::string name;
+	if (reader.read(name)) {
+		ssize_t value;
+		ASSERT(width_ <= sizeof(ssize_t));
+		if (value_for_name(name, value)) {
+			memcpy(place, &value, width_);
+		} else {
+			// XXX: Invalid enum entry.
+		}
+	}
+}
+
 void EnumType::serialize(const byte* place, ArchiveNode& node, IUniverse&) const {
 	ssize_t value = 0;
 	ASSERT(width_ <= sizeof(ssize_t));
@@ -166,11 +317,25 @@ void EnumType::serialize(const byte* place, ArchiveNode& node, IUniverse&) const
 	}
 }
 
+void EnumType::serialize(const byte* place, ArchiveWriter& writer, IUniverse&) const {
+	ssize_t value = 0;
+	ASSERT(width_ <= sizeof(ssize_t));
+	memcpy(&value, place, width_);
+	std::string name;
+	if (name_for_value(value, name)) {
+		writer.value(name);
+	} else {
+		// XXX: Invalid enum entry! Written as null, like the empty node the tree path leaves.
+		writer.null();
+	}
+}
+
 void* EnumType::cast(const SimpleType* to, void* memory) const {
 	if (to == this) return memory;
 	
-	auto integer_type = dynamic_cast<const IntegerType*>(to);
-	if (integer_type != nullptr && integer_type->size() <= width_) {
+	if (to->kind() != TypeKind::Simple || to->is_float()) return nullptr;
+	auto integer_type = static_cast<const IntegerType*>(to);
+	if (integer_type->size() <= width_) {
 		if (integer_type->is_signed()) {
 			ssize_t value = 0;
 			ASSERT(integer_type->size() <= sizeof(ssize_t));
@@ -196,8 +361,217 @@ void* FloatType::cast(const SimpleType* to, void* memory) const {
 	return nullptr;
 }
 
+namespace {
+	// Vectors are converted through staging buffers of 4 lanes per vector, in the
+	// types archive nodes store numbers as. Missing components read as zero.
+	const size_t VectorLanes = 4;
+	
+	template <typename T>
+	T read_number(const ArchiveNode& node) {
+		float64 f;
+		int64 n;
+		if (node.get(f)) return static_cast<T>(f);
+		if (node.get(n)) return static_cast<T>(n);
+		return 0;
+	}
+	
+	template <typename T>
+	void read_lanes(const ArchiveNode& node, size_t num_components, T* lanes) {
+		size_t sz = node.is_array() ? std::min(num_components, node.array_size()) : 0;
+		for (size_t i = 0; i < sz; ++i) {
+			lanes[i] = read_number<T>(node[i]);
+		}
+		for (size_t i = sz; i < VectorLanes; ++i) {
+			lanes[i] = 0;
+		}
+	}
+	
+	template <typename T>
+	T read_number(ArchiveReader& reader) {
+		if (reader.peek() == ArchiveNodeType::Float) {
+			float64 f;
+			return reader.read(f) ? static_cast<T>(f) : 0;
+		}
+		int64 n;
+		return reader.read(n) ? static_cast<T>(n) : 0;
+	}
+	
+	template <typename T>
+	void read_lanes(ArchiveReader& reader, size_t num_components, T* lanes) {
+		size_t i = 0;
+		if (reader.begin_array()) {
+			while (reader.next_element()) {
+				if (i < num_components) {
+					lanes[i++] = read_number<T>(reader);
+				} else {
+					reader.skip();
+				}
+			}
+		}
+		for (; i < VectorLanes; ++i) {
+			lanes[i] = 0;
+		}
+	}
+	
+	template <typename T>
+	void write_lanes(ArchiveNode& node, size_t num_components, const T* lanes) {
+		for (size_t i = 0; i < num_components; ++i) {
+			node.array_push() = lanes[i];
+		}
+	}
+	
+	template <typename T>
+	void write_lanes(ArchiveWriter& writer, size_t num_components, const T* lanes) {
+		writer.begin_array();
+		for (size_t i = 0; i < num_components; ++i) {
+			writer.value(lanes[i]);
+		}
+		writer.end_array();
+	}
+	
+	void narrow(const float64* in, byte* out, size_t count) { convert_float64_to_float32(in, reinterpret_cast<float32*>(out), count); }
+	void narrow(const int64* in, byte* out, size_t count) { convert_int64_to_int32(in, reinterpret_cast<int32*>(out), count); }
+	void widen(const byte* in, float64* out, size_t count) { convert_float32_to_float64(reinterpret_cast<const float32*>(in), out, count); }
+	void widen(const byte* in, int64* out, size_t count) { convert_int32_to_int64(reinterpret_cast<const int32*>(in), out, count); }
+	
+	template <typename T>
+	void deserialize_vectors(byte* place, size_t count, size_t stride, size_t num_components, const ArchiveNode& node) {
+		if (stride == VectorType::Alignment) {
+			// Gather all components first, so they are narrowed in one pass. The padding
+			// lanes are zero and land in the padding of each vector.
+			Array<T> lanes;
+			lanes.resize(count * VectorLanes);
+			for (size_t i = 0; i < count; ++i) {
+				read_lanes(node[i], num_components, &lanes[i * VectorLanes]);
+			}
+			narrow(lanes.begin(), place, count * VectorLanes);
+		} else {
+			for (size_t i = 0; i < count; ++i) {
+				T lanes[VectorLanes];
+				read_lanes(node[i], num_components, lanes);
+				narrow(lanes, place + i * stride, num_components);
+			}
+		}
+	}
+	
+	ArchiveNode& next_element(ArchiveNode& node) { return node.array_push(); }
+	ArchiveWriter& next_element(ArchiveWriter& writer) { return writer; }
+	
+	template <typename T, typename Out>
+	void serialize_vectors(const byte* place, size_t count, size_t stride, size_t num_components, Out& out) {
+		if (stride == VectorType::Alignment) {
+			Array<T> lanes;
+			lanes.resize(count * VectorLanes);
+			widen(place, lanes.begin(), count * VectorLanes);
+			for (size_t i = 0; i < count; ++i) {
+				write_lanes(next_element(out), num_components, &lanes[i * VectorLanes]);
+			}
+		} else {
+			for (size_t i = 0; i < count; ++i) {
+				T lanes[VectorLanes];
+				widen(place + i * stride, lanes, num_components);
+				write_lanes(next_element(out), num_components, lanes);
+			}
+		}
+	}
+}
+
+void VectorType::deserialize(byte* place, const ArchiveNode& node, IUniverse&) const {
+	ASSERT(component_width_ == 4);
+	if (is_float_) {
+		float64 lanes[VectorLanes];
+		read_lanes(node, num_components(), lanes);
+		narrow(lanes, place, num_components());
+	} else {
+		int64 lanes[VectorLanes];
+		read_lanes(node, num_components(), lanes);
+		narrow(lanes, place, num_components());
+	}
+}
+
+void VectorType::deserialize(byte* place, ArchiveReader& reader, IUniverse&) const {
+	ASSERT(component_width_ == 4);
+	if (is_float_) {
+		float64 lanes[VectorLanes];
+		read_lanes(reader, num_components(), lanes);
+		narrow(lanes, place, num_components());
+	} else {
+		int64 lanes[VectorLanes];
+		read_lanes(reader, num_components(), lanes);
+		narrow(lanes, place, num_components());
+	}
+}
+
+void VectorType::serialize(const byte* place, ArchiveNode& node, IUniverse&) const {
+	ASSERT(component_width_ == 4);
+	if (is_float_) {
+		float64 lanes[VectorLanes];
+		widen(place, lanes, num_components());
+		write_lanes(node, num_components(), lanes);
+	} else {
+		int64 lanes[VectorLanes];
+		widen(place, lanes, num_components());
+		write_lanes(node, num_components(), lanes);
+	}
+}
+
+void VectorType::serialize(const byte* place, ArchiveWriter& writer, IUniverse&) const {
+	ASSERT(component_width_ == 4);
+	if (is_float_) {
+		float64 lanes[VectorLanes];
+		widen(place, lanes, num_components());
+		write_lanes(writer, num_components(), lanes);
+	} else {
+		int64 lanes[VectorLanes];
+		widen(place, lanes, num_components());
+		write_lanes(writer, num_components(), lanes);
+	}
+}
+
+void VectorType::deserialize_n(byte* place, size_t count, size_t stride, const ArchiveNode& node) const {
+	ASSERT(component_width_ == 4);
+	ASSERT(count <= node.array_size());
+	if (is_float_) {
+		deserialize_vectors<float64>(place, count, stride, num_components(), node);
+	} else {
+		deserialize_vectors<int64>(place, count, stride, num_components(), node);
+	}
+}
+
+void VectorType::serialize_n(const byte* place, size_t count, size_t stride, ArchiveNode& node) const {
+	ASSERT(component_width_ == 4);
+	if (is_float_) {
+		serialize_vectors<float64>(place, count, stride, num_components(), node);
+	} else {
+		serialize_vectors<int64>(place, count, stride, num_components(), node);
+	}
+}
+
+// Writes the elements only; the caller opens and closes the array.
+void VectorType::serialize_n(const byte* place, size_t count, size_t stride, ArchiveWriter& writer) const {
+	ASSERT(component_width_ == 4);
+	if (is_float_) {
+		serialize_vectors<float64>(place, count, stride, num_components(), writer);
+	} else {
+		serialize_vectors<int64>(place, count, stride, num_components(), writer);
+	}
+}
+
+void* VectorType::cast(const SimpleType* to, void* memory) const {
+	if (to == this) return memory;
+	return nullptr;
+}
+
 const std::string VoidType::Name = "void";
 
+void VoidType::serialize(const byte*, ArchiveWriter& writer, IUniverse&) const {
+	writer.null();
+}
+
+void VoidType::deserialize(byte*, ArchiveReader& reader, IUniverse&) const {
+	reader.skip();
+}
+
 const VoidType* VoidType::get() {
 	static const VoidType p;
 	return &p;
@@ -216,6 +590,14 @@ void StringType::serialize(const std::string& place, ArchiveNode& node, IUnivers
 	node.set(place);
 }
 
+void StringType::serialize(const std::string& place, ArchiveWriter& writer, IUniverse&) const {
+	writer.value(place);
+}
+
+void StringType::deserialize(std::string& place, ArchiveReader& reader, IUniverse&) const {
+	reader.read(place);
+}
+
 const StringType* StringType::get() {
 	static const StringType type = StringType();
 	return &type;
@@ -225,3 +607,31 @@ const std::string& StringType::name() const {
 	static const std::string name = "std::string";
 	return name;
 }
+
+void SymbolType::deserialize(Symbol& place, const ArchiveNode& node, IUniverse&) const {
+	std::string s;
+	if (node.get(s)) place = Symbol(s);
+}
+
+void SymbolType::serialize(const Symbol& place, ArchiveNode& node, IUniverse&) const {
+	node.set(place.str());
+}
+
+void SymbolType::serialize(const Symbol& place, ArchiveWriter& writer, IUniverse&) const {
+	writer.value(place.str());
+}
+
+void SymbolType::deserialize(Symbol& place, ArchiveReader& reader, IUniverse&) const {
+	std::string s;
+	if (reader.read(s)) place = Symbol(s);
+}
+
+const SymbolType* SymbolType::get() {
+	static const SymbolType type = SymbolType();
+	return &type;
+}
+
+const std::string& SymbolType::name() const {
+	static const std::string name = "Symbol";
+	return name;
+}
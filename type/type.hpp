@@ -4,6 +4,8 @@
 
 #include "base/basic.hpp"
 #include "base/array.hpp"
+#include "base/vector.hpp"
+#include "base/symbol.hpp"
 #include "object/object.hpp"
 #include <string>
 #include <map>
@@ -12,20 +14,68 @@
 #include <limits.h>
 
 struct ArchiveNode;
+struct ArchiveWriter;
+struct ArchiveReader;
 struct IUniverse;
 struct SlotAttributeBase;
 
+struct TypeKind {
+	enum Kind {
+		Void,
+		Simple,
+		Enum,
+		Vector,
+		String,
+		Symbol,
+		Object,
+		Composite,
+		Array,
+		Reference,
+		Signal,
+		Maybe,
+	};
+};
+
 struct Type {
+	virtual ~Type() {}
 	virtual void deserialize(byte* place, const ArchiveNode&, IUniverse&) const = 0;
 	virtual void serialize(const byte* place, ArchiveNode&, IUniverse&) const = 0;
+	// Reads the next value from 'reader' without building nodes. The default reads it
+	// into a scratch node and deserializes that; the built-in types read directly.
+	virtual void deserialize(byte* place, ArchiveReader& reader, IUniverse&) const;
+	// Streams the value to 'writer' without building nodes. The default serializes
+	// into a scratch node and replays it; the built-in types write directly.
+	virtual void serialize(const byte* place, ArchiveWriter& writer, IUniverse&) const;
 	virtual void construct(byte* place, IUniverse&) const = 0;
 	virtual void destruct(byte* place, IUniverse&) const = 0;
+	// Construct or destruct 'count' instances laid out 'stride' bytes apart. The defaults
+	// call construct()/destruct() per instance; types override them to batch the work.
+	virtual void construct_n(byte* place, size_t count, size_t stride, IUniverse&) const;
+	virtual void destruct_n(byte* place, size_t count, size_t stride, IUniverse&) const;
 	
 	virtual const std::string& name() const = 0;
 	virtual size_t size() const = 0;
+	virtual size_t alignment() const = 0;
 	virtual bool is_abstract() const { return false; }
+	// Instances can be copied with memcpy.
+	virtual bool is_trivially_copyable() const { return false; }
+	// destruct() does nothing, so it can be skipped.
+	virtual bool is_trivially_destructible() const { return false; }
+	// construct() can be replaced by filling the memory with zeros.
+	virtual bool is_zero_initializable() const { return false; }
+	
+	// Dense, process-unique ID assigned when the type is built. IDs are handed out
+	// sequentially from 0, so they can be used to index tables of per-type data.
+	uint32 type_id() const { return type_id_; }
+	TypeKind::Kind kind() const { return kind_; }
+	bool is_simple_type() const { return kind_ == TypeKind::Simple || kind_ == TypeKind::Enum || kind_ == TypeKind::Vector; }
+	bool is_derived_type() const { return kind_ == TypeKind::Object || kind_ == TypeKind::Composite || kind_ == TypeKind::Array; }
+	static uint32 num_type_ids();
 protected:
-	Type() {}
+	explicit Type(TypeKind::Kind kind);
+private:
+	uint32 type_id_;
+	TypeKind::Kind kind_;
 };
 
 template <typename ObjectType, typename TypeType = Type>
@@ -37,7 +87,12 @@ struct TypeFor : TypeType {
 	// Override interface.
 	virtual void deserialize(ObjectType& place, const ArchiveNode&, IUniverse&) const = 0;
 	virtual void serialize(const ObjectType& place, ArchiveNode&, IUniverse&) const = 0;
-
+	virtual void deserialize(ObjectType& place, ArchiveReader& reader, IUniverse& universe) const {
+		this->Type::deserialize(reinterpret_cast<byte*>(&place), reader, universe);
+	}
+	virtual void serialize(const ObjectType& place, ArchiveWriter& writer, IUniverse& universe) const {
+		this->Type::serialize(reinterpret_cast<const byte*>(&place), writer, universe);
+	}
 
 	// Do not override.
 	void deserialize(byte* place, const ArchiveNode& node, IUniverse& universe) const {
@@ -46,13 +101,33 @@ struct TypeFor : TypeType {
 	void serialize(const byte* place, ArchiveNode& node, IUniverse& universe) const {
 		this->serialize(*reinterpret_cast<const ObjectType*>(place), node, universe);
 	}
+	void serialize(const byte* place, ArchiveWriter& writer, IUniverse& universe) const {
+		this->serialize(*reinterpret_cast<const ObjectType*>(place), writer, universe);
+	}
+	void deserialize(byte* place, ArchiveReader& reader, IUniverse& universe) const {
+		this->deserialize(*reinterpret_cast<ObjectType*>(place), reader, universe);
+	}
 	void construct(byte* place, IUniverse&) const {
 		::new(place) ObjectType;
 	}
 	void destruct(byte* place, IUniverse&) const {
 		reinterpret_cast<ObjectType*>(place)->~ObjectType();
 	}
+	void construct_n(byte* place, size_t count, size_t stride, IUniverse&) const {
+		for (size_t i = 0; i < count; ++i) {
+			::new(place + i * stride) ObjectType;
+		}
+	}
+	void destruct_n(byte* place, size_t count, size_t stride, IUniverse&) const {
+		for (size_t i = 0; i < count; ++i) {
+			reinterpret_cast<ObjectType*>(place + i * stride)->~ObjectType();
+		}
+	}
 	size_t size() const { return sizeof(ObjectType); }
+	size_t alignment() const { return std::alignment_of<ObjectType>::value; }
+	bool is_trivially_copyable() const { return std::is_trivially_copyable<ObjectType>::value; }
+	bool is_trivially_destructible() const { return std::is_trivially_destructible<ObjectType>::value; }
+	bool is_zero_initializable() const { return std::is_trivially_default_constructible<ObjectType>::value; }
 };
 
 struct VoidType : Type {
@@ -60,25 +135,39 @@ struct VoidType : Type {
 	
 	void deserialize(byte* place, const ArchiveNode&, IUniverse&) const override {}
 	void serialize(const byte*, ArchiveNode&, IUniverse&) const override {}
+	void serialize(const byte*, ArchiveWriter&, IUniverse&) const override;
+	void deserialize(byte*, ArchiveReader&, IUniverse&) const override;
 	virtual void construct(byte*, IUniverse&) const override {}
 	virtual void destruct(byte*, IUniverse&) const override {}
+	void construct_n(byte*, size_t, size_t, IUniverse&) const override {}
+	void destruct_n(byte*, size_t, size_t, IUniverse&) const override {}
 	static const std::string Name;
 	const std::string& name() const override { return Name; }
 	size_t size() const override { return 0; }
+	size_t alignment() const override { return 1; }
 	bool is_abstract() const override { return true; }
+	bool is_trivially_copyable() const override { return true; }
+	bool is_trivially_destructible() const override { return true; }
+	bool is_zero_initializable() const override { return true; }
 private:
-	VoidType() {}
+	VoidType() : Type(TypeKind::Void) {}
 };
 
 struct SimpleType : Type {
-	SimpleType(std::string name, size_t width, size_t component_width, bool is_float, bool is_signed) : name_(std::move(name)), width_(width), component_width_(component_width), is_float_(is_float), is_signed_(is_signed) {}
+	SimpleType(std::string name, size_t width, size_t component_width, bool is_float, bool is_signed, TypeKind::Kind kind = TypeKind::Simple) : Type(kind), name_(std::move(name)), width_(width), component_width_(component_width), is_float_(is_float), is_signed_(is_signed) {}
 	const std::string& name() const override { return name_; }
 	void construct(byte* place, IUniverse&) const { std::fill(place, place + size(), 0); }
 	void destruct(byte*, IUniverse&) const {}
+	bool is_trivially_copyable() const override { return true; }
+	bool is_trivially_destructible() const override { return true; }
+	bool is_zero_initializable() const override { return true; }
 	
 	size_t size() const override { return width_; }
+	size_t alignment() const override { return component_width_; }
 	size_t num_components() const { return width_ / component_width_; }
+	size_t component_width() const { return component_width_; }
 	bool is_signed() const { return is_signed_; }
+	bool is_float() const { return is_float_; }
 	virtual void* cast(const SimpleType* to, void* o) const = 0;
 protected:
 	std::string name_;
@@ -89,21 +178,24 @@ protected:
 };
 
 struct EnumType : SimpleType {
-	EnumType(std::string name, size_t width, bool is_signed = true) : SimpleType(name, width, width, false, is_signed), max_(1LL-SSIZE_MAX), min_(SSIZE_MAX) {}
-	void add_entry(std::string name, ssize_t value, std::string description) {
-		entries_.emplace_back(std::make_tuple(std::move(name), value, std::move(description)));
+	EnumType(std::string name, size_t width, bool is_signed = true) : SimpleType(name, width, width, false, is_signed, TypeKind::Enum), max_(1LL-SSIZE_MAX), min_(SSIZE_MAX) {}
+	void add_entry(const std::string& name, ssize_t value, std::string description) {
+		entries_.emplace_back(std::make_tuple(Symbol(name), value, std::move(description)));
 	}
 	bool contains(ssize_t value) const;
 	ssize_t max() const { return max_; }
 	ssize_t min() const { return min_; }
 	bool name_for_value(ssize_t value, std::string& out_name) const;
 	bool value_for_name(const std::string& name, ssize_t& out_value) const;
+	bool value_for_name(Symbol name, ssize_t& out_value) const;
 	
 	void deserialize(byte*, const ArchiveNode&, IUniverse&) const override;
 	void serialize(const byte*, ArchiveNode&, IUniverse&) const override;
+	void deserialize(byte*, ArchiveReader&, IUniverse&) const override;
+	void serialize(const byte*, ArchiveWriter&, IUniverse&) const override;
 	void* cast(const SimpleType* to, void* o) const;
 private:
-	Array<std::tuple<std::string, ssize_t, std::string>> entries_;
+	Array<std::tuple<Symbol, ssize_t, std::string>> entries_;
 	ssize_t max_;
 	ssize_t min_;
 };
@@ -112,6 +204,8 @@ struct IntegerType : SimpleType {
 	IntegerType(std::string name, size_t width, bool is_signed = true) : SimpleType(name, width, width, false, is_signed) {}
 	void deserialize(byte*, const ArchiveNode&, IUniverse&) const override;
 	void serialize(const byte*, ArchiveNode&, IUniverse&) const override;
+	void deserialize(byte*, ArchiveReader&, IUniverse&) const override;
+	void serialize(const byte*, ArchiveWriter&, IUniverse&) const override;
 	void* cast(const SimpleType* to, void* o) const;
 	size_t max() const;
 	ssize_t min() const;
@@ -121,29 +215,65 @@ struct FloatType : SimpleType {
 	FloatType(std::string name, size_t width) : SimpleType(name, width, width, true, true) {}
 	void deserialize(byte*, const ArchiveNode& node, IUniverse&) const override;
 	void serialize(const byte*, ArchiveNode&, IUniverse&) const override;
+	void deserialize(byte*, ArchiveReader&, IUniverse&) const override;
+	void serialize(const byte*, ArchiveWriter&, IUniverse&) const override;
 	void* cast(const SimpleType* to, void* o) const;
 };
 
+// Vectors of 32-bit components, stored as Vector<T, N>. The width only counts the
+// components; the size is padded so every vector is 16 bytes and 16-byte aligned.
 struct VectorType : SimpleType {
-	VectorType(std::string name, size_t width, size_t component_width, bool is_float, bool is_signed = true) : SimpleType(name, width, component_width, is_float, is_signed) {}
+	static const size_t Alignment = 16;
+	VectorType(std::string name, size_t width, size_t component_width, bool is_float, bool is_signed = true) : SimpleType(name, width, component_width, is_float, is_signed, TypeKind::Vector) {}
+	size_t size() const override { return (width_ + Alignment - 1) / Alignment * Alignment; }
+	size_t alignment() const override { return Alignment; }
 	void deserialize(byte*, const ArchiveNode&, IUniverse&) const override;
 	void serialize(const byte*, ArchiveNode&, IUniverse&) const override;
+	void deserialize(byte*, ArchiveReader&, IUniverse&) const override;
+	void serialize(const byte*, ArchiveWriter&, IUniverse&) const override;
 	void* cast(const SimpleType* to, void* o) const;
+	
+	// Bulk versions for arrays of vectors. 'node' is the array node, with one element per vector.
+	void deserialize_n(byte* place, size_t count, size_t stride, const ArchiveNode& node) const;
+	void serialize_n(const byte* place, size_t count, size_t stride, ArchiveNode& node) const;
+	void serialize_n(const byte* place, size_t count, size_t stride, ArchiveWriter& writer) const;
 };
 
 struct StringType : TypeFor<std::string> {
 	static const StringType* get();
+	StringType() : TypeFor<std::string>(TypeKind::String) {}
 	
 	void deserialize(std::string& place, const ArchiveNode&, IUniverse&) const override;
 	void serialize(const std::string& place, ArchiveNode&, IUniverse&) const override;
+	void serialize(const std::string& place, ArchiveWriter&, IUniverse&) const override;
+	void deserialize(std::string& place, ArchiveReader&, IUniverse&) const override;
 	
 	const std::string& name() const override;
 	size_t size() const override { return sizeof(std::string); }
 };
 
+// For user data that mostly repeats the same few names. Stored interned, and serialized
+// as strings.
+struct SymbolType : TypeFor<Symbol> {
+	static const SymbolType* get();
+	SymbolType() : TypeFor<Symbol>(TypeKind::Symbol) {}
+	
+	void deserialize(Symbol& place, const ArchiveNode&, IUniverse&) const override;
+	void serialize(const Symbol& place, ArchiveNode&, IUniverse&) const override;
+	void serialize(const Symbol& place, ArchiveWriter&, IUniverse&) const override;
+	void deserialize(Symbol& place, ArchiveReader&, IUniverse&) const override;
+	
+	const std::string& name() const override;
+	// The empty symbol is all zeros.
+	bool is_zero_initializable() const override { return true; }
+};
+
 struct DerivedType : Type {
 	virtual Object* cast(const DerivedType* to, Object* o) const = 0;
-	virtual const SlotAttributeBase* get_slot_by_name(const std::string& name) const { return nullptr; }
+	virtual const SlotAttributeBase* get_slot_by_name(Symbol name) const { return nullptr; }
+	const SlotAttributeBase* get_slot_by_name(const std::string& name) const { return get_slot_by_name(Symbol::lookup(name)); }
+protected:
+	explicit DerivedType(TypeKind::Kind kind) : Type(kind) {}
 };
 
 // static_cast
@@ -158,27 +288,14 @@ template <typename To, typename From>
 typename std::enable_if<!std::is_convertible<From*, To*>::value, To*>::type
 aspect_cast(From* ptr) {
 	Object* o = ptr; // check that From derives from Object.
-	const Type* from = o->object_type();
+	const DerivedType* from = o->object_type();
 	const Type* to = get_type<To>();
 	
-	auto derived_type = dynamic_cast<const DerivedType*>(from);
-	if (derived_type != nullptr) {
-		auto other_derived_type = dynamic_cast<const DerivedType*>(to);
-		if (other_derived_type != nullptr) {
-			return dynamic_cast<To*>(derived_type->cast(other_derived_type, ptr));
-		}
-		return nullptr;
+	if (from == to) return static_cast<To*>(o);
+	if (to->is_derived_type()) {
+		// DerivedType::cast only ever returns an Object that is an instance of 'to'.
+		return static_cast<To*>(from->cast(static_cast<const DerivedType*>(to), o));
 	}
-	
-	auto simple_type = dynamic_cast<const SimpleType*>(from);
-	if (simple_type != nullptr) {
-		auto other_simple_type = dynamic_cast<const SimpleType*>(to);
-		if (other_simple_type != nullptr) {
-			return static_cast<To*>(simple_type->cast(other_simple_type, ptr));
-		}
-		return nullptr;
-	}
-	
 	return nullptr;
 }
 
@@ -208,6 +325,12 @@ DECLARE_TYPE(uint32)
 DECLARE_TYPE(uint64)
 DECLARE_TYPE(float32)
 DECLARE_TYPE(float64)
+DECLARE_TYPE(vec2)
+DECLARE_TYPE(vec3)
+DECLARE_TYPE(vec4)
+DECLARE_TYPE(ivec2)
+DECLARE_TYPE(ivec3)
+DECLARE_TYPE(ivec4)
 
 template <typename T> struct BuildTypeInfo {};
 
@@ -219,6 +342,10 @@ template <> struct BuildTypeInfo<std::string> {
 	static const StringType* build() { return StringType::get(); }
 };
 
+template <> struct BuildTypeInfo<Symbol> {
+	static const SymbolType* build() { return SymbolType::get(); }
+};
+
 template <typename T> const Type* build_type_info() {
 	return BuildTypeInfo<T>::build();
 }
@@ -1,10 +1,10 @@
 #include "type/type_registry.hpp"
 #include "object/struct_type.hpp"
 #include "base/basic.hpp"
-#include <map>
+#include <unordered_map>
 
 struct TypeRegistry::Impl {
-	std::map<std::string, const ObjectTypeBase*> type_map;
+	std::unordered_map<Symbol, const ObjectTypeBase*> type_map;
 };
 
 TypeRegistry::Impl* TypeRegistry::impl() {
@@ -13,9 +13,13 @@ TypeRegistry::Impl* TypeRegistry::impl() {
 }
 
 void TypeRegistry::add(const ObjectTypeBase* type) {
-	impl()->type_map[type->name()] = type;
+	impl()->type_map[type->symbol()] = type;
 }
 
 const ObjectTypeBase* TypeRegistry::get(const std::string& name) {
+	return get(Symbol::lookup(name));
+}
+
+const ObjectTypeBase* TypeRegistry::get(Symbol name) {
 	return find_or(impl()->type_map, name, nullptr);
 }
\ No newline at end of file
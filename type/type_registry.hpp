@@ -3,6 +3,7 @@
 #define TYPE_REGISTRY_HPP_LPQGF8DT
 
 #include "object/object.hpp"
+#include "base/symbol.hpp"
 #include <string>
 
 class TypeRegistry {
@@ -12,6 +13,7 @@ public:
 	static void add(const ObjectTypeBase* type);
 	
 	static const ObjectTypeBase* get(const std::string& name);
+	static const ObjectTypeBase* get(Symbol name);
 private:
 	TypeRegistry();
 	struct Impl;